@@ -1,34 +1,42 @@
-function(add_shaders TARGET_NAME)
+# Compiles each shader into "<name>.spv" in the binary directory, then packs them all into ARCHIVE with ShaderPacker.
+# Shaders are optimized with -O and keep their debug info in Debug builds only. The depfiles glslc writes make an
+# edited include recompile exactly the shaders that include it.
+function(add_shaders TARGET_NAME ARCHIVE)
 	set(SHADER_SOURCE_FILES ${ARGN})
 	list(LENGTH SHADER_SOURCE_FILES FILE_COUNT)
 	if(FILE_COUNT EQUAL 0)
 		message(FATAL_ERROR "Cannot add shaders without shaders source files!")
 	endif()
 
-	set(SHADER_COMMANDS)
 	set(SHADER_PRODUCTS)
 
 	foreach(SHADER_SOURCE IN LISTS SHADER_SOURCE_FILES)
 		cmake_path(ABSOLUTE_PATH SHADER_SOURCE NORMALIZE)
 		cmake_path(GET SHADER_SOURCE FILENAME SHADER_NAME)
+		set(SHADER_PRODUCT "${CMAKE_CURRENT_BINARY_DIR}/${SHADER_NAME}.spv")
 
-		# COMMANDS
-		list(APPEND SHADER_COMMANDS COMMAND)
-		list(APPEND SHADER_COMMANDS Vulkan::glslc)
-		list(APPEND SHADER_COMMANDS "${SHADER_SOURCE}")
-		list(APPEND SHADER_COMMANDS "-o")
-		list(APPEND SHADER_COMMANDS "${CMAKE_CURRENT_BINARY_DIR}/${SHADER_NAME}.spv")
+		add_custom_command(
+			OUTPUT "${SHADER_PRODUCT}"
+			COMMAND Vulkan::glslc -O $<$<CONFIG:Debug>:-g> -MD -MF "${SHADER_PRODUCT}.d"
+				"${SHADER_SOURCE}" -o "${SHADER_PRODUCT}"
+			MAIN_DEPENDENCY "${SHADER_SOURCE}"
+			DEPFILE "${SHADER_PRODUCT}.d"
+			COMMENT "Compiling ${SHADER_NAME}"
+			COMMAND_EXPAND_LISTS
+		)
 
-		# PRODUCTS
-		list(APPEND SHADER_PRODUCTS "${CMAKE_CURRENT_BINARY_DIR}/${SHADER_NAME}.spv")
+		list(APPEND SHADER_PRODUCTS "${SHADER_PRODUCT}")
 	endforeach()
 
+	add_custom_command(
+		OUTPUT "${ARCHIVE}"
+		COMMAND ShaderPacker "${ARCHIVE}" ${SHADER_PRODUCTS}
+		DEPENDS ShaderPacker ${SHADER_PRODUCTS}
+		COMMENT "Packing shaders into ${ARCHIVE}"
+	)
+
 	add_custom_target(${TARGET_NAME} ALL
-		${SHADER_COMMANDS}
-		COMMENT "Compiling Shaders ..."
+		DEPENDS "${ARCHIVE}"
 		SOURCES ${SHADER_SOURCE_FILES}
-		BYPRODUCTS ${SHADER_PRODUCTS}
 	)
-
-
-endfunction()
\ No newline at end of file
+endfunction()
@@ -2,10 +2,20 @@
 #include "common.glsl"
 
 
+layout(location = 0) in vec3 vertex_color;
+layout(location = 1) in vec2 vertex_uv;
+
 layout(location =0) out vec4 out_color;
 
+// Specialized off for draws without a texture, their variant compiles without the sample
+layout(constant_id = 0) const bool kTextured = true;
+
 void main()
 {
     // RGBA
-    out_color = vec4(1.0, 0.0, 0.5, 1.0);
+    out_color = vec4(vertex_color, 1.0);
+    if (kTextured)
+    {
+        out_color *= SampleTexture(draw_constants.texture_index, vertex_uv);
+    }
 }
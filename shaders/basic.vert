@@ -2,13 +2,18 @@
 #include "common.glsl"
 
 
-vec2 hardcoded_positions[3] = vec2[](
-    vec2(0.0, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5)
-);
+layout(location = 0) in vec3 in_position;
+layout(location = 1) in vec3 in_color;
+layout(location = 2) in vec2 in_uv;
+
+layout(location = 0) out vec3 vertex_color;
+layout(location = 1) out vec2 vertex_uv;
+
+// The depth prepass runs the same code, its depth must match the main pass bit for bit
+invariant gl_Position;
 
 void main() {
-    vec2 current_position = hardcoded_positions[gl_VertexIndex]; 
-    gl_Position = vec4(current_position, 0.0, 1.0);
+    gl_Position = frame.view_projection * draw.model * vec4(in_position, 1.0);
+    vertex_color = in_color;
+    vertex_uv = in_uv;
 }
@@ -1 +1,93 @@
 #extension GL_KHR_vulkan_glsl:enable
+#extension GL_EXT_nonuniform_qualifier:require
+
+// Set 0 lives in the uniform ring, every binding is reached through a dynamic offset. Mirrors src/shader_types.h.
+layout(set = 0, binding = 0) uniform FrameUniforms
+{
+    mat4 view_projection;
+    vec4 frustum_planes[6];  // Normals point inwards: left, right, bottom, top, near, far
+} frame;
+
+layout(set = 0, binding = 1) uniform DrawUniforms
+{
+    mat4 model;
+} draw;
+
+// Set 1 is the bindless table, resources are picked by the indices in the push constants
+layout(set = 1, binding = 0) uniform texture2D textures[];
+layout(set = 1, binding = 1) readonly buffer BindlessBuffer
+{
+    uint words[];
+} buffers[];
+layout(set = 1, binding = 2) uniform sampler samplers[2];
+
+// The same storage buffers seen as the three sections of a frame's instance buffer: transforms, colors and
+// materials, each instance_capacity long. Mirrors Graphics::RenderInstanced.
+layout(set = 1, binding = 1) readonly buffer InstanceTransforms
+{
+    mat4 transforms[];
+} instance_transforms[];
+layout(set = 1, binding = 1) readonly buffer InstanceColors
+{
+    vec4 colors[];
+} instance_colors[];
+layout(set = 1, binding = 1) readonly buffer InstanceMaterials
+{
+    uint materials[];
+} instance_materials[];
+
+// The GPU-driven scene, mirrors SceneObject and SceneBatch in src/shader_types.h
+struct SceneObject
+{
+    mat4 transform;
+    vec4 bounds;
+    uint batch;
+    uint material;
+};
+
+struct SceneBatch
+{
+    uint index_count;
+    uint first_command;
+};
+
+layout(set = 1, binding = 1) readonly buffer SceneObjects
+{
+    SceneObject objects[];
+} scene_objects[];
+layout(set = 1, binding = 1) readonly buffer SceneBatches
+{
+    SceneBatch batches[];
+} scene_batches[];
+
+// Passes with their own push constants (compute) define this before the include
+#ifndef CUSTOM_PUSH_CONSTANTS
+layout(push_constant) uniform DrawConstants
+{
+    uint texture_index;
+    uint sampler_index;
+    uint buffer_index;
+    uint instance_capacity;
+} draw_constants;
+
+// gl_InstanceIndex already includes the first instance of the draw
+mat4 InstanceTransform(uint instance)
+{
+    return instance_transforms[draw_constants.buffer_index].transforms[instance];
+}
+
+vec4 InstanceColor(uint instance)
+{
+    return instance_colors[draw_constants.buffer_index].colors[draw_constants.instance_capacity * 4 + instance];
+}
+
+uint InstanceMaterial(uint instance)
+{
+    return instance_materials[draw_constants.buffer_index].materials[draw_constants.instance_capacity * 20 + instance];
+}
+
+vec4 SampleTexture(uint texture_index, vec2 uv)
+{
+    return texture(sampler2D(textures[nonuniformEXT(texture_index)], samplers[draw_constants.sampler_index]), uv);
+}
+#endif  // CUSTOM_PUSH_CONSTANTS
@@ -0,0 +1,15 @@
+#version 450
+#include "common.glsl"
+
+
+layout(location = 0) in vec3 vertex_color;
+layout(location = 1) in vec2 vertex_uv;
+layout(location = 2) flat in uint vertex_material;
+
+layout(location = 0) out vec4 out_color;
+
+void main()
+{
+    // The material is the instance's texture in the bindless table
+    out_color = vec4(vertex_color, 1.0) * SampleTexture(vertex_material, vertex_uv);
+}
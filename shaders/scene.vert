@@ -0,0 +1,23 @@
+#version 450
+#include "common.glsl"
+
+
+layout(location = 0) in vec3 in_position;
+layout(location = 1) in vec3 in_color;
+layout(location = 2) in vec2 in_uv;
+
+layout(location = 0) out vec3 vertex_color;
+layout(location = 1) out vec2 vertex_uv;
+layout(location = 2) flat out uint vertex_material;
+
+// Same depth in the prepass and the main pass, as in basic.vert
+invariant gl_Position;
+
+void main() {
+    // The culling pass wrote the object's index as the command's first instance
+    const SceneObject object = scene_objects[draw_constants.buffer_index].objects[uint(gl_InstanceIndex)];
+    gl_Position = frame.view_projection * object.transform * vec4(in_position, 1.0);
+    vertex_color = in_color;
+    vertex_uv = in_uv;
+    vertex_material = object.material;
+}
@@ -0,0 +1,279 @@
+#include <asset_streamer.h>
+
+namespace veng
+{
+  AssetStreamer::AssetStreamer(Graphics& graphics, StreamingSettings settings) :
+      graphics_(graphics), settings_(settings)
+  {
+    const std::uint32_t thread_count = std::max(settings_.io_threads_, 1u);
+    io_threads_.reserve(thread_count);
+    for (std::uint32_t i = 0; i < thread_count; i++)
+    {
+      io_threads_.emplace_back(std::bind_front(&AssetStreamer::IoLoop, this), i);
+    }
+  }
+
+  AssetStreamer::~AssetStreamer()
+  {
+    for (std::jthread& thread : io_threads_)
+    {
+      thread.request_stop();
+    }
+    // The stop requests wake the threads out of work_signal_, a load in progress finishes first
+    io_threads_.clear();
+  }
+
+  AssetHandle AssetStreamer::RequestMesh(const std::filesystem::path& path, float priority)
+  {
+    std::scoped_lock lock(mutex_);
+    auto it = handles_by_path_.find(path.string());
+    if (it != handles_by_path_.end())
+    {
+      Asset& asset = assets_[it->second];
+      if (asset.state_ == AssetState::kFailed && asset.failed_loads_ < settings_.max_load_attempts_)
+      {
+        asset.priority_ = priority;
+        Enqueue(it->second);
+      }
+      else if (priority < asset.priority_)
+      {
+        asset.priority_ = priority;
+        if (asset.state_ == AssetState::kQueued)
+        {
+          Enqueue(it->second);
+        }
+      }
+      return it->second;
+    }
+
+    AssetHandle handle = 0;
+    if (!free_handles_.empty())
+    {
+      handle = free_handles_.back();
+      free_handles_.pop_back();
+    }
+    else
+    {
+      handle = static_cast<AssetHandle>(assets_.size());
+      assets_.emplace_back();
+    }
+
+    // The serial carries on from the handle's previous owner, so its stale loads stay stale
+    Asset& asset = assets_[handle];
+    const std::uint64_t serial = asset.serial_;
+    asset = Asset();
+    asset.path_ = path;
+    asset.priority_ = priority;
+    asset.serial_ = serial;
+    asset.in_use_ = true;
+    handles_by_path_.emplace(path.string(), handle);
+    Enqueue(handle);
+    return handle;
+  }
+
+  void AssetStreamer::SetPriority(AssetHandle asset, float priority)
+  {
+    std::scoped_lock lock(mutex_);
+    assets_[asset].priority_ = priority;
+    if (assets_[asset].state_ == AssetState::kQueued)
+    {
+      Enqueue(asset);
+    }
+  }
+
+  void AssetStreamer::Cancel(AssetHandle handle)
+  {
+    std::scoped_lock lock(mutex_);
+    Asset& asset = assets_[handle];
+    if (!asset.in_use_)
+    {
+      SPDLOG_WARN("Cancelling asset {} that is not requested", handle);
+      return;
+    }
+    if (asset.state_ == AssetState::kResident)
+    {
+      Evict(asset);
+    }
+    // Queue entries, loads in progress and loads waiting for upload all carry the old serial
+    asset.serial_++;
+    asset.in_use_ = false;
+    handles_by_path_.erase(asset.path_.string());
+    free_handles_.push_back(handle);
+  }
+
+  std::optional<MeshHandle> AssetStreamer::GetMesh(AssetHandle handle)
+  {
+    std::scoped_lock lock(mutex_);
+    Asset& asset = assets_[handle];
+    if (asset.state_ == AssetState::kResident)
+    {
+      asset.last_used_frame_ = frame_;
+      lru_.splice(lru_.begin(), lru_, asset.lru_position_);
+      return asset.mesh_;
+    }
+    if (asset.state_ == AssetState::kEvicted)
+    {
+      asset.state_ = AssetState::kQueued;
+      Enqueue(handle);
+    }
+    return std::nullopt;
+  }
+
+  AssetState AssetStreamer::GetState(AssetHandle asset) const
+  {
+    std::scoped_lock lock(mutex_);
+    return assets_[asset].state_;
+  }
+
+  void AssetStreamer::Update()
+  {
+    ZoneScoped;
+    frame_++;
+    {
+      std::scoped_lock lock(mutex_);
+      std::move(completed_.begin(), completed_.end(), std::back_inserter(ready_to_upload_));
+      completed_.clear();
+    }
+
+    // Loads finished in priority order, the queue keeps it. The first upload always goes through, so an asset
+    // larger than the frame's budget still gets in.
+    std::uint64_t uploaded_bytes = 0;
+    while (!ready_to_upload_.empty() && uploaded_bytes < settings_.upload_bytes_per_frame_)
+    {
+      CompletedLoad load = std::move(ready_to_upload_.front());
+      ready_to_upload_.pop_front();
+
+      Asset& asset = assets_[load.asset_];
+      if (load.serial_ != asset.serial_)
+      {
+        continue;  // Cancelled while loading, the mapping goes away with the load
+      }
+      if (!load.file_.has_value())
+      {
+        std::scoped_lock lock(mutex_);
+        asset.state_ = AssetState::kFailed;
+        asset.failed_loads_++;
+        if (asset.failed_loads_ == settings_.max_load_attempts_)
+        {
+          SPDLOG_WARN("Giving up on {} after {} failed loads", asset.path_.string(), asset.failed_loads_);
+        }
+        continue;
+      }
+      Upload(asset, *load.file_);
+      uploaded_bytes += asset.size_;
+    }
+
+    // Meshes drawn in the previous frame stay even over budget, eviction resumes once they fall out of view
+    while (resident_bytes_ > settings_.residency_budget_ && !lru_.empty())
+    {
+      Asset& victim = assets_[lru_.back()];
+      if (victim.last_used_frame_ + 1 >= frame_)
+      {
+        break;
+      }
+      std::scoped_lock lock(mutex_);
+      Evict(victim);
+    }
+  }
+
+  void AssetStreamer::Enqueue(AssetHandle asset)
+  {
+    // Entries are never removed, a new serial makes the earlier ones stale
+    Asset& queued = assets_[asset];
+    queued.serial_++;
+    queued.state_ = AssetState::kQueued;
+    queue_.push(QueueEntry{queued.priority_, asset, queued.serial_});
+    work_signal_.notify_one();
+  }
+
+  void AssetStreamer::Upload(Asset& asset, const MeshFile& file)
+  {
+    const MeshFileLod& full_lod = file.GetLods().front();
+    asset.mesh_ = graphics_.CreateMesh(file);
+    asset.size_ = file.GetVertices().size_bytes() + std::uint64_t{full_lod.index_count_} * file.GetHeader().index_size_;
+    asset.last_used_frame_ = frame_;
+    lru_.push_front(static_cast<AssetHandle>(&asset - assets_.data()));
+    asset.lru_position_ = lru_.begin();
+    resident_bytes_ += asset.size_;
+
+    std::scoped_lock lock(mutex_);
+    asset.state_ = AssetState::kResident;
+  }
+
+  void AssetStreamer::Evict(Asset& asset)
+  {
+    graphics_.DestroyMesh(asset.mesh_);
+    lru_.erase(asset.lru_position_);
+    resident_bytes_ -= asset.size_;
+    asset.size_ = 0;
+    asset.state_ = AssetState::kEvicted;
+  }
+
+  void AssetStreamer::IoLoop(std::stop_token stop_token, std::uint32_t thread_index)
+  {
+    tracy::SetThreadName(fmt::format("Asset I/O {}", thread_index).c_str());
+    while (true)
+    {
+      AssetHandle handle = 0;
+      std::uint64_t serial = 0;
+      std::filesystem::path path;
+      {
+        std::unique_lock lock(mutex_);
+        // Skips the entries superseded by a newer priority or a cancellation
+        auto next_request = [this, &handle, &serial]()
+        {
+          while (!queue_.empty())
+          {
+            QueueEntry entry = queue_.top();
+            queue_.pop();
+            if (assets_[entry.asset_].serial_ == entry.serial_ && assets_[entry.asset_].state_ == AssetState::kQueued)
+            {
+              handle = entry.asset_;
+              serial = entry.serial_;
+              return true;
+            }
+          }
+          return false;
+        };
+        if (!work_signal_.wait(lock, stop_token, next_request))
+        {
+          return;
+        }
+        assets_[handle].state_ = AssetState::kLoading;
+        path = assets_[handle].path_;
+      }
+
+      ZoneScopedN("Stream asset");
+      std::optional<MeshFile> file = MeshFile::Open(path);
+      if (file.has_value())
+      {
+        // Fault every page in here, so the upload on the main thread copies from memory instead of the disk
+        constexpr std::size_t kPageSize = 4096;
+        const gsl::span<const std::uint8_t> vertex_bytes(
+            reinterpret_cast<const std::uint8_t*>(file->GetVertices().data()), file->GetVertices().size_bytes());
+        std::uint8_t checksum = 0;
+        for (gsl::span<const std::uint8_t> bytes : {vertex_bytes, file->GetIndexBytes()})
+        {
+          for (std::size_t offset = 0; offset < bytes.size(); offset += kPageSize)
+          {
+            checksum ^= bytes[offset];
+          }
+        }
+        [[maybe_unused]] volatile std::uint8_t sink = checksum;
+      }
+      else
+      {
+        SPDLOG_ERROR("Failed to stream {}", path.string());
+      }
+
+      std::scoped_lock lock(mutex_);
+      Asset& asset = assets_[handle];
+      if (asset.serial_ != serial)
+      {
+        continue;  // Cancelled or re-prioritized while loading, its mapping is dropped here
+      }
+      asset.state_ = AssetState::kLoaded;
+      completed_.push_back(CompletedLoad{handle, serial, std::move(file)});
+    }
+  }
+}  // namespace veng
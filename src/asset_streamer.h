@@ -0,0 +1,123 @@
+#pragma once
+
+#include <graphics.h>
+#include <mesh_file.h>
+
+namespace veng
+{
+  using AssetHandle = std::uint32_t;
+
+  struct StreamingSettings
+  {
+    // Threads blocking on the disk, kept apart from the job system so they never hold up frame work
+    std::uint32_t io_threads_ = 2;
+    // Bytes of streamed GPU data kept resident, the least recently used assets are evicted past it
+    std::uint64_t residency_budget_ = 256ull << 20;
+    // Bytes handed to the uploader per Update(), so a burst of finished loads cannot stall one frame
+    std::uint64_t upload_bytes_per_frame_ = 16ull << 20;
+    // Loads of one asset that may fail, e.g. on a transient I/O error, before requesting it again stops retrying
+    std::uint32_t max_load_attempts_ = 3;
+  };
+
+  enum class AssetState
+  {
+    kQueued,  // Waiting for an I/O thread
+    kLoading,  // Being read by an I/O thread
+    kLoaded,  // In memory, waiting for its turn to upload
+    kResident,  // Uploaded, usable by draws once the mesh's upload lands
+    kEvicted,  // Dropped for the budget, queued again by the next GetMesh()
+    // The file could not be read or is corrupt. Requesting the path again queues it again, until it has failed
+    // max_load_attempts_ times.
+    kFailed,
+  };
+
+  // Streams mesh files in the background. I/O threads read the most urgent requests first, Update() on the main
+  // thread uploads what they finished straight from the file mappings, then evicts the least recently used meshes
+  // while residency is over budget.
+  class AssetStreamer
+  {
+   public:
+    AssetStreamer(Graphics& graphics, StreamingSettings settings = NULL_STRUCT);
+    // Stops the I/O threads, resident meshes are left to the Graphics
+    ~AssetStreamer();
+
+    AssetStreamer(const AssetStreamer&) = delete;
+    AssetStreamer& operator=(const AssetStreamer&) = delete;
+
+    // Smaller priorities load first, e.g. the distance to the camera, divided down for visible objects. Requesting
+    // a path again returns its handle and keeps the more urgent priority, retrying it if it failed.
+    AssetHandle RequestMesh(const std::filesystem::path& path, float priority);
+    void SetPriority(AssetHandle asset, float priority);
+    // Drops the request whatever its state, a resident mesh is destroyed once no frame draws it. The handle is
+    // invalid afterwards.
+    void Cancel(AssetHandle asset);
+
+    // The mesh once resident, marking it used this frame. Evicted assets are queued again.
+    std::optional<MeshHandle> GetMesh(AssetHandle asset);
+    AssetState GetState(AssetHandle asset) const;
+    std::uint64_t GetResidentBytes() const { return resident_bytes_; };
+
+    // Main thread, once per frame: uploads finished loads within the frame's budget and evicts over the residency
+    // budget
+    void Update();
+
+   private:
+    struct Asset
+    {
+      std::filesystem::path path_;
+      AssetState state_ = AssetState::kQueued;
+      float priority_ = 0.0f;
+      // Bumped whenever the request changes, queue entries and loads of an older serial are stale
+      std::uint64_t serial_ = 0;
+      bool in_use_ = false;  // False once cancelled, the handle is then free
+      std::uint32_t failed_loads_ = 0;
+
+      // Main thread only
+      MeshHandle mesh_ = 0;
+      std::uint64_t size_ = 0;
+      std::uint64_t last_used_frame_ = 0;
+      std::list<AssetHandle>::iterator lru_position_;
+    };
+    struct QueueEntry
+    {
+      float priority_ = 0.0f;
+      AssetHandle asset_ = 0;
+      std::uint64_t serial_ = 0;
+
+      // std::priority_queue keeps the largest on top, the smallest priority must win
+      bool operator<(const QueueEntry& other) const { return priority_ > other.priority_; };
+    };
+    struct CompletedLoad
+    {
+      AssetHandle asset_ = 0;
+      std::uint64_t serial_ = 0;
+      std::optional<MeshFile> file_ = std::nullopt;  // std::nullopt when the load failed
+    };
+
+    void IoLoop(std::stop_token stop_token, std::uint32_t thread_index);
+    // Caller holds mutex_
+    void Enqueue(AssetHandle asset);
+    void Upload(Asset& asset, const MeshFile& file);
+    void Evict(Asset& asset);
+
+    Graphics& graphics_;
+    StreamingSettings settings_;
+
+    // Guards the assets' request fields, the queue and the completed loads
+    mutable std::mutex mutex_;
+    std::condition_variable_any work_signal_;
+    std::vector<Asset> assets_;
+    std::vector<AssetHandle> free_handles_;
+    std::unordered_map<std::string, AssetHandle> handles_by_path_;
+    std::priority_queue<QueueEntry> queue_;
+    std::deque<CompletedLoad> completed_;
+
+    // Main thread only
+    std::deque<CompletedLoad> ready_to_upload_;
+    std::list<AssetHandle> lru_;  // Resident assets, most recently used first
+    std::uint64_t resident_bytes_ = 0;
+    std::uint64_t frame_ = 0;
+
+    std::vector<std::jthread> io_threads_;
+  };
+}  // namespace veng
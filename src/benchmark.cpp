@@ -0,0 +1,186 @@
+#include <benchmark.h>
+
+namespace veng
+{
+  FrameBenchmark::FrameBenchmark(std::uint32_t warmup_frames, std::uint32_t measured_frames) :
+      warmup_frames_(warmup_frames), measured_frames_(measured_frames)
+  {
+    for (Series& series : series_)
+    {
+      series.samples_.reserve(measured_frames_);
+    }
+  }
+
+  void FrameBenchmark::BeginFrame()
+  {
+    frame_start_ = std::chrono::steady_clock::now();
+  }
+
+  void FrameBenchmark::EndFrame(const FrameTimings& timings)
+  {
+    const double cpu_frame_ms = ElapsedMilliseconds(frame_start_);
+
+    if (frame_index_ >= warmup_frames_ && !IsFinished())
+    {
+      series_[0].samples_.push_back(cpu_frame_ms);
+      series_[1].samples_.push_back(timings.fence_wait_ms_);
+      series_[2].samples_.push_back(timings.acquire_ms_);
+      series_[3].samples_.push_back(timings.present_ms_);
+      series_[4].samples_.push_back(timings.gpu_frame_ms_);
+    }
+
+    frame_index_++;
+  }
+
+  FrameBenchmark::Statistics FrameBenchmark::ComputeStatistics(gsl::span<const double> samples)
+  {
+    Statistics statistics;
+    if (samples.empty())
+    {
+      return statistics;
+    }
+
+    std::vector<double> sorted(samples.begin(), samples.end());
+    std::sort(sorted.begin(), sorted.end());
+
+    // Nearest-rank percentile
+    auto percentile = [&sorted](double p)
+    {
+      const std::size_t rank = static_cast<std::size_t>(std::ceil(p * sorted.size()));
+      return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+    };
+
+    statistics.min_ = sorted.front();
+    statistics.max_ = sorted.back();
+    statistics.mean_ = std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+    statistics.p50_ = percentile(0.50);
+    statistics.p95_ = percentile(0.95);
+    statistics.p99_ = percentile(0.99);
+
+    return statistics;
+  }
+
+  void FrameBenchmark::LogSummary() const
+  {
+    SPDLOG_INFO("Benchmark: {} warmup frames, {} measured frames", warmup_frames_, measured_frames_);
+    for (const Series& series : series_)
+    {
+      Statistics s = ComputeStatistics(series.samples_);
+      SPDLOG_INFO(
+          "{:>14} | min {:8.3f} | mean {:8.3f} | p50 {:8.3f} | p95 {:8.3f} | p99 {:8.3f} | max {:8.3f}", series.name_,
+          s.min_, s.mean_, s.p50_, s.p95_, s.p99_, s.max_);
+    }
+  }
+
+  bool FrameBenchmark::WriteReport(const std::filesystem::path& path) const
+  {
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+      SPDLOG_ERROR("Failed to open the benchmark report {}", path.string());
+      return false;
+    }
+
+    if (path.extension() == ".csv")
+    {
+      file << "metric,samples,min,mean,p50,p95,p99,max\n";
+      for (const Series& series : series_)
+      {
+        Statistics s = ComputeStatistics(series.samples_);
+        file << fmt::format(
+            "{},{},{},{},{},{},{},{}\n", series.name_, series.samples_.size(), s.min_, s.mean_, s.p50_, s.p95_, s.p99_,
+            s.max_);
+      }
+    }
+    else
+    {
+      file << fmt::format(
+          "{{\n  \"warmup_frames\": {},\n  \"measured_frames\": {},\n  \"metrics\": {{\n", warmup_frames_,
+          measured_frames_);
+      for (std::size_t i = 0; i < series_.size(); i++)
+      {
+        Statistics s = ComputeStatistics(series_[i].samples_);
+        file << fmt::format(
+            "    \"{}\": {{\"min\": {}, \"mean\": {}, \"p50\": {}, \"p95\": {}, \"p99\": {}, \"max\": {}}}{}\n",
+            series_[i].name_, s.min_, s.mean_, s.p50_, s.p95_, s.p99_, s.max_, i + 1 < series_.size() ? "," : "");
+      }
+      file << "  }\n}\n";
+    }
+
+    SPDLOG_INFO("Wrote the benchmark report to {}", path.string());
+    return true;
+  }
+
+  void RunJobScalingBenchmark(std::uint32_t max_threads, std::uint32_t repetitions)
+  {
+    // Enough math per element that the batches, not the scheduler, dominate
+    constexpr std::uint32_t kElementCount = 1 << 22;
+    constexpr std::uint32_t kMinBatchSize = 4096;
+    constexpr std::uint32_t kTinyJobCount = 100000;
+    std::vector<float> values(kElementCount);
+
+    // Doubling thread counts, always ending on max_threads
+    std::vector<std::uint32_t> thread_counts;
+    for (std::uint32_t threads = 1; threads < max_threads; threads *= 2)
+    {
+      thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    auto median_ms = [repetitions](const std::function<void()>& run)
+    {
+      run();  // Warmup
+      std::vector<double> samples;
+      for (std::uint32_t i = 0; i < repetitions; i++)
+      {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        samples.push_back(ElapsedMilliseconds(start));
+      }
+      return FrameBenchmark::ComputeStatistics(samples).p50_;
+    };
+
+    SPDLOG_INFO(
+        "Job scaling: {} elements in batches of >= {}, {} empty jobs, median of {} runs", kElementCount, kMinBatchSize,
+        kTinyJobCount, repetitions);
+    double single_thread_ms = 0.0;
+    for (std::uint32_t threads : thread_counts)
+    {
+      JobSystem jobs(threads - 1);
+
+      const double parallel_for_ms = median_ms(
+          [&]()
+          {
+            jobs.ParallelFor(
+                kElementCount, kMinBatchSize,
+                [&values](std::uint32_t begin, std::uint32_t end)
+                {
+                  for (std::uint32_t i = begin; i < end; i++)
+                  {
+                    const float x = static_cast<float>(i) * 0.001f;
+                    values[i] = std::sqrt(x) * std::sin(x) + std::cos(x * 0.5f);
+                  }
+                });
+          });
+      const double tiny_jobs_ms = median_ms(
+          [&]()
+          {
+            JobCounter counter;
+            for (std::uint32_t i = 0; i < kTinyJobCount; i++)
+            {
+              jobs.Submit([]() {}, &counter);
+            }
+            jobs.Wait(counter);
+          });
+
+      if (threads == 1)
+      {
+        single_thread_ms = parallel_for_ms;
+      }
+      const double speedup = single_thread_ms / parallel_for_ms;
+      SPDLOG_INFO(
+          "{:>3} threads | parallel_for {:8.3f}ms | speedup {:5.2f}x | efficiency {:5.1f}% | {:6.0f}ns per empty job",
+          threads, parallel_for_ms, speedup, 100.0 * speedup / threads, tiny_jobs_ms * 1e6 / kTinyJobCount);
+    }
+  }
+}  // namespace veng
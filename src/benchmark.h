@@ -0,0 +1,55 @@
+#pragma once
+
+#include <graphics.h>
+
+namespace veng
+{
+  // Records per-frame timings over a fixed amount of warmup and measured frames and reports their distribution
+  class FrameBenchmark
+  {
+   public:
+    struct Statistics
+    {
+      double min_ = 0.0;
+      double mean_ = 0.0;
+      double p50_ = 0.0;
+      double p95_ = 0.0;
+      double p99_ = 0.0;
+      double max_ = 0.0;
+    };
+
+    FrameBenchmark(std::uint32_t warmup_frames, std::uint32_t measured_frames);
+
+    // Bracket one iteration of the frame loop, warmup frames are timed but not recorded
+    void BeginFrame();
+    void EndFrame(const FrameTimings& timings);
+
+    bool IsFinished() const { return frame_index_ >= warmup_frames_ + measured_frames_; };
+    std::uint32_t GetTotalFrames() const { return warmup_frames_ + measured_frames_; };
+
+    void LogSummary() const;
+    // The format follows the extension: ".csv" writes one row per metric, anything else writes JSON
+    bool WriteReport(const std::filesystem::path& path) const;
+
+    static Statistics ComputeStatistics(gsl::span<const double> samples);
+
+   private:
+    struct Series
+    {
+      gsl::czstring name_;
+      std::vector<double> samples_;
+    };
+
+    std::array<Series, 5> series_ = {
+        Series{"cpu_frame_ms", {}}, Series{"fence_wait_ms", {}}, Series{"acquire_ms", {}},
+        Series{"present_ms", {}}, Series{"gpu_frame_ms", {}}};
+    std::chrono::steady_clock::time_point frame_start_ = NULL_STRUCT;
+    std::uint32_t warmup_frames_ = 0;
+    std::uint32_t measured_frames_ = 0;
+    std::uint32_t frame_index_ = 0;
+  };
+
+  // Runs a data-parallel and a fine-grained workload on the job system with 1 to max_threads threads and logs the
+  // speedup over a single thread
+  void RunJobScalingBenchmark(std::uint32_t max_threads, std::uint32_t repetitions);
+}  // namespace veng
@@ -0,0 +1,226 @@
+#include <bindless_table.h>
+
+namespace veng
+{
+  std::optional<BindlessIndex> BindlessTable::Slots::Acquire()
+  {
+    if (!released_.empty())
+    {
+      BindlessIndex index = released_.back();
+      released_.pop_back();
+      return index;
+    }
+    if (next_ < capacity_)
+    {
+      return next_++;
+    }
+    return std::nullopt;
+  }
+
+  BindlessTable::BindlessTable(VkPhysicalDevice physical_device, VkDevice device) : device_(device)
+  {
+    // Stay well within the update-after-bind limits, they are in the hundreds of thousands on desktop
+    VkPhysicalDeviceVulkan12Properties vulkan12_properties = NULL_STRUCT;
+    vulkan12_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties = NULL_STRUCT;
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &vulkan12_properties;
+    vkGetPhysicalDeviceProperties2(physical_device, &properties);
+
+    textures_.capacity_ = std::min(16384u, vulkan12_properties.maxDescriptorSetUpdateAfterBindSampledImages);
+    buffers_.capacity_ = std::min(16384u, vulkan12_properties.maxDescriptorSetUpdateAfterBindStorageBuffers);
+
+    CreateSamplers();
+    CreateDescriptors();
+  }
+
+  BindlessTable::~BindlessTable()
+  {
+    // Destroying the pool frees the set
+    vkDestroyDescriptorPool(device_, pool_, VK_NULL_HANDLE);
+    vkDestroyDescriptorSetLayout(device_, set_layout_, VK_NULL_HANDLE);
+    for (VkSampler sampler : samplers_)
+    {
+      vkDestroySampler(device_, sampler, VK_NULL_HANDLE);
+    }
+  }
+
+  bool BindlessTable::IsSupported(const VkPhysicalDeviceVulkan12Features& features)
+  {
+    return features.descriptorIndexing && features.runtimeDescriptorArray && features.descriptorBindingPartiallyBound &&
+           features.descriptorBindingSampledImageUpdateAfterBind &&
+           features.descriptorBindingStorageBufferUpdateAfterBind &&
+           features.descriptorBindingUpdateUnusedWhilePending &&
+           features.shaderSampledImageArrayNonUniformIndexing && features.shaderStorageBufferArrayNonUniformIndexing;
+  }
+
+  void BindlessTable::EnableFeatures(VkPhysicalDeviceVulkan12Features& features)
+  {
+    features.descriptorIndexing = VK_TRUE;
+    features.runtimeDescriptorArray = VK_TRUE;
+    features.descriptorBindingPartiallyBound = VK_TRUE;
+    features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    features.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+  }
+
+  void BindlessTable::CreateSamplers()
+  {
+    VkSamplerCreateInfo sampler_info = NULL_STRUCT;
+    sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    sampler_info.maxLod = VK_LOD_CLAMP_NONE;
+
+    std::array<VkFilter, kSamplerCount> filters = NULL_STRUCT;
+    filters[kLinearRepeatSampler] = VK_FILTER_LINEAR;
+    filters[kNearestRepeatSampler] = VK_FILTER_NEAREST;
+    for (std::uint32_t i = 0; i < kSamplerCount; i++)
+    {
+      sampler_info.magFilter = filters[i];
+      sampler_info.minFilter = filters[i];
+      sampler_info.mipmapMode =
+          filters[i] == VK_FILTER_LINEAR ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST;
+      if (vkCreateSampler(device_, &sampler_info, VK_NULL_HANDLE, &samplers_[i]) != VK_SUCCESS)
+      {
+        SPDLOG_ERROR("Failed creating a bindless sampler, exiting...");
+        std::exit(EXIT_FAILURE);
+      }
+    }
+  }
+
+  void BindlessTable::CreateDescriptors()
+  {
+    const VkShaderStageFlags stages =
+        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings = NULL_STRUCT;
+    bindings[kTextureBinding] = {
+        kTextureBinding, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, textures_.capacity_, stages, nullptr};
+    bindings[kBufferBinding] = {kBufferBinding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffers_.capacity_, stages, nullptr};
+    bindings[kSamplerBinding] = {kSamplerBinding, VK_DESCRIPTOR_TYPE_SAMPLER, kSamplerCount, stages, nullptr};
+
+    // Unwritten slots are fine as long as no shader indexes them, written ones may change while the set is bound
+    const VkDescriptorBindingFlags table_flags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                                 VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+                                                 VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+    std::array<VkDescriptorBindingFlags, 3> binding_flags = {table_flags, table_flags, 0};
+    VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info = NULL_STRUCT;
+    binding_flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    binding_flags_info.bindingCount = binding_flags.size();
+    binding_flags_info.pBindingFlags = binding_flags.data();
+
+    VkDescriptorSetLayoutCreateInfo layout_info = NULL_STRUCT;
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.pNext = &binding_flags_info;
+    layout_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layout_info.bindingCount = bindings.size();
+    layout_info.pBindings = bindings.data();
+    if (vkCreateDescriptorSetLayout(device_, &layout_info, VK_NULL_HANDLE, &set_layout_) != VK_SUCCESS)
+    {
+      SPDLOG_ERROR("Failed creating the bindless descriptor set layout, exiting...");
+      std::exit(EXIT_FAILURE);
+    }
+
+    std::array<VkDescriptorPoolSize, 3> pool_sizes = {
+        VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, textures_.capacity_},
+        VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffers_.capacity_},
+        VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_SAMPLER, kSamplerCount}};
+    VkDescriptorPoolCreateInfo pool_info = NULL_STRUCT;
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    pool_info.maxSets = 1;
+    pool_info.poolSizeCount = pool_sizes.size();
+    pool_info.pPoolSizes = pool_sizes.data();
+    if (vkCreateDescriptorPool(device_, &pool_info, VK_NULL_HANDLE, &pool_) != VK_SUCCESS)
+    {
+      SPDLOG_ERROR("Failed creating the bindless descriptor pool, exiting...");
+      std::exit(EXIT_FAILURE);
+    }
+
+    VkDescriptorSetAllocateInfo allocate_info = NULL_STRUCT;
+    allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocate_info.descriptorPool = pool_;
+    allocate_info.descriptorSetCount = 1;
+    allocate_info.pSetLayouts = &set_layout_;
+    if (vkAllocateDescriptorSets(device_, &allocate_info, &set_) != VK_SUCCESS)
+    {
+      SPDLOG_ERROR("Failed allocating the bindless descriptor set, exiting...");
+      std::exit(EXIT_FAILURE);
+    }
+
+    std::array<VkDescriptorImageInfo, kSamplerCount> sampler_infos = NULL_STRUCT;
+    for (std::uint32_t i = 0; i < kSamplerCount; i++)
+    {
+      sampler_infos[i].sampler = samplers_[i];
+    }
+    VkWriteDescriptorSet write = NULL_STRUCT;
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set_;
+    write.dstBinding = kSamplerBinding;
+    write.descriptorCount = kSamplerCount;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+    write.pImageInfo = sampler_infos.data();
+    vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+  }
+
+  BindlessIndex BindlessTable::RegisterTexture(VkImageView view)
+  {
+    std::optional<BindlessIndex> index = textures_.Acquire();
+    if (!index.has_value())
+    {
+      throw std::runtime_error("The bindless texture table is full!");
+    }
+
+    VkDescriptorImageInfo image_info = NULL_STRUCT;
+    image_info.imageView = view;
+    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkWriteDescriptorSet write = NULL_STRUCT;
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set_;
+    write.dstBinding = kTextureBinding;
+    write.dstArrayElement = *index;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    write.pImageInfo = &image_info;
+    vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+
+    return *index;
+  }
+
+  BindlessIndex BindlessTable::RegisterBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+  {
+    std::optional<BindlessIndex> index = buffers_.Acquire();
+    if (!index.has_value())
+    {
+      throw std::runtime_error("The bindless buffer table is full!");
+    }
+
+    VkDescriptorBufferInfo buffer_info = {buffer, offset, range};
+
+    VkWriteDescriptorSet write = NULL_STRUCT;
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set_;
+    write.dstBinding = kBufferBinding;
+    write.dstArrayElement = *index;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &buffer_info;
+    vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+
+    return *index;
+  }
+
+  void BindlessTable::ReleaseTexture(BindlessIndex index)
+  {
+    textures_.released_.push_back(index);
+  }
+
+  void BindlessTable::ReleaseBuffer(BindlessIndex index)
+  {
+    buffers_.released_.push_back(index);
+  }
+}  // namespace veng
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+namespace veng
+{
+  // Index of a resource in the bindless table, handed to shaders through push constants
+  using BindlessIndex = std::uint32_t;
+
+  // One large update-after-bind descriptor set (set 1) holding every sampled image and storage buffer. The set is
+  // bound once per frame, draws select their resources by index, so materials never cost a descriptor set.
+  class BindlessTable
+  {
+   public:
+    static constexpr std::uint32_t kTextureBinding = 0;
+    static constexpr std::uint32_t kBufferBinding = 1;
+    static constexpr std::uint32_t kSamplerBinding = 2;
+
+    // Fixed samplers, indexed by the shaders
+    static constexpr std::uint32_t kLinearRepeatSampler = 0;
+    static constexpr std::uint32_t kNearestRepeatSampler = 1;
+    static constexpr std::uint32_t kSamplerCount = 2;
+
+    BindlessTable(VkPhysicalDevice physical_device, VkDevice device);
+    ~BindlessTable();
+
+    BindlessTable(const BindlessTable&) = delete;
+    BindlessTable& operator=(const BindlessTable&) = delete;
+
+    // The view must be in SHADER_READ_ONLY_OPTIMAL whenever a shader reads it
+    BindlessIndex RegisterTexture(VkImageView view);
+    BindlessIndex RegisterBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+    // The slot is reused right away, callers defer this until no frame in flight can index it
+    void ReleaseTexture(BindlessIndex index);
+    void ReleaseBuffer(BindlessIndex index);
+
+    VkDescriptorSetLayout GetSetLayout() const { return set_layout_; };
+    VkDescriptorSet GetSet() const { return set_; };
+
+    // The device features the table relies on, to be chained into device creation
+    static bool IsSupported(const VkPhysicalDeviceVulkan12Features& features);
+    static void EnableFeatures(VkPhysicalDeviceVulkan12Features& features);
+
+   private:
+    // Slots of one binding, released ones are reused first
+    struct Slots
+    {
+      std::uint32_t capacity_ = 0;
+      std::uint32_t next_ = 0;
+      std::vector<BindlessIndex> released_;
+
+      std::optional<BindlessIndex> Acquire();
+    };
+
+    void CreateSamplers();
+    void CreateDescriptors();
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    VkDescriptorSetLayout set_layout_ = VK_NULL_HANDLE;
+    VkDescriptorPool pool_ = VK_NULL_HANDLE;
+    VkDescriptorSet set_ = VK_NULL_HANDLE;
+    std::array<VkSampler, kSamplerCount> samplers_ = NULL_STRUCT;
+
+    Slots textures_;
+    Slots buffers_;
+  };
+}  // namespace veng
@@ -0,0 +1,28 @@
+#include <deletion_queue.h>
+
+namespace veng
+{
+  void DeletionQueue::Push(std::uint64_t frame, std::function<void()> deleter)
+  {
+    deleters_.emplace_back(frame, std::move(deleter));
+  }
+
+  void DeletionQueue::Flush(std::uint64_t retired_frame)
+  {
+    // Frames are pushed in increasing order, so the front is always the oldest
+    while (!deleters_.empty() && deleters_.front().first <= retired_frame)
+    {
+      deleters_.front().second();
+      deleters_.pop_front();
+    }
+  }
+
+  void DeletionQueue::FlushAll()
+  {
+    for (auto& [frame, deleter] : deleters_)
+    {
+      deleter();
+    }
+    deleters_.clear();
+  }
+}  // namespace veng
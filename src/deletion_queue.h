@@ -0,0 +1,19 @@
+#pragma once
+
+namespace veng
+{
+  // Defers the destruction of GPU objects until every frame that may still reference them has retired
+  class DeletionQueue
+  {
+   public:
+    // The deleter runs once the given frame has retired
+    void Push(std::uint64_t frame, std::function<void()> deleter);
+    // Runs the deleters of every frame up to and including retired_frame
+    void Flush(std::uint64_t retired_frame);
+    // Runs everything, the device must be idle
+    void FlushAll();
+
+   private:
+    std::deque<std::pair<std::uint64_t, std::function<void()>>> deleters_;
+  };
+}  // namespace veng
@@ -5,7 +5,7 @@ namespace veng
 {
   Window::Window(gsl::czstring name, glm::ivec2 size)
   {
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 
     window_ = glfwCreateWindow(size.x, size.y, name, nullptr, nullptr);
@@ -13,6 +13,9 @@ namespace veng
     {
       std::exit(EXIT_FAILURE);
     }
+
+    glfwSetWindowUserPointer(window_, this);
+    glfwSetFramebufferSizeCallback(window_, FramebufferResizeCallback);
   }
   Window::~Window()
   {
@@ -48,4 +51,14 @@ namespace veng
     }
     return false;
   }
+  bool Window::ConsumeFramebufferResized()
+  {
+    return std::exchange(framebuffer_resized_, false);
+  }
+  void Window::FramebufferResizeCallback(
+      GLFWwindow* handle, [[maybe_unused]] std::int32_t width, [[maybe_unused]] std::int32_t height)
+  {
+    Window* window = static_cast<Window*>(glfwGetWindowUserPointer(handle));
+    window->framebuffer_resized_ = true;
+  }
 }  // namespace veng
@@ -8,13 +8,22 @@ namespace veng
     Window(gsl::czstring name, glm::ivec2 size);
     ~Window();
 
+    // GLFW keeps a pointer to this object for its callbacks
+    Window(const Window&) = delete;
+    Window& operator=(const Window&) = delete;
+
     glm::ivec2 GetWindowSize() const;
     glm::ivec2 getFrameBufferSize() const;
     bool ShouldClose() const;
     GLFWwindow* GetHandle() const;
     bool TryMoveToMonitor(std::uint16_t monitor_number) const;
+    // Returns whether the framebuffer was resized since the last call
+    bool ConsumeFramebufferResized();
 
    private:
+    static void FramebufferResizeCallback(GLFWwindow* handle, std::int32_t width, std::int32_t height);
+
     GLFWwindow* window_;
+    bool framebuffer_resized_ = false;
   };
 }  // namespace veng
@@ -0,0 +1,498 @@
+#include <gpu_allocator.h>
+
+namespace veng
+{
+  GpuAllocator::GpuAllocator(
+      VkPhysicalDevice physical_device, VkDevice device, std::uint32_t frames_in_flight, VkDeviceSize block_size,
+      VkDeviceSize transient_block_size) :
+      device_(device), block_size_(block_size), transient_block_size_(transient_block_size)
+  {
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties_);
+
+    VkPhysicalDeviceProperties properties = NULL_STRUCT;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    buffer_image_granularity_ = properties.limits.bufferImageGranularity;
+    max_allocation_count_ = properties.limits.maxMemoryAllocationCount;
+
+    transient_pools_.resize(frames_in_flight);
+  }
+
+  GpuAllocator::~GpuAllocator()
+  {
+    for (Pool& pool : pools_)
+    {
+      for (Block& block : pool.blocks_)
+      {
+        if (block.memory_ == VK_NULL_HANDLE)
+        {
+          continue;
+        }
+        if (block.allocator_ != nullptr && !block.allocator_->IsEmpty())
+        {
+          SPDLOG_WARN("Destroying a memory block with {} live allocations", block.allocator_->GetAllocationCount());
+        }
+        FreeDeviceMemory(block.memory_);
+      }
+    }
+    for (std::vector<LinearPool>& frame_pools : transient_pools_)
+    {
+      for (LinearPool& pool : frame_pools)
+      {
+        for (LinearBlock& block : pool.blocks_)
+        {
+          FreeDeviceMemory(block.memory_);
+        }
+      }
+    }
+  }
+
+  std::uint32_t GpuAllocator::FindMemoryType(std::uint32_t type_filter, MemoryUsage usage) const
+  {
+    VkMemoryPropertyFlags required = 0;
+    VkMemoryPropertyFlags preferred = 0;
+    VkMemoryPropertyFlags avoided = 0;
+    switch (usage)
+    {
+    case MemoryUsage::kGpuOnly:
+      required = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+      avoided = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+      break;
+    case MemoryUsage::kCpuToGpu:
+      required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+      avoided = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+      break;
+    case MemoryUsage::kGpuToCpu:
+      required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+      preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+      break;
+    }
+
+    // Memory types are ordered by the driver from best to worst, keep the first one with the best score
+    std::uint32_t best_type = ~0u;
+    std::int32_t best_score = -1;
+    for (std::uint32_t i = 0; i < memory_properties_.memoryTypeCount; i++)
+    {
+      const VkMemoryPropertyFlags flags = memory_properties_.memoryTypes[i].propertyFlags;
+      if (!(type_filter & (1u << i)) || (flags & required) != required)
+      {
+        continue;
+      }
+
+      const std::int32_t score = std::popcount(flags & preferred) * 2 + (std::popcount(flags & avoided) == 0 ? 1 : 0);
+      if (score > best_score)
+      {
+        best_type = i;
+        best_score = score;
+      }
+    }
+
+    return best_type;
+  }
+
+  VkDeviceMemory GpuAllocator::AllocateDeviceMemory(
+      std::uint32_t memory_type, VkDeviceSize size, std::uint8_t*& mapped)
+  {
+    if (device_allocation_count_ >= max_allocation_count_)
+    {
+      SPDLOG_ERROR("Reached maxMemoryAllocationCount ({})", max_allocation_count_);
+      return VK_NULL_HANDLE;
+    }
+
+    VkMemoryAllocateInfo allocate_info = NULL_STRUCT;
+    allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.allocationSize = size;
+    allocate_info.memoryTypeIndex = memory_type;
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    if (vkAllocateMemory(device_, &allocate_info, VK_NULL_HANDLE, &memory) != VK_SUCCESS)
+    {
+      SPDLOG_ERROR("Failed allocating {} bytes of device memory from type {}", size, memory_type);
+      return VK_NULL_HANDLE;
+    }
+    device_allocation_count_++;
+
+    // Host visible blocks stay mapped for their whole life
+    mapped = nullptr;
+    if (memory_properties_.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+      void* pointer = nullptr;
+      if (vkMapMemory(device_, memory, 0, VK_WHOLE_SIZE, 0, &pointer) != VK_SUCCESS)
+      {
+        SPDLOG_ERROR("Failed mapping a host visible memory block");
+        FreeDeviceMemory(memory);
+        return VK_NULL_HANDLE;
+      }
+      mapped = static_cast<std::uint8_t*>(pointer);
+    }
+
+    SPDLOG_DEBUG("Allocated a {} KiB device memory block from type {}", size / 1024, memory_type);
+    return memory;
+  }
+
+  void GpuAllocator::FreeDeviceMemory(VkDeviceMemory memory)
+  {
+    // Freeing implicitly unmaps
+    vkFreeMemory(device_, memory, VK_NULL_HANDLE);
+    device_allocation_count_--;
+  }
+
+  std::uint32_t GpuAllocator::GetPoolIndex(std::uint32_t memory_type, ResourceKind kind)
+  {
+    for (std::uint32_t i = 0; i < pools_.size(); i++)
+    {
+      if (pools_[i].memory_type_ == memory_type && pools_[i].kind_ == kind)
+      {
+        return i;
+      }
+    }
+
+    Pool& pool = pools_.emplace_back();
+    pool.memory_type_ = memory_type;
+    pool.kind_ = kind;
+    return static_cast<std::uint32_t>(pools_.size() - 1);
+  }
+
+  Allocation GpuAllocator::Allocate(const VkMemoryRequirements& requirements, MemoryUsage usage, ResourceKind kind)
+  {
+    const std::uint32_t memory_type = FindMemoryType(requirements.memoryTypeBits, usage);
+    if (memory_type == ~0u)
+    {
+      SPDLOG_ERROR("No memory type matches the requested usage");
+      return NULL_STRUCT;
+    }
+
+    std::scoped_lock lock(mutex_);
+    const std::uint32_t pool_index = GetPoolIndex(memory_type, kind);
+    Pool& pool = pools_[pool_index];
+
+    // Small heaps (e.g. the host visible part of VRAM) get proportionally smaller blocks
+    const VkDeviceSize heap_size =
+        memory_properties_.memoryHeaps[memory_properties_.memoryTypes[memory_type].heapIndex].size;
+    const VkDeviceSize block_size = std::min(block_size_, heap_size / 8);
+
+    Allocation allocation;
+    allocation.pool_ = pool_index;
+    allocation.size_ = requirements.size;
+
+    // Large resources get a block of their own rather than fragmenting the shared ones
+    const bool dedicated = requirements.size > block_size / 2;
+    if (!dedicated)
+    {
+      for (std::uint32_t i = 0; i < pool.blocks_.size(); i++)
+      {
+        Block& block = pool.blocks_[i];
+        if (block.memory_ == VK_NULL_HANDLE || block.dedicated_)
+        {
+          continue;
+        }
+        const std::uint64_t offset = block.allocator_->Allocate(requirements.size, requirements.alignment);
+        if (offset != TlsfAllocator::kInvalidOffset)
+        {
+          allocation.memory_ = block.memory_;
+          allocation.offset_ = offset;
+          allocation.mapped_ = block.mapped_ != nullptr ? block.mapped_ + offset : nullptr;
+          allocation.block_ = i;
+          return allocation;
+        }
+      }
+    }
+
+    // Reuse the slot of a released block so the indices held by live allocations stay valid
+    Block block;
+    block.dedicated_ = dedicated;
+    const VkDeviceSize size = dedicated ? requirements.size : block_size;
+    block.size_ = size;
+    block.memory_ = AllocateDeviceMemory(memory_type, size, block.mapped_);
+    if (block.memory_ == VK_NULL_HANDLE)
+    {
+      return NULL_STRUCT;
+    }
+    if (!dedicated)
+    {
+      block.allocator_ = std::make_unique<TlsfAllocator>(size);
+      allocation.offset_ = block.allocator_->Allocate(requirements.size, requirements.alignment);
+    }
+
+    auto free_slot = std::find_if(
+        pool.blocks_.begin(), pool.blocks_.end(),
+        [](const Block& candidate)
+        {
+          return candidate.memory_ == VK_NULL_HANDLE;
+        });
+    if (free_slot == pool.blocks_.end())
+    {
+      free_slot = pool.blocks_.insert(pool.blocks_.end(), Block());
+    }
+    *free_slot = std::move(block);
+
+    allocation.memory_ = free_slot->memory_;
+    allocation.mapped_ = free_slot->mapped_ != nullptr ? free_slot->mapped_ + allocation.offset_ : nullptr;
+    allocation.block_ = static_cast<std::uint32_t>(free_slot - pool.blocks_.begin());
+    return allocation;
+  }
+
+  void GpuAllocator::Free(Allocation& allocation)
+  {
+    if (!allocation.IsValid())
+    {
+      return;
+    }
+    if (allocation.transient_)
+    {
+      // Transient memory is reclaimed all at once by BeginFrame()
+      allocation = NULL_STRUCT;
+      return;
+    }
+
+    std::scoped_lock lock(mutex_);
+    Pool& pool = pools_[allocation.pool_];
+    Block& block = pool.blocks_[allocation.block_];
+
+    bool release = block.dedicated_;
+    if (!block.dedicated_)
+    {
+      block.allocator_->Free(allocation.offset_);
+      // Keep one empty block around per pool so a free/allocate pair at the boundary does not thrash vkAllocateMemory
+      if (block.allocator_->IsEmpty())
+      {
+        release = std::any_of(
+            pool.blocks_.begin(), pool.blocks_.end(),
+            [&block](const Block& other)
+            {
+              return &other != &block && other.memory_ != VK_NULL_HANDLE && !other.dedicated_ &&
+                     other.allocator_->IsEmpty();
+            });
+      }
+    }
+
+    if (release)
+    {
+      FreeDeviceMemory(block.memory_);
+      block = Block();
+    }
+    allocation = NULL_STRUCT;
+  }
+
+  Allocation GpuAllocator::AllocateTransient(
+      const VkMemoryRequirements& requirements, MemoryUsage usage, ResourceKind kind)
+  {
+    const std::uint32_t memory_type = FindMemoryType(requirements.memoryTypeBits, usage);
+    if (memory_type == ~0u)
+    {
+      SPDLOG_ERROR("No memory type matches the requested usage");
+      return NULL_STRUCT;
+    }
+
+    std::vector<LinearPool>& frame_pools = transient_pools_[current_frame_];
+    auto pool = std::find_if(
+        frame_pools.begin(), frame_pools.end(),
+        [memory_type](const LinearPool& candidate)
+        {
+          return candidate.memory_type_ == memory_type;
+        });
+    if (pool == frame_pools.end())
+    {
+      pool = frame_pools.insert(frame_pools.end(), LinearPool());
+      pool->memory_type_ = memory_type;
+    }
+
+    // Buffers and images may sit in the same linear block, so switching kinds starts a new granularity page
+    auto try_allocate = [&](LinearBlock& block) -> std::optional<VkDeviceSize>
+    {
+      VkDeviceSize alignment = requirements.alignment;
+      if (block.head_ > 0 && block.last_kind_ != kind)
+      {
+        alignment = std::max(alignment, buffer_image_granularity_);
+      }
+      const VkDeviceSize offset = AlignUp(block.head_, alignment);
+      if (offset + requirements.size > block.size_)
+      {
+        return std::nullopt;
+      }
+      block.head_ = offset + requirements.size;
+      block.last_kind_ = kind;
+      return offset;
+    };
+
+    std::optional<VkDeviceSize> offset;
+    while (pool->current_ < pool->blocks_.size())
+    {
+      offset = try_allocate(pool->blocks_[pool->current_]);
+      if (offset.has_value())
+      {
+        break;
+      }
+      pool->current_++;
+    }
+    if (!offset.has_value())
+    {
+      LinearBlock block;
+      block.size_ = std::max(transient_block_size_, requirements.size);
+      block.memory_ = AllocateDeviceMemory(memory_type, block.size_, block.mapped_);
+      if (block.memory_ == VK_NULL_HANDLE)
+      {
+        return NULL_STRUCT;
+      }
+      pool->blocks_.push_back(block);
+      pool->current_ = static_cast<std::uint32_t>(pool->blocks_.size() - 1);
+      offset = try_allocate(pool->blocks_.back());
+    }
+
+    const LinearBlock& block = pool->blocks_[pool->current_];
+    Allocation allocation;
+    allocation.memory_ = block.memory_;
+    allocation.offset_ = *offset;
+    allocation.size_ = requirements.size;
+    allocation.mapped_ = block.mapped_ != nullptr ? block.mapped_ + *offset : nullptr;
+    allocation.transient_ = true;
+    return allocation;
+  }
+
+  void GpuAllocator::BeginFrame(std::uint32_t frame_index)
+  {
+    current_frame_ = frame_index;
+    for (LinearPool& pool : transient_pools_[current_frame_])
+    {
+      for (LinearBlock& block : pool.blocks_)
+      {
+        block.head_ = 0;
+      }
+      pool.current_ = 0;
+    }
+  }
+
+  Buffer GpuAllocator::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, MemoryUsage memory_usage)
+  {
+    VkBufferCreateInfo info = NULL_STRUCT;
+    info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    info.size = size;
+    info.usage = usage;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    Buffer buffer;
+    if (vkCreateBuffer(device_, &info, VK_NULL_HANDLE, &buffer.buffer_) != VK_SUCCESS)
+    {
+      SPDLOG_ERROR("Failed creating a buffer of {} bytes", size);
+      return NULL_STRUCT;
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device_, buffer.buffer_, &requirements);
+    buffer.allocation_ = Allocate(requirements, memory_usage, ResourceKind::kBuffer);
+    if (!buffer.allocation_.IsValid())
+    {
+      vkDestroyBuffer(device_, buffer.buffer_, VK_NULL_HANDLE);
+      return NULL_STRUCT;
+    }
+    vkBindBufferMemory(device_, buffer.buffer_, buffer.allocation_.memory_, buffer.allocation_.offset_);
+
+    return buffer;
+  }
+
+  void GpuAllocator::DestroyBuffer(Buffer& buffer)
+  {
+    if (buffer.buffer_ != VK_NULL_HANDLE)
+    {
+      vkDestroyBuffer(device_, buffer.buffer_, VK_NULL_HANDLE);
+    }
+    Free(buffer.allocation_);
+    buffer = NULL_STRUCT;
+  }
+
+  Image GpuAllocator::CreateImage(const VkImageCreateInfo& info, MemoryUsage memory_usage)
+  {
+    Image image;
+    if (vkCreateImage(device_, &info, VK_NULL_HANDLE, &image.image_) != VK_SUCCESS)
+    {
+      SPDLOG_ERROR("Failed creating an image of {}x{}", info.extent.width, info.extent.height);
+      return NULL_STRUCT;
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(device_, image.image_, &requirements);
+    // Linear images follow the same granularity rules as buffers
+    const ResourceKind kind = info.tiling == VK_IMAGE_TILING_LINEAR ? ResourceKind::kBuffer : ResourceKind::kImage;
+    image.allocation_ = Allocate(requirements, memory_usage, kind);
+    if (!image.allocation_.IsValid())
+    {
+      vkDestroyImage(device_, image.image_, VK_NULL_HANDLE);
+      return NULL_STRUCT;
+    }
+    vkBindImageMemory(device_, image.image_, image.allocation_.memory_, image.allocation_.offset_);
+
+    return image;
+  }
+
+  void GpuAllocator::DestroyImage(Image& image)
+  {
+    if (image.image_ != VK_NULL_HANDLE)
+    {
+      vkDestroyImage(device_, image.image_, VK_NULL_HANDLE);
+    }
+    Free(image.allocation_);
+    image = NULL_STRUCT;
+  }
+
+  GpuMemoryStats GpuAllocator::GetStats() const
+  {
+    std::scoped_lock lock(mutex_);
+
+    GpuMemoryStats stats;
+    VkDeviceSize pooled_free_bytes = 0;
+    for (const Pool& pool : pools_)
+    {
+      for (const Block& block : pool.blocks_)
+      {
+        if (block.memory_ == VK_NULL_HANDLE)
+        {
+          continue;
+        }
+        stats.block_count_++;
+        if (block.dedicated_)
+        {
+          stats.allocation_count_++;
+          stats.reserved_bytes_ += block.size_;
+          stats.used_bytes_ += block.size_;
+          continue;
+        }
+        stats.allocation_count_ += block.allocator_->GetAllocationCount();
+        stats.reserved_bytes_ += block.allocator_->GetSize();
+        stats.used_bytes_ += block.allocator_->GetUsedSize();
+        pooled_free_bytes += block.allocator_->GetSize() - block.allocator_->GetUsedSize();
+        stats.largest_free_region_ = std::max(stats.largest_free_region_, block.allocator_->GetLargestFreeRegion());
+      }
+    }
+    for (const std::vector<LinearPool>& frame_pools : transient_pools_)
+    {
+      for (const LinearPool& pool : frame_pools)
+      {
+        for (const LinearBlock& block : pool.blocks_)
+        {
+          stats.block_count_++;
+          stats.reserved_bytes_ += block.size_;
+          stats.used_bytes_ += block.head_;
+        }
+      }
+    }
+
+    stats.free_bytes_ = stats.reserved_bytes_ - stats.used_bytes_;
+    if (pooled_free_bytes > 0)
+    {
+      stats.fragmentation_ = 1.0 - static_cast<double>(stats.largest_free_region_) / pooled_free_bytes;
+    }
+    if (stats.reserved_bytes_ > 0)
+    {
+      stats.utilization_ = static_cast<double>(stats.used_bytes_) / stats.reserved_bytes_;
+    }
+    return stats;
+  }
+
+  void GpuAllocator::LogStats() const
+  {
+    GpuMemoryStats stats = GetStats();
+    SPDLOG_INFO(
+        "GPU memory: {} blocks, {} allocations, {:.2f}/{:.2f} MiB used ({:.1f}%), fragmentation {:.1f}%",
+        stats.block_count_, stats.allocation_count_, stats.used_bytes_ / 1048576.0,
+        stats.reserved_bytes_ / 1048576.0, stats.utilization_ * 100.0, stats.fragmentation_ * 100.0);
+  }
+}  // namespace veng
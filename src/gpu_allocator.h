@@ -0,0 +1,144 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <tlsf_allocator.h>
+
+namespace veng
+{
+  // What the memory is accessed by, decides the memory type
+  enum class MemoryUsage
+  {
+    kGpuOnly,  // Device local, written through transfers
+    kCpuToGpu,  // Host visible and coherent, persistently mapped
+    kGpuToCpu  // Host visible and coherent, preferably cached, for readbacks
+  };
+
+  // Linear resources (buffers) and optimal-tiling images never share a block, which keeps
+  // bufferImageGranularity from ever applying between neighbours
+  enum class ResourceKind
+  {
+    kBuffer,
+    kImage
+  };
+
+  struct Allocation
+  {
+    VkDeviceMemory memory_ = VK_NULL_HANDLE;
+    VkDeviceSize offset_ = 0;
+    VkDeviceSize size_ = 0;
+    std::uint8_t* mapped_ = nullptr;  // nullptr unless host visible
+    std::uint32_t pool_ = 0;
+    std::uint32_t block_ = 0;
+    bool transient_ = false;
+
+    bool IsValid() const { return memory_ != VK_NULL_HANDLE; };
+  };
+
+  struct Buffer
+  {
+    VkBuffer buffer_ = VK_NULL_HANDLE;
+    Allocation allocation_ = NULL_STRUCT;
+  };
+
+  struct Image
+  {
+    VkImage image_ = VK_NULL_HANDLE;
+    Allocation allocation_ = NULL_STRUCT;
+  };
+
+  struct GpuMemoryStats
+  {
+    std::uint32_t block_count_ = 0;
+    std::uint32_t allocation_count_ = 0;
+    VkDeviceSize reserved_bytes_ = 0;
+    VkDeviceSize used_bytes_ = 0;
+    VkDeviceSize free_bytes_ = 0;
+    VkDeviceSize largest_free_region_ = 0;
+    // 0 when all free space is one region, close to 1 when it is scattered in small pieces
+    double fragmentation_ = 0.0;
+    double utilization_ = 0.0;
+  };
+
+  // Carves large VkDeviceMemory blocks into resources. Long-lived resources use TLSF blocks,
+  // per-frame transient ones bump through a linear block that is reset when the frame comes around again.
+  class GpuAllocator
+  {
+   public:
+    GpuAllocator(
+        VkPhysicalDevice physical_device, VkDevice device, std::uint32_t frames_in_flight,
+        VkDeviceSize block_size = 64ull << 20, VkDeviceSize transient_block_size = 8ull << 20);
+    ~GpuAllocator();
+
+    GpuAllocator(const GpuAllocator&) = delete;
+    GpuAllocator& operator=(const GpuAllocator&) = delete;
+
+    // Long-lived allocations, thread safe. Returns an invalid allocation on failure.
+    Allocation Allocate(const VkMemoryRequirements& requirements, MemoryUsage usage, ResourceKind kind);
+    void Free(Allocation& allocation);
+
+    // Transient allocations, valid until the same frame slot begins again. Render thread only.
+    Allocation AllocateTransient(const VkMemoryRequirements& requirements, MemoryUsage usage, ResourceKind kind);
+    // Releases the transient memory of the slot, its previous frame must have retired
+    void BeginFrame(std::uint32_t frame_index);
+
+    // Creates the resource and binds it to new memory, the handle is VK_NULL_HANDLE on failure
+    Buffer CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, MemoryUsage memory_usage);
+    void DestroyBuffer(Buffer& buffer);
+    Image CreateImage(const VkImageCreateInfo& info, MemoryUsage memory_usage);
+    void DestroyImage(Image& image);
+
+    std::uint32_t FindMemoryType(std::uint32_t type_filter, MemoryUsage usage) const;
+    GpuMemoryStats GetStats() const;
+    void LogStats() const;
+
+   private:
+    struct Block
+    {
+      VkDeviceMemory memory_ = VK_NULL_HANDLE;
+      std::uint8_t* mapped_ = nullptr;
+      VkDeviceSize size_ = 0;
+      std::unique_ptr<TlsfAllocator> allocator_ = nullptr;  // nullptr for dedicated blocks
+      bool dedicated_ = false;
+    };
+    // Blocks of one memory type and resource kind
+    struct Pool
+    {
+      std::uint32_t memory_type_ = 0;
+      ResourceKind kind_ = ResourceKind::kBuffer;
+      std::vector<Block> blocks_;
+    };
+    struct LinearBlock
+    {
+      VkDeviceMemory memory_ = VK_NULL_HANDLE;
+      std::uint8_t* mapped_ = nullptr;
+      VkDeviceSize size_ = 0;
+      VkDeviceSize head_ = 0;
+      ResourceKind last_kind_ = ResourceKind::kBuffer;
+    };
+    // Transient blocks of one memory type for one frame slot, grown on demand and rewound every frame
+    struct LinearPool
+    {
+      std::uint32_t memory_type_ = 0;
+      std::vector<LinearBlock> blocks_;
+      std::uint32_t current_ = 0;
+    };
+
+    VkDeviceMemory AllocateDeviceMemory(std::uint32_t memory_type, VkDeviceSize size, std::uint8_t*& mapped);
+    void FreeDeviceMemory(VkDeviceMemory memory);
+    std::uint32_t GetPoolIndex(std::uint32_t memory_type, ResourceKind kind);
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memory_properties_ = NULL_STRUCT;
+    VkDeviceSize buffer_image_granularity_ = 1;
+    std::uint32_t max_allocation_count_ = 0;
+    VkDeviceSize block_size_ = 0;
+    VkDeviceSize transient_block_size_ = 0;
+
+    mutable std::mutex mutex_;
+    std::vector<Pool> pools_;
+    std::atomic<std::uint32_t> device_allocation_count_ = 0;
+
+    std::vector<std::vector<LinearPool>> transient_pools_;  // [frame slot][pool]
+    std::uint32_t current_frame_ = 0;
+  };
+}  // namespace veng
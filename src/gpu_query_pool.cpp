@@ -0,0 +1,212 @@
+#include <gpu_query_pool.h>
+
+namespace veng
+{
+  // Written in this bit order by the device, matching the fields of PipelineStatistics
+  static constexpr VkQueryPipelineStatisticFlags kStatisticsFlags =
+      VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+  static constexpr std::uint32_t kStatisticsCount = 6;
+
+  GpuQueryPool::GpuQueryPool(
+      VkPhysicalDevice physical_device, VkDevice device, std::uint32_t queue_family, std::uint32_t frames_in_flight,
+      bool statistics_enabled) :
+      device_(device), frames_(frames_in_flight)
+  {
+    VkPhysicalDeviceProperties properties = NULL_STRUCT;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    timestamp_period_ns_ = properties.limits.timestampPeriod;
+
+    std::uint32_t family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, nullptr);
+    std::vector<VkQueueFamilyProperties> families(family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count, families.data());
+    const std::uint32_t valid_bits = families[queue_family].timestampValidBits;
+    timestamp_mask_ = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+    statistics_flags_ = statistics_enabled ? kStatisticsFlags : 0;
+
+    if (timestamp_mask_ == 0)
+    {
+      SPDLOG_WARN("The graphics queue does not support timestamps, GPU scopes will stay empty");
+    }
+
+    for (FrameQueries& frame : frames_)
+    {
+      VkQueryPoolCreateInfo timestamp_info = NULL_STRUCT;
+      timestamp_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+      timestamp_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+      timestamp_info.queryCount = kMaxScopes * 2;
+      if (vkCreateQueryPool(device_, &timestamp_info, VK_NULL_HANDLE, &frame.timestamps_) != VK_SUCCESS)
+      {
+        SPDLOG_ERROR("Failed creating the timestamp query pool, exiting...");
+        std::exit(EXIT_FAILURE);
+      }
+
+      if (statistics_flags_ != 0)
+      {
+        VkQueryPoolCreateInfo statistics_info = NULL_STRUCT;
+        statistics_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        statistics_info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        statistics_info.queryCount = 1;
+        statistics_info.pipelineStatistics = statistics_flags_;
+        if (vkCreateQueryPool(device_, &statistics_info, VK_NULL_HANDLE, &frame.statistics_) != VK_SUCCESS)
+        {
+          SPDLOG_ERROR("Failed creating the pipeline statistics query pool, exiting...");
+          std::exit(EXIT_FAILURE);
+        }
+      }
+      frame.scope_names_.reserve(kMaxScopes);
+    }
+  }
+
+  GpuQueryPool::~GpuQueryPool()
+  {
+    for (FrameQueries& frame : frames_)
+    {
+      vkDestroyQueryPool(device_, frame.timestamps_, VK_NULL_HANDLE);
+      vkDestroyQueryPool(device_, frame.statistics_, VK_NULL_HANDLE);
+    }
+  }
+
+  bool GpuQueryPool::IsStatisticsSupported(const VkPhysicalDeviceFeatures& features)
+  {
+    return features.pipelineStatisticsQuery && features.inheritedQueries;
+  }
+
+  void GpuQueryPool::EnableFeatures(VkPhysicalDeviceFeatures& features)
+  {
+    features.pipelineStatisticsQuery = VK_TRUE;
+    features.inheritedQueries = VK_TRUE;
+  }
+
+  void GpuQueryPool::BeginFrame(std::uint32_t frame_index, VkCommandBuffer command_buffer)
+  {
+    current_ = &frames_[frame_index];
+    if (current_->pending_)
+    {
+      ReadResults(*current_);
+    }
+
+    vkCmdResetQueryPool(command_buffer, current_->timestamps_, 0, kMaxScopes * 2);
+    if (current_->statistics_ != VK_NULL_HANDLE)
+    {
+      vkCmdResetQueryPool(command_buffer, current_->statistics_, 0, 1);
+    }
+    current_->scope_names_.clear();
+    current_->statistics_written_ = false;
+    current_->pending_ = true;
+  }
+
+  std::uint32_t GpuQueryPool::BeginScope(VkCommandBuffer command_buffer, gsl::czstring name)
+  {
+    if (timestamp_mask_ == 0 || current_->scope_names_.size() >= kMaxScopes)
+    {
+      return kInvalidScope;
+    }
+
+    const std::uint32_t scope = static_cast<std::uint32_t>(current_->scope_names_.size());
+    current_->scope_names_.push_back(name);
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, current_->timestamps_, scope * 2);
+    return scope;
+  }
+
+  void GpuQueryPool::EndScope(VkCommandBuffer command_buffer, std::uint32_t scope)
+  {
+    if (scope == kInvalidScope)
+    {
+      return;
+    }
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, current_->timestamps_, scope * 2 + 1);
+  }
+
+  void GpuQueryPool::BeginStatistics(VkCommandBuffer command_buffer)
+  {
+    if (current_->statistics_ != VK_NULL_HANDLE)
+    {
+      vkCmdBeginQuery(command_buffer, current_->statistics_, 0, 0);
+    }
+  }
+
+  void GpuQueryPool::EndStatistics(VkCommandBuffer command_buffer)
+  {
+    if (current_->statistics_ != VK_NULL_HANDLE)
+    {
+      vkCmdEndQuery(command_buffer, current_->statistics_, 0);
+      current_->statistics_written_ = true;
+    }
+  }
+
+  void GpuQueryPool::ReadResults(FrameQueries& frame)
+  {
+    frame.pending_ = false;
+    results_.scopes_.clear();
+    results_.frame_ms_ = 0.0;
+    results_.statistics_.reset();
+
+    // Each query comes with its availability, a scope that was never ended is simply skipped
+    const std::uint32_t query_count = static_cast<std::uint32_t>(frame.scope_names_.size()) * 2;
+    if (query_count > 0)
+    {
+      std::array<std::uint64_t, kMaxScopes * 4> data = NULL_STRUCT;
+      vkGetQueryPoolResults(
+          device_, frame.timestamps_, 0, query_count, query_count * 2 * sizeof(std::uint64_t), data.data(),
+          2 * sizeof(std::uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+      std::uint64_t first = std::numeric_limits<std::uint64_t>::max();
+      std::uint64_t last = 0;
+      for (std::uint32_t scope = 0; scope < frame.scope_names_.size(); scope++)
+      {
+        const std::uint64_t* begin = &data[scope * 4];
+        const std::uint64_t* end = &data[scope * 4 + 2];
+        if (begin[1] == 0 || end[1] == 0)
+        {
+          continue;
+        }
+        const std::uint64_t begin_ticks = begin[0] & timestamp_mask_;
+        const std::uint64_t end_ticks = std::max(end[0] & timestamp_mask_, begin_ticks);
+        first = std::min(first, begin_ticks);
+        last = std::max(last, end_ticks);
+        results_.scopes_.push_back(GpuScopeTiming{
+            frame.scope_names_[scope], static_cast<double>(end_ticks - begin_ticks) * timestamp_period_ns_ / 1e6});
+      }
+      if (last > first)
+      {
+        results_.frame_ms_ = static_cast<double>(last - first) * timestamp_period_ns_ / 1e6;
+      }
+    }
+
+    if (frame.statistics_written_)
+    {
+      std::array<std::uint64_t, kStatisticsCount + 1> data = NULL_STRUCT;
+      vkGetQueryPoolResults(
+          device_, frame.statistics_, 0, 1, sizeof(data), data.data(), sizeof(data),
+          VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+      if (data[kStatisticsCount] != 0)
+      {
+        results_.statistics_ = PipelineStatistics{data[0], data[1], data[2], data[3], data[4], data[5]};
+      }
+    }
+  }
+
+  void GpuQueryPool::LogResults() const
+  {
+    SPDLOG_INFO("GPU frame: {:.3f}ms", results_.frame_ms_);
+    for (const GpuScopeTiming& scope : results_.scopes_)
+    {
+      SPDLOG_INFO("{:>20} | {:8.3f}ms", scope.name_, scope.milliseconds_);
+    }
+    if (results_.statistics_.has_value())
+    {
+      const PipelineStatistics& statistics = *results_.statistics_;
+      SPDLOG_INFO(
+          "Input vertices {} | input primitives {} | primitives after clipping {} | vertex invocations {} | "
+          "fragment invocations {} | compute invocations {}",
+          statistics.input_vertices_, statistics.input_primitives_, statistics.clipping_primitives_,
+          statistics.vertex_shader_invocations_, statistics.fragment_shader_invocations_,
+          statistics.compute_shader_invocations_);
+    }
+  }
+}  // namespace veng
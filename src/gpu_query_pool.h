@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+namespace veng
+{
+  struct GpuScopeTiming
+  {
+    gsl::czstring name_ = nullptr;
+    double milliseconds_ = 0.0;
+  };
+
+  // Counted between BeginStatistics() and EndStatistics()
+  struct PipelineStatistics
+  {
+    std::uint64_t input_vertices_ = 0;
+    std::uint64_t input_primitives_ = 0;
+    std::uint64_t vertex_shader_invocations_ = 0;
+    std::uint64_t clipping_primitives_ = 0;
+    std::uint64_t fragment_shader_invocations_ = 0;
+    std::uint64_t compute_shader_invocations_ = 0;
+  };
+
+  struct GpuFrameResults
+  {
+    std::vector<GpuScopeTiming> scopes_;
+    // From the first timestamp of the frame to the last one
+    double frame_ms_ = 0.0;
+    std::optional<PipelineStatistics> statistics_ = std::nullopt;
+  };
+
+  // Timestamp and pipeline statistics queries, one set of pools per frame in flight. A slot's results are read back
+  // when it is reused, once its fence has been waited on, so reading never stalls.
+  class GpuQueryPool
+  {
+   public:
+    static constexpr std::uint32_t kMaxScopes = 32;
+    static constexpr std::uint32_t kInvalidScope = std::numeric_limits<std::uint32_t>::max();
+
+    // queue_family is the family the queries are recorded on, statistics need the features enabled below
+    GpuQueryPool(
+        VkPhysicalDevice physical_device, VkDevice device, std::uint32_t queue_family, std::uint32_t frames_in_flight,
+        bool statistics_enabled);
+    ~GpuQueryPool();
+
+    GpuQueryPool(const GpuQueryPool&) = delete;
+    GpuQueryPool& operator=(const GpuQueryPool&) = delete;
+
+    // Reads the slot's previous results back then resets its queries, outside of any render pass
+    void BeginFrame(std::uint32_t frame_index, VkCommandBuffer command_buffer);
+
+    // The name must outlive the results, string literals are meant. Scopes past kMaxScopes are dropped.
+    std::uint32_t BeginScope(VkCommandBuffer command_buffer, gsl::czstring name);
+    void EndScope(VkCommandBuffer command_buffer, std::uint32_t scope);
+
+    // Once per frame, secondary command buffers executed in between must inherit GetStatisticsFlags()
+    void BeginStatistics(VkCommandBuffer command_buffer);
+    void EndStatistics(VkCommandBuffer command_buffer);
+    VkQueryPipelineStatisticFlags GetStatisticsFlags() const { return statistics_flags_; };
+
+    // Results of the latest frame that came back
+    const GpuFrameResults& GetResults() const { return results_; };
+    void LogResults() const;
+
+    // Pipeline statistics also need inherited queries, since draws are recorded into secondary command buffers
+    static bool IsStatisticsSupported(const VkPhysicalDeviceFeatures& features);
+    static void EnableFeatures(VkPhysicalDeviceFeatures& features);
+
+   private:
+    struct FrameQueries
+    {
+      VkQueryPool timestamps_ = VK_NULL_HANDLE;
+      VkQueryPool statistics_ = VK_NULL_HANDLE;
+      std::vector<gsl::czstring> scope_names_;
+      bool statistics_written_ = false;
+      bool pending_ = false;  // Written by a frame whose results were not read yet
+    };
+
+    void ReadResults(FrameQueries& frame);
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    std::vector<FrameQueries> frames_;
+    FrameQueries* current_ = nullptr;
+    double timestamp_period_ns_ = 0.0;
+    std::uint64_t timestamp_mask_ = 0;  // 0 when the queue family has no timestamps
+    VkQueryPipelineStatisticFlags statistics_flags_ = 0;
+    GpuFrameResults results_;
+  };
+}  // namespace veng
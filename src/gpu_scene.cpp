@@ -0,0 +1,321 @@
+#include <gpu_scene.h>
+
+namespace veng
+{
+  GpuScene::GpuScene(
+      GpuAllocator& allocator, Uploader& uploader, BindlessTable& bindless_table, DeletionQueue& deletion_queue) :
+      allocator_(allocator), uploader_(uploader), bindless_table_(bindless_table), deletion_queue_(deletion_queue)
+  {
+  }
+
+  GpuScene::~GpuScene()
+  {
+    if (current_.has_value())
+    {
+      Destroy(*current_);
+    }
+    if (pending_.has_value())
+    {
+      Destroy(*pending_);
+    }
+  }
+
+  SceneObjectHandle GpuScene::Add(
+      MeshHandle mesh, std::uint32_t index_count, const glm::vec4& bounds, const glm::mat4& transform,
+      BindlessIndex material)
+  {
+    Object object{mesh, index_count, bounds, transform, material, true};
+    dirty_ = true;
+    live_count_++;
+
+    if (!free_handles_.empty())
+    {
+      SceneObjectHandle handle = free_handles_.back();
+      free_handles_.pop_back();
+      objects_[handle] = object;
+      return handle;
+    }
+    objects_.push_back(object);
+    return static_cast<SceneObjectHandle>(objects_.size() - 1);
+  }
+
+  void GpuScene::Remove(SceneObjectHandle object)
+  {
+    if (object >= objects_.size() || !objects_[object].alive_)
+    {
+      SPDLOG_WARN("Removing scene object {} that does not exist", object);
+      return;
+    }
+    objects_[object].alive_ = false;
+    free_handles_.push_back(object);
+    live_count_--;
+    dirty_ = true;
+  }
+
+  void GpuScene::SetTransform(SceneObjectHandle object, const glm::mat4& transform)
+  {
+    if (object >= objects_.size() || !objects_[object].alive_)
+    {
+      SPDLOG_WARN("Moving scene object {} that does not exist", object);
+      return;
+    }
+    objects_[object].transform_ = transform;
+    if (!objects_[object].moved_)
+    {
+      objects_[object].moved_ = true;
+      moved_objects_.push_back(object);
+    }
+  }
+
+  void GpuScene::Update(
+      std::uint64_t frame_number, const std::function<BindlessIndex(BindlessIndex)>& resolve_material)
+  {
+    ZoneScoped;
+    if (pending_.has_value() && uploader_.IsReady(pending_->ready_ticket_))
+    {
+      // Frames recorded before this one may still read the old generation
+      if (current_.has_value())
+      {
+        Retire(*current_, frame_number);
+      }
+      current_ = std::move(pending_);
+      pending_.reset();
+    }
+
+    // Uploads do not overlap, changes made meanwhile go out once the pending one landed
+    if (pending_.has_value())
+    {
+      return;
+    }
+    if (!dirty_)
+    {
+      dirty_ = std::any_of(
+          fallback_materials_.begin(), fallback_materials_.end(),
+          [&resolve_material](BindlessIndex material)
+          {
+            return resolve_material(material) == material;
+          });
+    }
+    if (moved_objects_.size() * sizeof(SceneObject) > kMaxPatchBytes)
+    {
+      dirty_ = true;
+    }
+    if (dirty_)
+    {
+      dirty_ = false;
+      pending_ = Build(resolve_material);
+    }
+  }
+
+  const GpuScene::Generation* GpuScene::GetCurrent() const
+  {
+    if (!current_.has_value() || current_->object_count_ == 0)
+    {
+      return nullptr;
+    }
+    return &*current_;
+  }
+
+  bool GpuScene::HasTransformUpdates() const
+  {
+    // Objects moved while an upload is pending are patched into it once it is current, it was built before
+    return !moved_objects_.empty() && !pending_.has_value() && GetCurrent() != nullptr;
+  }
+
+  void GpuScene::RecordTransformUpdates(VkCommandBuffer command_buffer)
+  {
+    ZoneScoped;
+    Generation& generation = *current_;
+    // Handles and slots are in the same order, runs of adjacent entries go out in one vkCmdUpdateBuffer
+    std::sort(moved_objects_.begin(), moved_objects_.end());
+    std::uint32_t run_first = 0;
+    std::uint32_t run_count = 0;
+    const auto flush_run = [&]()
+    {
+      if (run_count > 0)
+      {
+        vkCmdUpdateBuffer(
+            command_buffer, generation.object_buffer_.buffer_, run_first * sizeof(SceneObject),
+            run_count * sizeof(SceneObject), &generation.objects_[run_first]);
+      }
+    };
+    // The most vkCmdUpdateBuffer takes at once
+    constexpr std::uint32_t kMaxRunLength = 65536 / sizeof(SceneObject);
+
+    for (SceneObjectHandle handle : moved_objects_)
+    {
+      objects_[handle].moved_ = false;
+      const std::uint32_t slot = handle < generation.slots_.size() ? generation.slots_[handle] : kNoSlot;
+      if (slot == kNoSlot)
+      {
+        continue;
+      }
+      generation.objects_[slot].transform_ = objects_[handle].transform_;
+      if (run_count > 0 && slot == run_first + run_count && run_count < kMaxRunLength)
+      {
+        run_count++;
+        continue;
+      }
+      flush_run();
+      run_first = slot;
+      run_count = 1;
+    }
+    flush_run();
+    moved_objects_.clear();
+  }
+
+  GpuScene::Generation GpuScene::Build(const std::function<BindlessIndex(BindlessIndex)>& resolve_material)
+  {
+    ZoneScoped;
+    Generation generation;
+    generation.object_count_ = live_count_;
+    fallback_materials_.clear();
+    // Their transforms go out with this upload
+    for (SceneObjectHandle handle : moved_objects_)
+    {
+      objects_[handle].moved_ = false;
+    }
+    moved_objects_.clear();
+    if (live_count_ == 0)
+    {
+      return generation;
+    }
+
+    // One batch per mesh, its commands are laid out after those of the batches before it
+    std::unordered_map<MeshHandle, std::uint32_t> batch_of_mesh;
+    for (const Object& object : objects_)
+    {
+      if (!object.alive_)
+      {
+        continue;
+      }
+      auto [it, inserted] = batch_of_mesh.try_emplace(
+          object.mesh_, static_cast<std::uint32_t>(generation.batches_.size()));
+      if (inserted)
+      {
+        generation.batches_.push_back(Batch{object.mesh_, 0, 0});
+      }
+      generation.batches_[it->second].command_count_++;
+    }
+
+    std::vector<SceneBatch> gpu_batches(generation.batches_.size());
+    std::uint32_t first_command = 0;
+    for (Batch& batch : generation.batches_)
+    {
+      batch.first_command_ = first_command;
+      first_command += batch.command_count_;
+    }
+
+    std::vector<SceneObject> gpu_objects;
+    gpu_objects.reserve(live_count_);
+    generation.slots_.assign(objects_.size(), kNoSlot);
+    for (SceneObjectHandle handle = 0; handle < objects_.size(); handle++)
+    {
+      const Object& object = objects_[handle];
+      if (!object.alive_)
+      {
+        continue;
+      }
+      generation.slots_[handle] = static_cast<std::uint32_t>(gpu_objects.size());
+      const std::uint32_t batch = batch_of_mesh.at(object.mesh_);
+      gpu_batches[batch] = SceneBatch{object.index_count_, generation.batches_[batch].first_command_};
+
+      const BindlessIndex material = resolve_material(object.material_);
+      if (material != object.material_ &&
+          std::find(fallback_materials_.begin(), fallback_materials_.end(), object.material_) ==
+              fallback_materials_.end())
+      {
+        fallback_materials_.push_back(object.material_);
+      }
+      gpu_objects.push_back(SceneObject{object.transform_, object.bounds_, batch, material});
+    }
+
+    const VkDeviceSize object_size = gpu_objects.size() * sizeof(SceneObject);
+    const VkDeviceSize batch_size = gpu_batches.size() * sizeof(SceneBatch);
+    generation.object_buffer_ = allocator_.CreateBuffer(
+        object_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryUsage::kGpuOnly);
+    generation.batch_buffer_ = allocator_.CreateBuffer(
+        batch_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryUsage::kGpuOnly);
+    generation.command_buffer_ = allocator_.CreateBuffer(
+        live_count_ * sizeof(VkDrawIndexedIndirectCommand),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, MemoryUsage::kGpuOnly);
+    generation.count_buffer_ = allocator_.CreateBuffer(
+        generation.batches_.size() * sizeof(std::uint32_t),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        MemoryUsage::kGpuOnly);
+    std::array<Buffer*, 4> buffers = {
+        &generation.object_buffer_, &generation.batch_buffer_, &generation.command_buffer_,
+        &generation.count_buffer_};
+    const bool failed = std::any_of(
+        buffers.begin(), buffers.end(),
+        [](const Buffer* buffer)
+        {
+          return buffer->buffer_ == VK_NULL_HANDLE;
+        });
+    if (failed)
+    {
+      for (Buffer* buffer : buffers)
+      {
+        allocator_.DestroyBuffer(*buffer);
+      }
+      throw std::runtime_error("Failed to create the scene buffers!");
+    }
+
+    generation.ready_ticket_ = std::max(
+        uploader_.UploadBuffer(generation.object_buffer_, gpu_objects.data(), object_size),
+        uploader_.UploadBuffer(generation.batch_buffer_, gpu_batches.data(), batch_size));
+    generation.object_buffer_index_ = bindless_table_.RegisterBuffer(generation.object_buffer_.buffer_);
+    generation.batch_buffer_index_ = bindless_table_.RegisterBuffer(generation.batch_buffer_.buffer_);
+    generation.command_buffer_index_ = bindless_table_.RegisterBuffer(generation.command_buffer_.buffer_);
+    generation.count_buffer_index_ = bindless_table_.RegisterBuffer(generation.count_buffer_.buffer_);
+
+    SPDLOG_DEBUG(
+        "Uploading {} scene objects in {} batches, {} materials still uploading", gpu_objects.size(),
+        gpu_batches.size(), fallback_materials_.size());
+    generation.objects_ = std::move(gpu_objects);
+    return generation;
+  }
+
+  void GpuScene::Destroy(Generation& generation)
+  {
+    // Empty generations own nothing
+    if (generation.object_buffer_.buffer_ == VK_NULL_HANDLE)
+    {
+      return;
+    }
+    for (BindlessIndex index : {generation.object_buffer_index_, generation.batch_buffer_index_,
+                                generation.command_buffer_index_, generation.count_buffer_index_})
+    {
+      bindless_table_.ReleaseBuffer(index);
+    }
+    for (Buffer* buffer : {&generation.object_buffer_, &generation.batch_buffer_, &generation.command_buffer_,
+                           &generation.count_buffer_})
+    {
+      allocator_.DestroyBuffer(*buffer);
+    }
+    generation = Generation();
+  }
+
+  void GpuScene::Retire(Generation& generation, std::uint64_t frame_number)
+  {
+    deletion_queue_.Push(
+        frame_number,
+        [this, retired = std::move(generation)]() mutable
+        {
+          Destroy(retired);
+        });
+  }
+
+  bool GpuScene::IsSupported(
+      const VkPhysicalDeviceFeatures& features, const VkPhysicalDeviceVulkan12Features& features12)
+  {
+    return features.multiDrawIndirect && features.drawIndirectFirstInstance && features12.drawIndirectCount;
+  }
+
+  void GpuScene::EnableFeatures(VkPhysicalDeviceFeatures& features, VkPhysicalDeviceVulkan12Features& features12)
+  {
+    features.multiDrawIndirect = VK_TRUE;
+    features.drawIndirectFirstInstance = VK_TRUE;
+    features12.drawIndirectCount = VK_TRUE;
+  }
+}  // namespace veng
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <gpu_allocator.h>
+#include <uploader.h>
+#include <bindless_table.h>
+#include <deletion_queue.h>
+#include <shader_types.h>
+
+namespace veng
+{
+  using MeshHandle = std::uint32_t;
+  using SceneObjectHandle = std::uint32_t;
+
+  // Objects drawn by the GPU. Every frame a compute pass culls them against the view frustum and writes one
+  // indirect command per visible object, grouped by mesh, so a mesh costs one vkCmdDrawIndexedIndirectCount however
+  // many of its objects are visible. Adding or removing objects uploads the object list again, moving them patches
+  // only their entries through the frame's command buffer, so the cost follows the number of objects that moved.
+  class GpuScene
+  {
+   public:
+    // The objects sharing a mesh, drawn from a range of the command buffer
+    struct Batch
+    {
+      MeshHandle mesh_ = 0;
+      std::uint32_t first_command_ = 0;
+      std::uint32_t command_count_ = 0;  // Objects in the batch, the most the culling pass can emit
+    };
+    // One upload of the object list, read by the frames recorded after it landed
+    struct Generation
+    {
+      Buffer object_buffer_ = NULL_STRUCT;  // SceneObject[object_count_]
+      Buffer batch_buffer_ = NULL_STRUCT;  // SceneBatch[batches_.size()]
+      Buffer command_buffer_ = NULL_STRUCT;  // VkDrawIndexedIndirectCommand[object_count_], written by the GPU
+      Buffer count_buffer_ = NULL_STRUCT;  // uint32 per batch, written by the GPU
+      BindlessIndex object_buffer_index_ = 0;
+      BindlessIndex batch_buffer_index_ = 0;
+      BindlessIndex command_buffer_index_ = 0;
+      BindlessIndex count_buffer_index_ = 0;
+      std::uint32_t object_count_ = 0;
+      std::vector<Batch> batches_;
+      UploadTicket ready_ticket_ = 0;
+      // What object_buffer_ holds, patched along with it, and the entry of each object handle, kNoSlot when free
+      std::vector<SceneObject> objects_;
+      std::vector<std::uint32_t> slots_;
+    };
+
+    GpuScene(GpuAllocator& allocator, Uploader& uploader, BindlessTable& bindless_table, DeletionQueue& deletion_queue);
+    // The device must be idle
+    ~GpuScene();
+
+    GpuScene(const GpuScene&) = delete;
+    GpuScene& operator=(const GpuScene&) = delete;
+
+    // bounds is the mesh's bounding sphere in model space: center then radius
+    SceneObjectHandle Add(
+        MeshHandle mesh, std::uint32_t index_count, const glm::vec4& bounds, const glm::mat4& transform,
+        BindlessIndex material);
+    void Remove(SceneObjectHandle object);
+    void SetTransform(SceneObjectHandle object, const glm::mat4& transform);
+
+    // Swaps in the pending upload once it landed, then uploads the objects again if they changed since, or if a
+    // material resolve_material swapped for a fallback has become usable.
+    void Update(std::uint64_t frame_number, const std::function<BindlessIndex(BindlessIndex)>& resolve_material);
+    // nullptr while nothing landed or the scene is empty
+    const Generation* GetCurrent() const;
+
+    // Whether objects moved since the current generation was built and can be patched into it
+    bool HasTransformUpdates() const;
+    // Writes the moved objects into the current generation's object buffer. The caller orders it after the previous
+    // frames' reads of the buffer and before this frame's.
+    void RecordTransformUpdates(VkCommandBuffer command_buffer);
+
+    // The device features indirect count draws rely on, to be chained into device creation
+    static bool IsSupported(
+        const VkPhysicalDeviceFeatures& features, const VkPhysicalDeviceVulkan12Features& features12);
+    static void EnableFeatures(VkPhysicalDeviceFeatures& features, VkPhysicalDeviceVulkan12Features& features12);
+
+   private:
+    struct Object
+    {
+      MeshHandle mesh_ = 0;
+      std::uint32_t index_count_ = 0;
+      glm::vec4 bounds_ = glm::vec4(0.0f);
+      glm::mat4 transform_ = glm::mat4(1.0f);
+      BindlessIndex material_ = 0;
+      bool alive_ = false;
+      bool moved_ = false;  // In moved_objects_
+    };
+
+    static constexpr std::uint32_t kNoSlot = std::numeric_limits<std::uint32_t>::max();
+    // Past this many bytes of moved objects, uploading the whole list beats inlining them in the command buffer
+    static constexpr VkDeviceSize kMaxPatchBytes = 256 * 1024;
+
+    Generation Build(const std::function<BindlessIndex(BindlessIndex)>& resolve_material);
+    void Destroy(Generation& generation);
+    void Retire(Generation& generation, std::uint64_t frame_number);
+
+    GpuAllocator& allocator_;
+    Uploader& uploader_;
+    BindlessTable& bindless_table_;
+    DeletionQueue& deletion_queue_;
+
+    // Objects by handle, freed handles are reused
+    std::vector<Object> objects_;
+    std::vector<SceneObjectHandle> free_handles_;
+    std::uint32_t live_count_ = 0;
+
+    bool dirty_ = false;  // Objects were added or removed since the last upload started
+    std::vector<SceneObjectHandle> moved_objects_;  // Since the last upload started
+    std::vector<BindlessIndex> fallback_materials_;  // Materials the last upload could not use yet
+
+    std::optional<Generation> current_ = std::nullopt;
+    std::optional<Generation> pending_ = std::nullopt;
+  };
+}  // namespace veng
@@ -143,9 +143,14 @@ namespace veng
 
   std::vector<gsl::czstring> Graphics::GetRequiredInstanceExtension()
   {
-    gsl::span<gsl::czstring> suggested_extensions = GetSuggestedInstanceExtension();
-    std::vector<gsl::czstring> required_extensions(suggested_extensions.size());
-    std::copy(suggested_extensions.begin(), suggested_extensions.end(), required_extensions.begin());
+    std::vector<gsl::czstring> required_extensions;
+
+    // Headless runs never create a surface and must not touch GLFW
+    if (!IsHeadless())
+    {
+      gsl::span<gsl::czstring> suggested_extensions = GetSuggestedInstanceExtension();
+      required_extensions.assign(suggested_extensions.begin(), suggested_extensions.end());
+    }
 
     if (validation_enabled_)
     {
@@ -261,12 +266,48 @@ namespace veng
         families.begin(), families.end(),
         [](const VkQueueFamilyProperties& props)
         {
-          return props.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_TRANSFER_BIT);
+          return props.queueFlags & VK_QUEUE_GRAPHICS_BIT;
         });
 
     QueueFamilyIndices QFI_result;
+    if (graphics_family_it == families.end())
+    {
+      return QFI_result;
+    }
     QFI_result.graphics_family_ = graphics_family_it - families.begin();
 
+    // Uploads prefer a transfer-only family (usually backed by DMA engines), then any non-graphics one,
+    // and otherwise share the graphics family
+    std::optional<std::uint32_t> non_graphics_transfer_family = std::nullopt;
+    for (std::uint32_t i = 0; i < families.size(); i++)
+    {
+      const VkQueueFlags flags = families[i].queueFlags;
+      if (!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT))
+      {
+        continue;
+      }
+      if (!(flags & VK_QUEUE_COMPUTE_BIT))
+      {
+        QFI_result.transfer_family_ = i;
+        break;
+      }
+      if (!non_graphics_transfer_family.has_value())
+      {
+        non_graphics_transfer_family = i;
+      }
+    }
+    if (!QFI_result.transfer_family_.has_value())
+    {
+      QFI_result.transfer_family_ = non_graphics_transfer_family.value_or(QFI_result.graphics_family_.value());
+    }
+
+    // Nothing is presented when headless, the graphics queue stands in for the presentation one
+    if (IsHeadless())
+    {
+      QFI_result.presentation_family_ = QFI_result.graphics_family_;
+      return QFI_result;
+    }
+
     // Loop through the queue family properties
     for (std::uint32_t i = 0; i < families.size(); i++)
     {
@@ -320,9 +361,20 @@ namespace veng
           return veng::streq(props.extensionName, name);
         });
   }
+  std::vector<gsl::czstring> Graphics::GetRequiredDeviceExtensions()
+  {
+    if (IsHeadless())
+    {
+      return NULL_STRUCT;
+    }
+
+    return {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+  }
+
   bool Graphics::AreAllDeviceExtensionsSupported(VkPhysicalDevice device)
   {
     std::vector<VkExtensionProperties> available_device_extensions = GetDeviceAvailableExtensions(device);
+    std::vector<gsl::czstring> required_device_extensions = GetRequiredDeviceExtensions();
     return std::all_of(
         required_device_extensions.begin(), required_device_extensions.end(),
         std::bind_front(IsDeviceExtensionsWithinList, available_device_extensions));
@@ -332,7 +384,37 @@ namespace veng
   {
     QueueFamilyIndices families = FindQueueFamilies(device);
 
-    return families.IsValid() && AreAllDeviceExtensionsSupported(device) && GetSwapChainProperties(device).IsValid();
+    if (!families.IsValid() || !AreAllDeviceExtensionsSupported(device) || !AreAllDeviceFeaturesSupported(device))
+    {
+      return false;
+    }
+
+    return IsHeadless() || GetSwapChainProperties(device).IsValid();
+  }
+
+  bool Graphics::AreAllDeviceFeaturesSupported(VkPhysicalDevice device)
+  {
+    // Dynamic rendering and synchronization2 are core from 1.3 on, older devices cannot report them this way
+    VkPhysicalDeviceProperties properties = NULL_STRUCT;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_3)
+    {
+      return false;
+    }
+
+    VkPhysicalDeviceVulkan13Features vulkan13_features = NULL_STRUCT;
+    vulkan13_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    VkPhysicalDeviceVulkan12Features vulkan12_features = NULL_STRUCT;
+    vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12_features.pNext = &vulkan13_features;
+    VkPhysicalDeviceFeatures2 features = NULL_STRUCT;
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &vulkan12_features;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    return vulkan12_features.timelineSemaphore && vulkan13_features.dynamicRendering &&
+           vulkan13_features.synchronization2 && BindlessTable::IsSupported(vulkan12_features) &&
+           GpuScene::IsSupported(features.features, vulkan12_features);
   }
 
   void Graphics::PickPhysicalDevice()
@@ -378,7 +460,8 @@ namespace veng
     }
 
     std::set<std::uint32_t> unique_queue_families = {
-        picked_device_families.graphics_family_.value(), picked_device_families.presentation_family_.value()};
+        picked_device_families.graphics_family_.value(), picked_device_families.presentation_family_.value(),
+        picked_device_families.transfer_family_.value()};
 
     std::float_t queue_priority = 1.0f;
 
@@ -393,9 +476,32 @@ namespace veng
       queue_create_infos.push_back(queue_info);
     }
 
+    std::vector<gsl::czstring> required_device_extensions = GetRequiredDeviceExtensions();
+
     VkPhysicalDeviceFeatures required_features = NULL_STRUCT;
+    VkPhysicalDeviceVulkan13Features vulkan13_features = NULL_STRUCT;
+    vulkan13_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    vulkan13_features.dynamicRendering = VK_TRUE;  // Passes begin on image views, no render pass or framebuffer
+    vulkan13_features.synchronization2 = VK_TRUE;  // Layout transitions and submits
+    VkPhysicalDeviceVulkan12Features vulkan12_features = NULL_STRUCT;
+    vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12_features.pNext = &vulkan13_features;
+    vulkan12_features.timelineSemaphore = VK_TRUE;  // Upload completion
+    BindlessTable::EnableFeatures(vulkan12_features);
+    GpuScene::EnableFeatures(required_features, vulkan12_features);
+
+    // Optional: without them the GPU query pool only measures time
+    VkPhysicalDeviceFeatures supported_features = NULL_STRUCT;
+    vkGetPhysicalDeviceFeatures(physical_device_, &supported_features);
+    pipeline_statistics_enabled_ = GpuQueryPool::IsStatisticsSupported(supported_features);
+    if (pipeline_statistics_enabled_)
+    {
+      GpuQueryPool::EnableFeatures(required_features);
+    }
+
     VkDeviceCreateInfo device_info = NULL_STRUCT;
     device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_info.pNext = &vulkan12_features;
     device_info.queueCreateInfoCount = queue_create_infos.size();
     device_info.pQueueCreateInfos = queue_create_infos.data();
     device_info.pEnabledFeatures = &required_features;
@@ -413,6 +519,11 @@ namespace veng
 
     vkGetDeviceQueue(logical_device_, picked_device_families.graphics_family_.value(), 0, &graphics_queue_);
     vkGetDeviceQueue(logical_device_, picked_device_families.presentation_family_.value(), 0, &presentation_queue_);
+    vkGetDeviceQueue(logical_device_, picked_device_families.transfer_family_.value(), 0, &transfer_queue_);
+    if (picked_device_families.transfer_family_ != picked_device_families.graphics_family_)
+    {
+      SPDLOG_INFO("Using the dedicated transfer queue family {}", picked_device_families.transfer_family_.value());
+    }
   }
 
 #pragma endregion
@@ -420,6 +531,11 @@ namespace veng
 #pragma region PRESENTATION
   void Graphics::CreateSurface()
   {
+    if (IsHeadless())
+    {
+      return;
+    }
+
     VkResult result = glfwCreateWindowSurface(instance_, window_->GetHandle(), VK_NULL_HANDLE, &surface_);
     if (result != VK_SUCCESS)
     {
@@ -467,6 +583,16 @@ namespace veng
   }
   VkPresentModeKHR Graphics::ChooseSwapPresentationMode(gsl::span<VkPresentModeKHR> presentation_modes)
   {
+    if (settings_.presentation_mode_.has_value())
+    {
+      const VkPresentModeKHR requested = settings_.presentation_mode_.value();
+      if (std::find(presentation_modes.begin(), presentation_modes.end(), requested) != presentation_modes.end())
+      {
+        return requested;
+      }
+      SPDLOG_WARN("Requested presentation mode {} is not supported, using the default one", std::int32_t(requested));
+    }
+
     if (std::any_of(presentation_modes.begin(), presentation_modes.end(), IsMailBoxPresentMode))
     {
       return VkPresentModeKHR::VK_PRESENT_MODE_MAILBOX_KHR;
@@ -507,8 +633,33 @@ namespace veng
 
     return image_count;
   }
+
+  VkFormat Graphics::ChooseDepthFormat()
+  {
+    // Every device supports D16 and one of the two others, none has a stencil aspect to transition along
+    constexpr std::array<VkFormat, 3> kCandidates = {
+        VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D16_UNORM};
+    for (VkFormat format : kCandidates)
+    {
+      VkFormatProperties properties = NULL_STRUCT;
+      vkGetPhysicalDeviceFormatProperties(physical_device_, format, &properties);
+      if ((properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) != 0)
+      {
+        return format;
+      }
+    }
+    SPDLOG_ERROR("The device supports no depth attachment format");
+    std::exit(EXIT_FAILURE);
+  }
+
   void Graphics::CreateSwapChain()
   {
+    if (IsHeadless())
+    {
+      CreateOffscreenImages();
+      return;
+    }
+
     SwapChainProperties properties = GetSwapChainProperties(physical_device_);
 
     surface_format_ = ChooseSwapSurfaceFormat(properties.formats_);
@@ -529,7 +680,8 @@ namespace veng
     info.preTransform = properties.capabilities_.currentTransform;
     info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     info.clipped = VK_TRUE;
-    info.oldSwapchain = VK_NULL_HANDLE;
+    // Hand the previous swapchain over on recreation so the presentation engine can reuse its resources
+    info.oldSwapchain = swap_chain_;
 
     QueueFamilyIndices indices = FindQueueFamilies(physical_device_);
 
@@ -553,10 +705,125 @@ namespace veng
       std::exit(EXIT_FAILURE);
     }
 
+    // The implementation may create more images than requested
+    vkGetSwapchainImagesKHR(logical_device_, swap_chain_, &image_count, VK_NULL_HANDLE);
     swap_chain_images_.resize(image_count);
     vkGetSwapchainImagesKHR(logical_device_, swap_chain_, &image_count, swap_chain_images_.data());
   }
 
+  void Graphics::RecreateSwapChain()
+  {
+    // A minimized window has a zero sized framebuffer, nothing can be presented until it is restored
+    glm::ivec2 size = window_->getFrameBufferSize();
+    while (size.x == 0 || size.y == 0)
+    {
+      glfwWaitEvents();
+      size = window_->getFrameBufferSize();
+    }
+
+    // Frames still in flight may reference the old objects, retire them instead of waiting for the device
+    VkSwapchainKHR old_swap_chain = swap_chain_;
+    std::vector<VkImageView> old_image_views = std::exchange(swap_chain_image_views_, NULL_STRUCT);
+    std::vector<VkSemaphore> old_signals = std::exchange(render_finished_signals_, NULL_STRUCT);
+
+    deletion_queue_.Push(
+        frame_number_,
+        [this, old_swap_chain, old_image_views, old_signals]()
+        {
+          for (VkImageView image_view : old_image_views)
+          {
+            vkDestroyImageView(logical_device_, image_view, VK_NULL_HANDLE);
+          }
+          for (VkSemaphore signal : old_signals)
+          {
+            vkDestroySemaphore(logical_device_, signal, VK_NULL_HANDLE);
+          }
+          vkDestroySwapchainKHR(logical_device_, old_swap_chain, VK_NULL_HANDLE);
+        });
+
+    // The pipelines only depend on the format, only the size dependent objects are rebuilt
+    CreateSwapChain();
+    CreateImageViews();
+    CreateRenderFinishedSignals();
+
+    SPDLOG_DEBUG("Recreated the swapchain at {}x{}", extent_.width, extent_.height);
+  }
+
+  void Graphics::CreateAllocator()
+  {
+    allocator_ = std::make_unique<GpuAllocator>(physical_device_, logical_device_, frames_.size());
+  }
+
+  void Graphics::CreateRenderGraph()
+  {
+    render_graph_ = std::make_unique<RenderGraph>(logical_device_, *allocator_, frames_.size());
+  }
+
+  void Graphics::CreateUniformRing()
+  {
+    uniform_ring_ = std::make_unique<UniformRing>(
+        physical_device_, logical_device_, *allocator_, frames_.size(), settings_.uniform_ring_frame_size_);
+  }
+
+  void Graphics::CreateBindlessTable()
+  {
+    bindless_table_ = std::make_unique<BindlessTable>(physical_device_, logical_device_);
+
+    // Instance buffers are bound whole, a storage buffer binding caps how many instances one can hold
+    VkPhysicalDeviceProperties properties = NULL_STRUCT;
+    vkGetPhysicalDeviceProperties(physical_device_, &properties);
+    max_instance_capacity_ = static_cast<std::uint32_t>(properties.limits.maxStorageBufferRange / kInstanceStride);
+    max_draw_indirect_count_ = properties.limits.maxDrawIndirectCount;
+
+    // Index 0, what draws sample when they name no texture or theirs is not uploaded yet
+    std::array<std::uint32_t, 1> white = {0xffffffff};
+    default_texture_ = CreateTexture(1, 1, white);
+
+    gpu_scene_ = std::make_unique<GpuScene>(*allocator_, *uploader_, *bindless_table_, deletion_queue_);
+  }
+
+  void Graphics::CreateUploader()
+  {
+    QueueFamilyIndices indices = FindQueueFamilies(physical_device_);
+    uploader_ = std::make_unique<Uploader>(
+        logical_device_, *allocator_, transfer_queue_, indices.transfer_family_.value(),
+        indices.graphics_family_.value());
+  }
+
+  // Headless stand-in for the swapchain: one image per frame in flight, so the frame's fence also guards its image
+  void Graphics::CreateOffscreenImages()
+  {
+    surface_format_ = {VK_FORMAT_R8G8B8A8_SRGB, VK_COLORSPACE_SRGB_NONLINEAR_KHR};
+    extent_ = settings_.headless_extent_;
+
+    swap_chain_images_.resize(frames_.size());
+    offscreen_images_.resize(frames_.size());
+
+    for (std::uint32_t i = 0; i < swap_chain_images_.size(); i++)
+    {
+      VkImageCreateInfo info = NULL_STRUCT;
+      info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+      info.imageType = VK_IMAGE_TYPE_2D;
+      info.format = surface_format_.format;
+      info.extent = {extent_.width, extent_.height, 1};
+      info.mipLevels = 1;
+      info.arrayLayers = 1;
+      info.samples = VK_SAMPLE_COUNT_1_BIT;
+      info.tiling = VK_IMAGE_TILING_OPTIMAL;
+      info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+      info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+      info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+      offscreen_images_[i] = allocator_->CreateImage(info, MemoryUsage::kGpuOnly);
+      if (offscreen_images_[i].image_ == VK_NULL_HANDLE)
+      {
+        SPDLOG_ERROR("Failed creating an offscreen image");
+        std::exit(EXIT_FAILURE);
+      }
+      swap_chain_images_[i] = offscreen_images_[i].image_;
+    }
+  }
+
   // Image views (aka Frames)
   void Graphics::CreateImageViews()
   {
@@ -595,168 +862,134 @@ namespace veng
 #pragma endregion
 
 #pragma region GRAPHICS_PIPELINE
-  VkShaderModule Graphics::CreateShaderModule(gsl::span<std::uint8_t> buffer)
+  void Graphics::CreatePipelineCache()
   {
-    if (buffer.empty())
-    {
-      return VK_NULL_HANDLE;
-    }
+    pipeline_cache_ =
+        std::make_unique<PipelineCache>(physical_device_, logical_device_, settings_.pipeline_cache_path_);
+  }
 
-    VkShaderModuleCreateInfo info = NULL_STRUCT;
-    info.sType = VkStructureType::VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    info.codeSize = buffer.size();
-    info.pCode = reinterpret_cast<std::uint32_t*>(buffer.data());
+  void Graphics::CreateGraphicsPipeline()
+  {
+    // Pipeline Layout Create Info, set 0 is the uniform ring and set 1 the bindless table
+    std::array<VkDescriptorSetLayout, 2> set_layouts = {uniform_ring_->GetSetLayout(), bindless_table_->GetSetLayout()};
+    VkPushConstantRange push_constant_range = NULL_STRUCT;
+    push_constant_range.stageFlags =
+        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = std::max(sizeof(DrawPushConstants), sizeof(CullPushConstants));
 
-    VkShaderModule shader_module;
+    VkPipelineLayoutCreateInfo pipeline_layout_info = NULL_STRUCT;
+    pipeline_layout_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_info.setLayoutCount = set_layouts.size();
+    pipeline_layout_info.pSetLayouts = set_layouts.data();
+    pipeline_layout_info.pushConstantRangeCount = 1;
+    pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+    VkResult layout_result =
+        vkCreatePipelineLayout(logical_device_, &pipeline_layout_info, VK_NULL_HANDLE, &pipeline_layout_);
 
-    VkResult result = vkCreateShaderModule(logical_device_, &info, VK_NULL_HANDLE, &shader_module);
-    if (result != VK_SUCCESS)
+    if (layout_result != VK_SUCCESS)
     {
-      return VK_NULL_HANDLE;
+      SPDLOG_ERROR("Failed creating the pipeline layout");
+      std::exit(EXIT_FAILURE);
     }
 
-    return shader_module;
-  };
-
-  void Graphics::CreateGraphicsPipeline()
-  {
-    // Shader Module for the Vertex Shader
-    std::vector<std::uint8_t> basic_vertex_data = ReadFile("./basic.vert.spv");
-    VkShaderModule vertex_shader = CreateShaderModule(basic_vertex_data);
-    gsl::final_action _destroy_vertex_shader(
-        [this, vertex_shader]()
-        {
-          vkDestroyShaderModule(logical_device_, vertex_shader, VK_NULL_HANDLE);
-        });
-
-    // Shader Module for the Fragment Shader
-    std::vector<std::uint8_t> basic_fragment_data = ReadFile("./basic.frag.spv");
-    VkShaderModule fragment_shader = CreateShaderModule(basic_fragment_data);
-    gsl::final_action _destroy_fragment_shader(
-        [this, fragment_shader]()
-        {
-          vkDestroyShaderModule(logical_device_, fragment_shader, VK_NULL_HANDLE);
-        });
+    shader_library_ = std::make_unique<ShaderLibrary>(logical_device_, settings_.shader_archive_path_);
+    pipeline_registry_ = std::make_unique<PipelineRegistry>(
+        logical_device_, pipeline_cache_->GetHandle(), *shader_library_, *jobs_, pipeline_layout_);
+
+    PipelineDescription basic_description;
+    basic_description.vertex_shader_ = "basic.vert";
+    basic_description.fragment_shader_ = "basic.frag";
+    basic_description.vertex_layout_ = Vertex::GetLayout();
+    basic_description.color_format_ = surface_format_.format;
+    depth_format_ = ChooseDepthFormat();
+    basic_description.depth_format_ = depth_format_;
+    // Early-Z rejects what is hidden behind the nearest surface so far. After a prepass that surface is already
+    // final, only the fragments matching it are shaded.
+    basic_description.depth_test_enable_ = true;
+    basic_description.depth_write_enable_ = !settings_.depth_prepass_;
+    basic_description.depth_compare_op_ = settings_.depth_prepass_ ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS_OR_EQUAL;
 
     // Shader Module Null Checking
-    if (vertex_shader == VK_NULL_HANDLE || fragment_shader == VK_NULL_HANDLE)
+    if (shader_library_->GetModule(basic_description.vertex_shader_) == VK_NULL_HANDLE ||
+        shader_library_->GetModule(basic_description.fragment_shader_) == VK_NULL_HANDLE)
     {
       SPDLOG_ERROR("Vertex Shader or Fragment shader is null");
       std::exit(EXIT_FAILURE);
     }
 
-    // Shader Staging
-    VkPipelineShaderStageCreateInfo vertex_stage_info = NULL_STRUCT;
-    vertex_stage_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertex_stage_info.stage = VkShaderStageFlagBits::VK_SHADER_STAGE_VERTEX_BIT;
-    vertex_stage_info.module = vertex_shader;
-    vertex_stage_info.pName = "main";
-
-    VkPipelineShaderStageCreateInfo fragment_stage_info = NULL_STRUCT;
-    fragment_stage_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragment_stage_info.stage = VkShaderStageFlagBits::VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragment_stage_info.module = fragment_shader;
-    fragment_stage_info.pName = "main";
-
-    std::array<VkPipelineShaderStageCreateInfo, 2> stage_infos = {vertex_stage_info, fragment_stage_info};
-
-    // Dynamic State Create info
-    std::array<VkDynamicState, 2> dynamic_states = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
-    VkPipelineDynamicStateCreateInfo dynamic_state_info = NULL_STRUCT;
-    dynamic_state_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamic_state_info.dynamicStateCount = dynamic_states.size();
-    dynamic_state_info.pDynamicStates = dynamic_states.data();
-
-    // Viewport State Create info
-    VkViewport viewport = GetViewport();  // Create the Viewport
-
-    VkRect2D scissor = GetScissor();  // Create the Scissor
-
-    VkPipelineViewportStateCreateInfo viewport_state_info = NULL_STRUCT;
-    viewport_state_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewport_state_info.viewportCount = 1;
-    viewport_state_info.pViewports = &viewport;
-    viewport_state_info.scissorCount = 1;
-    viewport_state_info.pScissors = &scissor;
-
-    // Vertex Input State Create info
-    VkPipelineVertexInputStateCreateInfo vertex_input_state_info = NULL_STRUCT;
-    vertex_input_state_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertex_input_state_info.vertexBindingDescriptionCount = 0;
-    vertex_input_state_info.vertexAttributeDescriptionCount = 0;
-
-    // Input Assembly State Create info
-    VkPipelineInputAssemblyStateCreateInfo input_assembly_state_info = NULL_STRUCT;
-    input_assembly_state_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    input_assembly_state_info.topology = VkPrimitiveTopology::VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    input_assembly_state_info.primitiveRestartEnable = VK_FALSE;
-
-    // Rasterization State Create info
-    VkPipelineRasterizationStateCreateInfo rasterization_state_info = NULL_STRUCT;
-    rasterization_state_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterization_state_info.depthBiasClamp = VK_FALSE;
-    rasterization_state_info.rasterizerDiscardEnable = VK_FALSE;
-    rasterization_state_info.polygonMode = VkPolygonMode::VK_POLYGON_MODE_FILL;
-    rasterization_state_info.lineWidth = 1.0f;
-    rasterization_state_info.cullMode = VkCullModeFlagBits::VK_CULL_MODE_NONE;
-    rasterization_state_info.frontFace = VkFrontFace::VK_FRONT_FACE_CLOCKWISE;
-    rasterization_state_info.depthBiasEnable = VK_FALSE;
-
-    // Multisample State Create info
-    VkPipelineMultisampleStateCreateInfo multisampling_state_info = NULL_STRUCT;
-    multisampling_state_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling_state_info.sampleShadingEnable = VK_FALSE;
-    multisampling_state_info.rasterizationSamples = VkSampleCountFlagBits::VK_SAMPLE_COUNT_1_BIT;
-
-    // Color Blend State Create info
-    VkPipelineColorBlendAttachmentState color_blend_attachment_state =
-        NULL_STRUCT;  // Responsible for Blending with the background
-    color_blend_attachment_state.blendEnable = VK_FALSE;
-    color_blend_attachment_state.colorWriteMask =
-        VkColorComponentFlagBits::VK_COLOR_COMPONENT_R_BIT | VkColorComponentFlagBits::VK_COLOR_COMPONENT_G_BIT |
-        VkColorComponentFlagBits::VK_COLOR_COMPONENT_B_BIT | VkColorComponentFlagBits::VK_COLOR_COMPONENT_A_BIT;
-    VkPipelineColorBlendStateCreateInfo color_blend_state_info = NULL_STRUCT;
-    color_blend_state_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    color_blend_state_info.logicOpEnable = VK_FALSE;
-    color_blend_state_info.attachmentCount = 1;
-    color_blend_state_info.pAttachments = &color_blend_attachment_state;
-
-    // Pipeline Layout Create Info
-    VkPipelineLayoutCreateInfo pipeline_layout_info = NULL_STRUCT;
-    pipeline_layout_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    VkResult layout_result =
-        vkCreatePipelineLayout(logical_device_, &pipeline_layout_info, VK_NULL_HANDLE, &pipeline_layout_);
+    // Compiles in the background, the first frames are cleared only until it is ready
+    basic_pipeline_ = pipeline_registry_->Request(basic_description);
+    PipelineDescription untextured_description = basic_description;
+    untextured_description.specialization_constants_ = {SpecializationConstant{kTexturedConstantId, VK_FALSE}};
+    untextured_pipeline_ = pipeline_registry_->Request(untextured_description);
+
+    // Same state, the transforms, colors and materials come from the frame's instance buffer
+    PipelineDescription instanced_description = basic_description;
+    instanced_description.vertex_shader_ = "instanced.vert";
+    instanced_description.fragment_shader_ = "instanced.frag";
+    instanced_pipeline_ = pipeline_registry_->Request(instanced_description);
+
+    // GPU-driven scene: a compute pass writes the indirect commands, objects then read their transform by index
+    PipelineDescription cull_description;
+    cull_description.compute_shader_ = "cull.comp";
+    cull_description.specialization_constants_ = {SpecializationConstant{kCullGroupSizeConstantId, kCullGroupSize}};
+    cull_pipeline_ = pipeline_registry_->Request(cull_description);
+    PipelineDescription scene_description = basic_description;
+    scene_description.vertex_shader_ = "scene.vert";
+    scene_description.fragment_shader_ = "instanced.frag";
+    scene_pipeline_ = pipeline_registry_->Request(scene_description);
+
+    // Same vertex shaders and state without fragment shading, their depth matches the main pass exactly
+    if (settings_.depth_prepass_)
+    {
+      PipelineDescription depth_description = basic_description;
+      depth_description.fragment_shader_.clear();
+      depth_description.color_format_ = VK_FORMAT_UNDEFINED;
+      depth_description.depth_write_enable_ = true;
+      depth_description.depth_compare_op_ = VK_COMPARE_OP_LESS_OR_EQUAL;
+      depth_pipeline_ = pipeline_registry_->Request(depth_description);
+      depth_description.vertex_shader_ = instanced_description.vertex_shader_;
+      instanced_depth_pipeline_ = pipeline_registry_->Request(depth_description);
+      depth_description.vertex_shader_ = scene_description.vertex_shader_;
+      scene_depth_pipeline_ = pipeline_registry_->Request(depth_description);
+    }
 
-    if (layout_result != VK_SUCCESS)
+#ifdef VENG_SHADER_SOURCE_DIR
+    if (settings_.hot_reload_shaders_ && ShaderWatcher::IsSupported())
     {
-      SPDLOG_ERROR("Failed creating the pipeline layout");
-      std::exit(EXIT_FAILURE);
+      shader_watcher_ = std::make_unique<ShaderWatcher>(VENG_SHADER_SOURCE_DIR, std::filesystem::current_path());
+    }
+#else
+    if (settings_.hot_reload_shaders_)
+    {
+      SPDLOG_WARN("The shader source directory is unknown to this build, shaders will not be hot reloaded");
     }
+#endif  // VENG_SHADER_SOURCE_DIR
+  }
 
-    // Pipeline creation
-    VkGraphicsPipelineCreateInfo graphics_pipeline_info = NULL_STRUCT;
-    graphics_pipeline_info.sType = VkStructureType::VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    graphics_pipeline_info.stageCount = stage_infos.size();
-    graphics_pipeline_info.pStages = stage_infos.data();
-    graphics_pipeline_info.layout = pipeline_layout_;
-    graphics_pipeline_info.subpass = 0;
-    graphics_pipeline_info.renderPass = render_pass_;
-
-    graphics_pipeline_info.pDynamicState = &dynamic_state_info;
-    graphics_pipeline_info.pViewportState = &viewport_state_info;
-    graphics_pipeline_info.pVertexInputState = &vertex_input_state_info;
-    graphics_pipeline_info.pInputAssemblyState = &input_assembly_state_info;
-    graphics_pipeline_info.pRasterizationState = &rasterization_state_info;
-    graphics_pipeline_info.pMultisampleState = &multisampling_state_info;
-    graphics_pipeline_info.pColorBlendState = &color_blend_state_info;
-    graphics_pipeline_info.pDepthStencilState = nullptr;  // TODO: IMPLEMENT THE DEPTH STATE
-
-    VkResult pipeline_result = vkCreateGraphicsPipelines(
-        logical_device_, VK_NULL_HANDLE, 1, &graphics_pipeline_info, VK_NULL_HANDLE, &pipeline_);
-    if (pipeline_result != VK_SUCCESS)
-    {
-      SPDLOG_ERROR("Failed creating the graphics pipeline");
-      std::exit(EXIT_FAILURE);
+  void Graphics::ReloadShaders()
+  {
+    ZoneScoped;
+    for (std::string& name : shader_watcher_->TakeRecompiled())
+    {
+      pending_shader_reloads_.insert(std::move(name));
+    }
+
+    // The previous frames may still be using the replaced pipelines, they are destroyed once those retire
+    pipeline_registry_->CommitReloads(
+        [this](VkPipeline pipeline)
+        {
+          deletion_queue_.Push(
+              frame_number_,
+              [this, pipeline]()
+              {
+                vkDestroyPipeline(logical_device_, pipeline, VK_NULL_HANDLE);
+              });
+        });
+    if (!pending_shader_reloads_.empty() && pipeline_registry_->Reload(pending_shader_reloads_))
+    {
+      pending_shader_reloads_.clear();
     }
   }
 
@@ -782,247 +1015,1262 @@ namespace veng
     return scissor;
   }
 
-  void Graphics::CreateRenderPass()
-  {
-    VkAttachmentDescription color_attachment = NULL_STRUCT;
-    color_attachment.format = surface_format_.format;
-    color_attachment.samples = VkSampleCountFlagBits::VK_SAMPLE_COUNT_1_BIT;
-    color_attachment.loadOp = VkAttachmentLoadOp::VK_ATTACHMENT_LOAD_OP_CLEAR;
-    color_attachment.storeOp = VkAttachmentStoreOp::VK_ATTACHMENT_STORE_OP_STORE;
-    color_attachment.stencilLoadOp = VkAttachmentLoadOp::VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    color_attachment.stencilStoreOp = VkAttachmentStoreOp::VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    color_attachment.initialLayout = VkImageLayout::VK_IMAGE_LAYOUT_UNDEFINED;
-    color_attachment.finalLayout = VkImageLayout::VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+#pragma endregion
 
-    VkAttachmentReference color_attachment_ref = NULL_STRUCT;
-    color_attachment_ref.attachment = 0;
-    color_attachment_ref.layout = VkImageLayout::VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+#pragma region DRAWING
 
-    VkSubpassDescription main_subpass = NULL_STRUCT;
-    main_subpass.pipelineBindPoint = VkPipelineBindPoint::VK_PIPELINE_BIND_POINT_GRAPHICS;
-    main_subpass.colorAttachmentCount = 1;
-    main_subpass.pColorAttachments = &color_attachment_ref;
+  void Graphics::CreateCommandPools()
+  {
+    QueueFamilyIndices indices = FindQueueFamilies(physical_device_);
+    VkCommandPoolCreateInfo pool_info = NULL_STRUCT;
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;  // Reset as a whole once per frame
+    pool_info.queueFamilyIndex = indices.graphics_family_.value();
 
-    VkRenderPassCreateInfo render_pass_info = NULL_STRUCT;
-    render_pass_info.sType = VkStructureType::VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    render_pass_info.attachmentCount = 1;
-    render_pass_info.pAttachments = &color_attachment;
-    render_pass_info.subpassCount = 1;
-    render_pass_info.pSubpasses = &main_subpass;
+    // At most one slice per job system thread
+    const std::uint32_t slice_count = jobs_->GetThreadCount();
 
-    VkResult result = vkCreateRenderPass(logical_device_, &render_pass_info, VK_NULL_HANDLE, &render_pass_);
-    if (result != VK_SUCCESS)
+    for (FrameData& frame : frames_)
     {
-      SPDLOG_ERROR("Failed creating the render pass");
+      VkResult pool_result = vkCreateCommandPool(logical_device_, &pool_info, VK_NULL_HANDLE, &frame.command_pool_);
 
-      std::exit(EXIT_FAILURE);
+      if (pool_result != VK_SUCCESS)
+      {
+        SPDLOG_ERROR("Failed to create the command pool, exiting...");
+        std::exit(EXIT_FAILURE);
+      }
+
+      frame.slice_command_pools_.resize(slice_count, VK_NULL_HANDLE);
+      for (VkCommandPool& slice_pool : frame.slice_command_pools_)
+      {
+        if (vkCreateCommandPool(logical_device_, &pool_info, VK_NULL_HANDLE, &slice_pool) != VK_SUCCESS)
+        {
+          SPDLOG_ERROR("Failed to create a recording slice command pool, exiting...");
+          std::exit(EXIT_FAILURE);
+        }
+      }
     }
   }
 
-#pragma endregion
-
-#pragma region DRAWING
-
-  void Graphics::CreateFramebuffers()
+  void Graphics::CreateCommandBuffers()
   {
-    swap_chain_framebuffers_.resize(swap_chain_image_views_.size());
-
-    for (std::uint32_t imageView = 0; imageView < swap_chain_image_views_.size(); imageView++)
+    for (FrameData& frame : frames_)
     {
-      VkFramebufferCreateInfo info = NULL_STRUCT;
-      info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-      info.renderPass = render_pass_;
-      info.attachmentCount = 1;
-      info.pAttachments = &swap_chain_image_views_[imageView];
-      info.width = extent_.width;
-      info.height = extent_.height;
-      info.layers = 1;
-
-      VkResult result = vkCreateFramebuffer(logical_device_, &info, nullptr, &swap_chain_framebuffers_[imageView]);
+      VkCommandBufferAllocateInfo info = NULL_STRUCT;
+      info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+      info.commandPool = frame.command_pool_;
+      info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+      info.commandBufferCount = 1;
 
+      VkResult result = vkAllocateCommandBuffers(logical_device_, &info, &frame.command_buffer_);
       if (result != VK_SUCCESS)
       {
-        SPDLOG_ERROR("Failed to create a frame buffer");
+        SPDLOG_ERROR("Failed to Allocate command buffers, exiting...");
         std::exit(EXIT_FAILURE);
       }
+
+      // Allocated once, resetting the pools each frame keeps them around
+      frame.slice_command_buffers_.resize(frame.slice_command_pools_.size(), VK_NULL_HANDLE);
+      frame.prepass_slice_command_buffers_.resize(frame.slice_command_pools_.size(), VK_NULL_HANDLE);
+      for (std::size_t slice = 0; slice < frame.slice_command_pools_.size(); slice++)
+      {
+        VkCommandBufferAllocateInfo slice_info = NULL_STRUCT;
+        slice_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        slice_info.commandPool = frame.slice_command_pools_[slice];
+        slice_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        slice_info.commandBufferCount = 1;
+
+        for (std::vector<VkCommandBuffer>* buffers :
+             {&frame.slice_command_buffers_, &frame.prepass_slice_command_buffers_})
+        {
+          if (vkAllocateCommandBuffers(logical_device_, &slice_info, &(*buffers)[slice]) != VK_SUCCESS)
+          {
+            SPDLOG_ERROR("Failed to Allocate the recording slice command buffers, exiting...");
+            std::exit(EXIT_FAILURE);
+          }
+        }
+      }
     }
   }
 
-  void Graphics::CreateCommandPool()
+  void Graphics::BeginCommands()
   {
-    QueueFamilyIndices indices = FindQueueFamilies(physical_device_);
-    VkCommandPoolCreateInfo pool_info = NULL_STRUCT;
-    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    pool_info.queueFamilyIndex = indices.graphics_family_.value();
+    ZoneScoped;
+    VkCommandBuffer command_buffer = CurrentCommandBuffer();
 
-    VkResult pool_result = vkCreateCommandPool(logical_device_, &pool_info, VK_NULL_HANDLE, &command_pool_);
+    VkCommandBufferBeginInfo begin_info = NULL_STRUCT;
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-    if (pool_result != VK_SUCCESS)
+    VkResult begin_result = vkBeginCommandBuffer(command_buffer, &begin_info);
+    if (begin_result != VK_SUCCESS)
     {
-      SPDLOG_ERROR("Failed to create the command pool, exiting...");
-      std::exit(EXIT_FAILURE);
+      SPDLOG_ERROR("Failed to Begin commands buffer, exiting...");
+      throw std::runtime_error("Failed to begin commands buffer!");
     }
-  }
 
-  void Graphics::CreateCommandBuffer()
-  {
-    VkCommandBufferAllocateInfo info = NULL_STRUCT;
-    info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    info.commandPool = command_pool_;
-    info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    info.commandBufferCount = 1;
+    // Queries are reset and collected outside of the render pass
+    TracyVkCollect(tracy_context_, command_buffer);
+    gpu_queries_->BeginFrame(current_frame_, command_buffer);
+    frame_timings_.gpu_frame_ms_ = gpu_queries_->GetResults().frame_ms_;
+    frame_scope_ = gpu_queries_->BeginScope(command_buffer, "Frame");
+    gpu_queries_->BeginStatistics(command_buffer);
 
-    VkResult result = vkAllocateCommandBuffers(logical_device_, &info, &command_buffer_);
-    if (result != VK_SUCCESS)
+    // Ship last frame's uploads, and take ownership of the finished ones before the render pass reads them
+    uploader_->Flush();
     {
-      SPDLOG_ERROR("Failed to Allocate command buffers, exiting...");
-      std::exit(EXIT_FAILURE);
+      TracyVkZone(tracy_context_, command_buffer, "Upload acquires");
+      const std::uint32_t acquire_scope = gpu_queries_->BeginScope(command_buffer, "Upload acquires");
+      uploader_->RecordAcquires(command_buffer);
+      gpu_queries_->EndScope(command_buffer, acquire_scope);
     }
   }
 
-  void Graphics::BeginCommands()
+  // Gribb-Hartmann: each plane is the last row of the matrix plus or minus another row. Vulkan clips z to [0, w],
+  // so the near plane is the third row alone.
+  static std::array<glm::vec4, 6> ExtractFrustumPlanes(const glm::mat4& view_projection)
   {
-    VkCommandBufferBeginInfo begin_info = NULL_STRUCT;
-    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-
-    VkResult begin_result = vkBeginCommandBuffer(command_buffer_, &begin_info);
-    if (begin_result != VK_SUCCESS)
+    auto row = [&view_projection](std::int32_t i)
     {
-      SPDLOG_ERROR("Failed to Begin commands buffer, exiting...");
-      throw std::runtime_error("Failed to begin commands buffer!");
+      return glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+    };
+    std::array<glm::vec4, 6> planes = {row(3) + row(0), row(3) - row(0), row(3) + row(1),
+                                       row(3) - row(1), row(2),          row(3) - row(2)};
+    // Unit normals, so the distance to a sphere center compares against its radius
+    for (glm::vec4& plane : planes)
+    {
+      plane /= glm::length(glm::vec3(plane));
     }
+    return planes;
+  }
 
-    VkClearValue clear_color = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
-    VkRenderPassBeginInfo render_pass_begin_info = NULL_STRUCT;
-    render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    render_pass_begin_info.renderPass = render_pass_;
-    render_pass_begin_info.framebuffer = swap_chain_framebuffers_[current_image_index_];
-    render_pass_begin_info.renderArea.offset = {0, 0};
-    render_pass_begin_info.renderArea.extent = extent_;
-    render_pass_begin_info.clearValueCount = 1;
-    render_pass_begin_info.pClearValues = &clear_color;
-
-    vkCmdBeginRenderPass(command_buffer_, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+  void Graphics::SetViewProjection(const glm::mat4& view_projection)
+  {
+    frame_uniforms_.view_projection_ = view_projection;
+    frame_uniforms_.frustum_planes_ = ExtractFrustumPlanes(view_projection);
+    frame_uniforms_offset_.reset();
+  }
 
-    vkCmdBindPipeline(command_buffer_, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
-    VkViewport viewport = GetViewport();
-    VkRect2D scissor = GetScissor();
+  SceneObjectHandle Graphics::AddSceneObject(
+      MeshHandle mesh, const glm::mat4& transform, std::optional<BindlessIndex> texture)
+  {
+    const Mesh& added = meshes_[mesh];
+    return gpu_scene_->Add(mesh, added.index_count_, added.bounds_, transform, texture.value_or(default_texture_));
+  }
 
-    vkCmdSetViewport(command_buffer_, 0, 1, &viewport);
-    vkCmdSetScissor(command_buffer_, 0, 1, &scissor);
+  void Graphics::RemoveSceneObject(SceneObjectHandle object)
+  {
+    gpu_scene_->Remove(object);
   }
 
-  void Graphics::RenderTriangle()
+  void Graphics::SetSceneObjectTransform(SceneObjectHandle object, const glm::mat4& transform)
   {
-    vkCmdDraw(command_buffer_, 3, 1, 0, 0);
+    gpu_scene_->SetTransform(object, transform);
   }
 
-  void Graphics::EndCommands()
+  void Graphics::RenderIndexed(MeshHandle mesh, const glm::mat4& model, std::optional<BindlessIndex> texture)
   {
-    vkCmdEndRenderPass(command_buffer_);
+    draw_list_.push_back(DrawCommand{mesh, model, texture});
+  }
 
-    VkResult end_buffer_result = vkEndCommandBuffer(command_buffer_);
-    if (end_buffer_result != VK_SUCCESS)
+  void Graphics::RenderInstanced(MeshHandle mesh, const InstanceStream& instances)
+  {
+    ZoneScoped;
+    const std::uint32_t count = static_cast<std::uint32_t>(instances.transforms_.size());
+    if ((!instances.colors_.empty() && instances.colors_.size() != count) ||
+        (!instances.materials_.empty() && instances.materials_.size() != count))
     {
-      SPDLOG_ERROR("Failed to End commands buffer, exiting...");
-      throw std::runtime_error("Failed to end commands buffer!");
+      throw std::runtime_error("Instance streams of different lengths!");
+    }
+    if (count == 0)
+    {
+      return;
     }
+
+    FrameData& frame = CurrentFrame();
+    ReserveInstances(frame, count);
+    const std::uint32_t first = frame.instance_count_;
+    frame.instance_count_ += count;
+
+    std::uint8_t* base = frame.instance_buffer_.allocation_.mapped_;
+    const VkDeviceSize capacity = frame.instance_capacity_;
+    auto* transforms = reinterpret_cast<InstanceTransform*>(base) + first;
+    auto* colors = reinterpret_cast<InstanceColor*>(base + capacity * sizeof(InstanceTransform)) + first;
+    auto* materials = reinterpret_cast<InstanceMaterial*>(
+                          base + capacity * (sizeof(InstanceTransform) + sizeof(InstanceColor))) +
+                      first;
+
+    // Straight into the mapped buffer, one section per stream, split across the job system
+    constexpr std::uint32_t kCopyBatchSize = 16 * 1024;
+    jobs_->ParallelFor(
+        count, kCopyBatchSize,
+        [&](std::uint32_t begin, std::uint32_t end)
+        {
+          const std::uint32_t batch_count = end - begin;
+          std::memcpy(
+              transforms + begin, instances.transforms_.data() + begin, batch_count * sizeof(InstanceTransform));
+          if (instances.colors_.empty())
+          {
+            std::fill_n(colors + begin, batch_count, InstanceColor(1.0f));
+          }
+          else
+          {
+            std::memcpy(colors + begin, instances.colors_.data() + begin, batch_count * sizeof(InstanceColor));
+          }
+
+          // Materials still uploading fall back to the default texture. Instances tend to share a few materials,
+          // so the lookup only runs when the material changes.
+          std::optional<InstanceMaterial> last_material = std::nullopt;
+          InstanceMaterial resolved = default_texture_;
+          for (std::uint32_t i = begin; i < end; i++)
+          {
+            const InstanceMaterial material =
+                instances.materials_.empty() ? default_texture_ : instances.materials_[i];
+            if (material != last_material)
+            {
+              auto texture_it = textures_.find(material);
+              const bool ready = texture_it != textures_.end() && uploader_->IsReady(texture_it->second.ready_ticket_);
+              resolved = ready ? material : default_texture_;
+              last_material = material;
+            }
+            materials[i] = resolved;
+          }
+        });
+
+    draw_list_.push_back(DrawCommand{mesh, glm::mat4(1.0f), std::nullopt, count, first});
   }
 
-  void Graphics::CreateSignals()
+  void Graphics::ReserveInstances(FrameData& frame, std::uint32_t count)
   {
-    VkSemaphoreCreateInfo semaphore_info = NULL_STRUCT;
-    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-    if (vkCreateSemaphore(logical_device_, &semaphore_info, VK_NULL_HANDLE, &image_available_signal_) != VK_SUCCESS)
+    const std::uint64_t needed = static_cast<std::uint64_t>(frame.instance_count_) + count;
+    if (needed <= frame.instance_capacity_)
     {
-      SPDLOG_ERROR("Failed to create the semaphore for image available, exiting...");
-      std::exit(EXIT_FAILURE);
+      return;
     }
-    if (vkCreateSemaphore(logical_device_, &semaphore_info, VK_NULL_HANDLE, &render_finished_singal_) != VK_SUCCESS)
+    if (needed > max_instance_capacity_)
     {
-      SPDLOG_ERROR("Failed to create the semaphore for render finished, exiting...");
-      std::exit(EXIT_FAILURE);
+      SPDLOG_ERROR(
+          "{} instances in one frame exceed the {} a storage buffer can address", needed, max_instance_capacity_);
+      throw std::runtime_error("Too many instances in one frame!");
     }
 
-    VkFenceCreateInfo fence_info = NULL_STRUCT;
-    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;  // Start the fence in signaled state
+    // Doubling keeps the regrowths to a handful over the first frames
+    constexpr std::uint64_t kMinInstanceCapacity = 64 * 1024;
+    const std::uint32_t capacity = static_cast<std::uint32_t>(
+        std::clamp<std::uint64_t>(std::bit_ceil(needed), kMinInstanceCapacity, max_instance_capacity_));
+    Buffer buffer = allocator_->CreateBuffer(
+        capacity * kInstanceStride, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MemoryUsage::kCpuToGpu);
+    if (buffer.buffer_ == VK_NULL_HANDLE || buffer.allocation_.mapped_ == nullptr)
+    {
+      throw std::runtime_error("Failed to create an instance buffer!");
+    }
 
-    if (vkCreateFence(logical_device_, &fence_info, VK_NULL_HANDLE, &still_rendering_fence_) != VK_SUCCESS)
+    // Draws queued earlier in the frame keep their instance ranges, the sections move one by one
+    if (frame.instance_count_ > 0)
     {
-      SPDLOG_ERROR("Failed to create the still rendering fence, exiting...");
-      std::exit(EXIT_FAILURE);
+      const std::uint8_t* old_base = frame.instance_buffer_.allocation_.mapped_;
+      std::uint8_t* new_base = buffer.allocation_.mapped_;
+      VkDeviceSize old_offset = 0;
+      VkDeviceSize new_offset = 0;
+      for (VkDeviceSize element_size : {sizeof(InstanceTransform), sizeof(InstanceColor), sizeof(InstanceMaterial)})
+      {
+        std::memcpy(new_base + new_offset, old_base + old_offset, frame.instance_count_ * element_size);
+        old_offset += frame.instance_capacity_ * element_size;
+        new_offset += capacity * element_size;
+      }
+    }
+
+    // This slot's previous frames retired at its fence, but the buffer may have been named by draws already queued
+    if (frame.instance_buffer_.buffer_ != VK_NULL_HANDLE)
+    {
+      deletion_queue_.Push(
+          frame_number_,
+          [this, retired = frame.instance_buffer_, index = frame.instance_buffer_index_]() mutable
+          {
+            bindless_table_->ReleaseBuffer(index);
+            allocator_->DestroyBuffer(retired);
+          });
     }
+    frame.instance_buffer_ = buffer;
+    frame.instance_buffer_index_ = bindless_table_->RegisterBuffer(buffer.buffer_);
+    frame.instance_capacity_ = capacity;
   }
 
-  void Graphics::BeginFrame()
+  void Graphics::RecordDraws(
+      VkCommandBuffer command_buffer, gsl::span<const SortEntry> order, bool draw_scene, bool depth_only)
   {
-    // Wait for the fence to be signaled before starting a new frame
-    vkWaitForFences(logical_device_, 1, &still_rendering_fence_, VK_TRUE, UINT64_MAX);
-    // Reset the fence for the next frame
-    vkResetFences(logical_device_, 1, &still_rendering_fence_);
+    // Secondary command buffers inherit none of the primary's state
+    VkViewport viewport = GetViewport();
+    VkRect2D scissor = GetScissor();
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
 
-    // Reset the command buffer for the new frame
-    vkAcquireNextImageKHR(
-        logical_device_, swap_chain_, UINT64_MAX, image_available_signal_, VK_NULL_HANDLE, &current_image_index_);
+    // The bindless table stays bound for the whole slice, rebinding set 0 with a compatible layout keeps it
+    VkDescriptorSet bindless_set = bindless_table_->GetSet();
+    vkCmdBindDescriptorSets(
+        command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 1, 1, &bindless_set, 0, nullptr);
 
-    // Begin the command buffer for the current frame
-    BeginCommands();
-  }
+    if (draw_scene)
+    {
+      RecordSceneDraws(command_buffer, depth_only);
+    }
+
+    // Draws whose pipeline is still compiling are skipped. After a prepass a draw only shows where it wrote depth,
+    // so it needs both of its pipelines in both passes.
+    const VkPipeline basic_pipeline = pipeline_registry_->Get(basic_pipeline_);
+    const VkPipeline untextured_pipeline = pipeline_registry_->Get(untextured_pipeline_);
+    const VkPipeline instanced_pipeline = pipeline_registry_->Get(instanced_pipeline_);
+    const bool prepass = settings_.depth_prepass_;
+    const VkPipeline depth_pipeline = prepass ? pipeline_registry_->Get(depth_pipeline_) : VK_NULL_HANDLE;
+    const VkPipeline instanced_depth_pipeline =
+        prepass ? pipeline_registry_->Get(instanced_depth_pipeline_) : VK_NULL_HANDLE;
+
+    // What the command buffer holds, the sorted order makes most draws match the previous one. The scene draws
+    // above leave their own state behind, so everything starts unknown.
+    VkPipeline bound_pipeline = VK_NULL_HANDLE;
+    std::optional<MeshHandle> bound_mesh = std::nullopt;
+    std::optional<std::array<std::uint32_t, UniformRing::kBindingCount>> bound_offsets = std::nullopt;
+    std::optional<DrawPushConstants> pushed_constants = std::nullopt;
+
+    const FrameData& frame = CurrentFrame();
+    VkDescriptorSet set = uniform_ring_->GetSet();
+    VkDeviceSize vertex_offset = 0;
+    for (const SortEntry& entry : order)
+    {
+      const DrawCommand& draw = draw_list_[entry.index_];
+      const bool instanced = draw.instance_count_ > 0;
+      const VkPipeline color_pipeline = instanced                  ? instanced_pipeline
+                                        : draw.texture_.has_value() ? basic_pipeline
+                                                                    : untextured_pipeline;
+      const VkPipeline draw_depth_pipeline = instanced ? instanced_depth_pipeline : depth_pipeline;
+      const VkPipeline pipeline = depth_only ? draw_depth_pipeline : color_pipeline;
+      const Mesh& drawn = meshes_[draw.mesh_];
+      const bool compiled =
+          color_pipeline != VK_NULL_HANDLE && (!prepass || draw_depth_pipeline != VK_NULL_HANDLE);
+      if (!compiled || !uploader_->IsReady(drawn.ready_ticket_))
+      {
+        continue;  // Still compiling or uploading
+      }
+      if (pipeline != bound_pipeline)
+      {
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        bound_pipeline = pipeline;
+      }
+
+      DrawPushConstants push_constants;
+      push_constants.texture_index_ = default_texture_;
+      push_constants.sampler_index_ = BindlessTable::kLinearRepeatSampler;
+      auto texture_it = draw.texture_.has_value() ? textures_.find(*draw.texture_) : textures_.end();
+      if (texture_it != textures_.end() && uploader_->IsReady(texture_it->second.ready_ticket_))
+      {
+        push_constants.texture_index_ = *draw.texture_;
+      }
+
+      // Per-draw data costs a copy into the ring and a rebind of the same set with new offsets. Instances read
+      // theirs from the instance buffer and leave the draw binding unused, consecutive ones bind the set once.
+      std::uint32_t draw_offset = *frame_uniforms_offset_;
+      if (instanced)
+      {
+        push_constants.buffer_index_ = frame.instance_buffer_index_;
+        push_constants.instance_capacity_ = frame.instance_capacity_;
+      }
+      else
+      {
+        DrawUniforms draw_uniforms;
+        draw_uniforms.model_ = draw.model_;
+        draw_offset = uniform_ring_->Push(draw_uniforms);
+      }
+      std::array<std::uint32_t, UniformRing::kBindingCount> offsets = {
+          *frame_uniforms_offset_, draw_offset, draw_offset};
+      if (offsets != bound_offsets)
+      {
+        vkCmdBindDescriptorSets(
+            command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 0, 1, &set, offsets.size(),
+            offsets.data());
+        bound_offsets = offsets;
+      }
+      if (push_constants != pushed_constants)
+      {
+        vkCmdPushConstants(
+            command_buffer, pipeline_layout_,
+            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 0,
+            sizeof(push_constants), &push_constants);
+        pushed_constants = push_constants;
+      }
+
+      if (draw.mesh_ != bound_mesh)
+      {
+        vkCmdBindVertexBuffers(command_buffer, 0, 1, &drawn.vertex_buffer_.buffer_, &vertex_offset);
+        vkCmdBindIndexBuffer(command_buffer, drawn.index_buffer_.buffer_, 0, drawn.index_type_);
+        bound_mesh = draw.mesh_;
+      }
+      // gl_InstanceIndex starts at the first instance, which is where the draw's instances sit in each stream
+      vkCmdDrawIndexed(
+          command_buffer, drawn.index_count_, std::max(draw.instance_count_, 1u), 0, 0, draw.first_instance_);
+    }
+  }
+
+  void Graphics::RecordSceneDraws(VkCommandBuffer command_buffer, bool depth_only)
+  {
+    const GpuScene::Generation& scene = *gpu_scene_->GetCurrent();
+    const PipelineHandle pipeline = depth_only ? scene_depth_pipeline_ : scene_pipeline_;
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_registry_->Get(pipeline));
+
+    // Objects read their transform and material from the object buffer, only the frame binding is used
+    VkDescriptorSet set = uniform_ring_->GetSet();
+    std::array<std::uint32_t, UniformRing::kBindingCount> offsets = NULL_STRUCT;
+    offsets.fill(*frame_uniforms_offset_);
+    vkCmdBindDescriptorSets(
+        command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 0, 1, &set, offsets.size(), offsets.data());
+    DrawPushConstants push_constants;
+    push_constants.texture_index_ = default_texture_;
+    push_constants.sampler_index_ = BindlessTable::kLinearRepeatSampler;
+    push_constants.buffer_index_ = scene.object_buffer_index_;
+    vkCmdPushConstants(
+        command_buffer, pipeline_layout_,
+        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 0,
+        sizeof(push_constants), &push_constants);
+
+    // One draw per mesh, the culling pass wrote how many of its commands are live
+    VkDeviceSize vertex_offset = 0;
+    for (std::uint32_t batch_index = 0; batch_index < scene.batches_.size(); batch_index++)
+    {
+      const GpuScene::Batch& batch = scene.batches_[batch_index];
+      const Mesh& drawn = meshes_[batch.mesh_];
+      if (!uploader_->IsReady(drawn.ready_ticket_))
+      {
+        continue;
+      }
+      vkCmdBindVertexBuffers(command_buffer, 0, 1, &drawn.vertex_buffer_.buffer_, &vertex_offset);
+      vkCmdBindIndexBuffer(command_buffer, drawn.index_buffer_.buffer_, 0, drawn.index_type_);
+      vkCmdDrawIndexedIndirectCount(
+          command_buffer, scene.command_buffer_.buffer_, batch.first_command_ * sizeof(VkDrawIndexedIndirectCommand),
+          scene.count_buffer_.buffer_, batch_index * sizeof(std::uint32_t),
+          std::min(batch.command_count_, max_draw_indirect_count_), sizeof(VkDrawIndexedIndirectCommand));
+    }
+  }
+
+  // Orders the memory accesses of everything before against everything after, for buffers used in several stages
+  static void PipelineBarrier(
+      VkCommandBuffer command_buffer, VkPipelineStageFlags2 src_stage, VkAccessFlags2 src_access,
+      VkPipelineStageFlags2 dst_stage, VkAccessFlags2 dst_access)
+  {
+    VkMemoryBarrier2 barrier = NULL_STRUCT;
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    barrier.srcStageMask = src_stage;
+    barrier.srcAccessMask = src_access;
+    barrier.dstStageMask = dst_stage;
+    barrier.dstAccessMask = dst_access;
+
+    VkDependencyInfo dependency_info = NULL_STRUCT;
+    dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependency_info.memoryBarrierCount = 1;
+    dependency_info.pMemoryBarriers = &barrier;
+    vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+  }
+
+  void Graphics::RecordCulling(VkCommandBuffer command_buffer)
+  {
+    const GpuScene::Generation* scene = gpu_scene_->GetCurrent();
+    const VkPipeline cull_pipeline = pipeline_registry_->Get(cull_pipeline_);
+
+    ZoneScoped;
+    TracyVkZone(tracy_context_, command_buffer, "Culling");
+    const std::uint32_t cull_scope = gpu_queries_->BeginScope(command_buffer, "Culling");
+
+    // The render graph ordered the clear after the previous frame's draws, the dispatch is ordered here
+    vkCmdFillBuffer(command_buffer, scene->count_buffer_.buffer_, 0, VK_WHOLE_SIZE, 0);
+    PipelineBarrier(
+        command_buffer, VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+        VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+    VkDescriptorSet set = uniform_ring_->GetSet();
+    std::array<std::uint32_t, UniformRing::kBindingCount> offsets = NULL_STRUCT;
+    offsets.fill(*frame_uniforms_offset_);
+    std::array<VkDescriptorSet, 2> sets = {set, bindless_table_->GetSet()};
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline);
+    vkCmdBindDescriptorSets(
+        command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0, sets.size(), sets.data(), offsets.size(),
+        offsets.data());
+    CullPushConstants push_constants;
+    push_constants.object_buffer_ = scene->object_buffer_index_;
+    push_constants.batch_buffer_ = scene->batch_buffer_index_;
+    push_constants.command_buffer_ = scene->command_buffer_index_;
+    push_constants.count_buffer_ = scene->count_buffer_index_;
+    push_constants.object_count_ = scene->object_count_;
+    vkCmdPushConstants(
+        command_buffer, pipeline_layout_,
+        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 0,
+        sizeof(push_constants), &push_constants);
+    vkCmdDispatch(command_buffer, (scene->object_count_ + kCullGroupSize - 1) / kCullGroupSize, 1, 1);
+
+    gpu_queries_->EndScope(command_buffer, cull_scope);
+  }
+
+  // The list is recorded in one pass for now, later passes get their own range of keys
+  static constexpr std::uint32_t kMainPass = 0;
+
+  void Graphics::SortDrawList()
+  {
+    ZoneScoped;
+    // Keyed at record time, once the frame's view is final
+    render_queue_.Clear();
+    render_queue_.Reserve(draw_list_.size());
+    for (std::uint32_t i = 0; i < draw_list_.size(); i++)
+    {
+      const DrawCommand& draw = draw_list_[i];
+      const PipelineHandle pipeline = draw.instance_count_ > 0 ? instanced_pipeline_
+                                      : draw.texture_.has_value() ? basic_pipeline_
+                                                                  : untextured_pipeline_;
+      // Depth of the model origin, nearer draws first within the same state
+      const glm::vec4 origin = frame_uniforms_.view_projection_ * draw.model_[3];
+      const float depth = origin.w > 0.0f ? origin.z / origin.w : 0.0f;
+      render_queue_.Push(
+          RenderQueue::MakeKey(kMainPass, pipeline, draw.texture_.value_or(default_texture_), draw.mesh_, depth), i);
+    }
+    render_queue_.Sort();
+  }
+
+  void Graphics::RecordDrawList()
+  {
+    ZoneScoped;
+
+    // Nothing is drawn until the fallback texture landed, the pass still clears
+    const bool default_texture_ready = uploader_->IsReady(textures_.at(default_texture_).ready_ticket_);
+    if (!default_texture_ready)
+    {
+      draw_list_.clear();
+    }
+
+    // Swapped after the acquires, so a scene upload that landed is culled and drawn this very frame
+    gpu_scene_->Update(
+        frame_number_,
+        [this](BindlessIndex material)
+        {
+          auto texture_it = textures_.find(material);
+          const bool ready = texture_it != textures_.end() && uploader_->IsReady(texture_it->second.ready_ticket_);
+          return ready ? material : default_texture_;
+        });
+    const bool scene_visible = default_texture_ready && gpu_scene_->GetCurrent() != nullptr;
+
+    if ((!draw_list_.empty() || scene_visible) && !frame_uniforms_offset_.has_value())
+    {
+      frame_uniforms_offset_ = uniform_ring_->Push(frame_uniforms_);
+    }
+    // Culling waits for all of the scene's pipelines to be built
+    const bool scene_depth_ready =
+        !settings_.depth_prepass_ || pipeline_registry_->Get(scene_depth_pipeline_) != VK_NULL_HANDLE;
+    const bool draw_scene = scene_visible && pipeline_registry_->Get(cull_pipeline_) != VK_NULL_HANDLE &&
+                            pipeline_registry_->Get(scene_pipeline_) != VK_NULL_HANDLE && scene_depth_ready;
+    SortDrawList();
+
+    // The previous contents are never read, the attachment clears. Headless frames are never presented, they are
+    // left ready to be copied out instead.
+    const RenderResource target = render_graph_->ImportImage(
+        swap_chain_images_[current_image_index_], swap_chain_image_views_[current_image_index_],
+        VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+        IsHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    // Only lives through the frame's passes, the render graph gives it memory
+    const RenderResource depth = render_graph_->CreateImage(TransientImageDescription{
+        depth_format_, extent_, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT});
+    const bool prepass = settings_.depth_prepass_;
+    std::vector<ResourceAccess> main_pass_accesses = {
+        {target, ResourceUsage::kColorAttachment},
+        {depth, prepass ? ResourceUsage::kDepthRead : ResourceUsage::kDepthAttachment}};
+    std::vector<ResourceAccess> prepass_accesses = {{depth, ResourceUsage::kDepthAttachment}};
+    if (draw_scene)
+    {
+      // Last read by the previous frame's draws
+      const GpuScene::Generation* scene = gpu_scene_->GetCurrent();
+      const RenderResource counts = render_graph_->ImportBuffer(
+          scene->count_buffer_.buffer_, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_NONE);
+      const RenderResource commands = render_graph_->ImportBuffer(
+          scene->command_buffer_.buffer_, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_NONE);
+      std::vector<ResourceAccess> culling_accesses = {
+          {counts, ResourceUsage::kTransferWrite},
+          {counts, ResourceUsage::kStorageWrite},
+          {commands, ResourceUsage::kStorageWrite}};
+      for (std::vector<ResourceAccess>* accesses : {&main_pass_accesses, &prepass_accesses})
+      {
+        accesses->push_back({counts, ResourceUsage::kIndirectRead});
+        accesses->push_back({commands, ResourceUsage::kIndirectRead});
+      }
+      // Moved objects are written in place, after the previous frames' culling and draws read the object buffer
+      if (gpu_scene_->HasTransformUpdates())
+      {
+        const RenderResource objects = render_graph_->ImportBuffer(
+            scene->object_buffer_.buffer_,
+            VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_NONE);
+        render_graph_->AddPass(
+            "Scene update", {{objects, ResourceUsage::kTransferWrite}},
+            [this](VkCommandBuffer command_buffer)
+            {
+              gpu_scene_->RecordTransformUpdates(command_buffer);
+            });
+        for (std::vector<ResourceAccess>* accesses : {&culling_accesses, &main_pass_accesses, &prepass_accesses})
+        {
+          accesses->push_back({objects, ResourceUsage::kStorageRead});
+        }
+      }
+      render_graph_->AddPass(
+          "Culling", std::move(culling_accesses),
+          [this](VkCommandBuffer command_buffer)
+          {
+            RecordCulling(command_buffer);
+          });
+    }
+
+    if (prepass)
+    {
+      render_graph_->AddPass(
+          "Depth prepass", std::move(prepass_accesses),
+          [this, depth, draw_scene](VkCommandBuffer command_buffer)
+          {
+            RecordDrawPass(command_buffer, VK_NULL_HANDLE, render_graph_->GetImageView(depth), draw_scene);
+          });
+    }
+    render_graph_->AddPass(
+        "Main pass", std::move(main_pass_accesses),
+        [this, target, depth, draw_scene](VkCommandBuffer command_buffer)
+        {
+          RecordDrawPass(
+              command_buffer, render_graph_->GetImageView(target), render_graph_->GetImageView(depth), draw_scene);
+        });
+    render_graph_->Execute(CurrentCommandBuffer(), current_frame_);
+    draw_list_.clear();
+  }
+
+  void Graphics::RecordDrawPass(
+      VkCommandBuffer command_buffer, VkImageView color_target, VkImageView depth_target, bool draw_scene)
+  {
+    ZoneScoped;
+    FrameData& frame = CurrentFrame();
+    const bool depth_only = color_target == VK_NULL_HANDLE;
+    const gsl::czstring pass_name = depth_only ? "Depth prepass" : "Main pass";
+    std::vector<VkCommandBuffer>& slice_command_buffers =
+        depth_only ? frame.prepass_slice_command_buffers_ : frame.slice_command_buffers_;
+    gsl::span<const SortEntry> order = render_queue_.GetEntries();
+
+    // Slices below the threshold cost more in secondary buffer overhead than they win back
+    const std::uint32_t draw_count = static_cast<std::uint32_t>(draw_list_.size());
+    const std::uint32_t thread_count = jobs_->GetThreadCount();
+    const std::uint32_t slice_size =
+        std::max(settings_.draws_per_recording_slice_, (draw_count + thread_count - 1) / thread_count);
+    const std::uint32_t slice_count = (draw_count + slice_size - 1) / slice_size;
+    const bool use_secondaries = slice_count > 1;
+
+    VkRenderingAttachmentInfo color_attachment = NULL_STRUCT;
+    color_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    color_attachment.imageView = color_target;
+    color_attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    color_attachment.clearValue = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
+
+    // Kept from the prepass when there is one, never needed after the frame. After a prepass the main pass only
+    // reads depth: STORE_OP_NONE, as DONT_CARE would count as a write the render graph does not know about.
+    const bool depth_read_only = !depth_only && settings_.depth_prepass_;
+    VkRenderingAttachmentInfo depth_attachment = NULL_STRUCT;
+    depth_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    depth_attachment.imageView = depth_target;
+    depth_attachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+    depth_attachment.loadOp = depth_read_only ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+    if (depth_only)
+    {
+      depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    }
+    else
+    {
+      depth_attachment.storeOp = depth_read_only ? VK_ATTACHMENT_STORE_OP_NONE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    }
+    depth_attachment.clearValue.depthStencil = {1.0f, 0};
+
+    VkRenderingInfo rendering_info = NULL_STRUCT;
+    rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+    rendering_info.flags = use_secondaries ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0;
+    rendering_info.renderArea.offset = {0, 0};
+    rendering_info.renderArea.extent = extent_;
+    rendering_info.layerCount = 1;
+    rendering_info.colorAttachmentCount = depth_only ? 0 : 1;
+    rendering_info.pColorAttachments = &color_attachment;
+    rendering_info.pDepthAttachment = &depth_attachment;
+
+    TracyVkZoneTransient(tracy_context_, pass_zone, command_buffer, pass_name, true);
+    const std::uint32_t pass_scope = gpu_queries_->BeginScope(command_buffer, pass_name);
+    vkCmdBeginRendering(command_buffer, &rendering_info);
+
+    if (!use_secondaries)
+    {
+      if (draw_count > 0 || draw_scene)
+      {
+        RecordDraws(command_buffer, order, draw_scene, depth_only);
+      }
+    }
+    else
+    {
+      // Secondaries continue the pass knowing only its attachment formats
+      VkCommandBufferInheritanceRenderingInfo inheritance_rendering_info = NULL_STRUCT;
+      inheritance_rendering_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+      inheritance_rendering_info.colorAttachmentCount = depth_only ? 0 : 1;
+      inheritance_rendering_info.pColorAttachmentFormats = &surface_format_.format;
+      inheritance_rendering_info.depthAttachmentFormat = depth_format_;
+      inheritance_rendering_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+      VkCommandBufferInheritanceInfo inheritance_info = NULL_STRUCT;
+      inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+      inheritance_info.pNext = &inheritance_rendering_info;
+      inheritance_info.pipelineStatistics = gpu_queries_->GetStatisticsFlags();
+
+      // Slice i records into its own pool and secondary, on whichever thread picks it up
+      std::vector<std::exception_ptr> errors(slice_count);
+      auto record_slice = [&](std::uint32_t slice)
+      {
+        ZoneScopedN("Record slice");
+        try
+        {
+          VkCommandBuffer secondary = slice_command_buffers[slice];
+          VkCommandBufferBeginInfo begin_info = NULL_STRUCT;
+          begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+          begin_info.flags =
+              VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+          begin_info.pInheritanceInfo = &inheritance_info;
+          if (vkBeginCommandBuffer(secondary, &begin_info) != VK_SUCCESS)
+          {
+            throw std::runtime_error("Failed to begin a secondary command buffer!");
+          }
+
+          const std::uint32_t first = slice * slice_size;
+          const std::uint32_t count = std::min(slice_size, draw_count - first);
+          // The scene's indirect draws go first, ahead of the queued ones
+          RecordDraws(secondary, order.subspan(first, count), draw_scene && slice == 0, depth_only);
+
+          if (vkEndCommandBuffer(secondary) != VK_SUCCESS)
+          {
+            throw std::runtime_error("Failed to end a secondary command buffer!");
+          }
+        }
+        catch (...)
+        {
+          errors[slice] = std::current_exception();
+        }
+      };
+
+      JobCounter slices_recorded;
+      for (std::uint32_t slice = 0; slice < slice_count; slice++)
+      {
+        jobs_->Submit(
+            [&record_slice, slice]()
+            {
+              record_slice(slice);
+            },
+            &slices_recorded);
+      }
+      jobs_->Wait(slices_recorded);
+
+      for (std::exception_ptr& error : errors)
+      {
+        if (error != nullptr)
+        {
+          SPDLOG_ERROR("Failed to record a draw slice");
+          std::rethrow_exception(error);
+        }
+      }
+
+      // Executed in slice order, so the draws keep their sorted order
+      vkCmdExecuteCommands(command_buffer, slice_count, slice_command_buffers.data());
+    }
+
+    vkCmdEndRendering(command_buffer);
+    gpu_queries_->EndScope(command_buffer, pass_scope);
+  }
+
+  void Graphics::EndCommands()
+  {
+    VkCommandBuffer command_buffer = CurrentCommandBuffer();
+    RecordDrawList();
+    gpu_queries_->EndStatistics(command_buffer);
+    gpu_queries_->EndScope(command_buffer, frame_scope_);
+
+    VkResult end_buffer_result = vkEndCommandBuffer(command_buffer);
+    if (end_buffer_result != VK_SUCCESS)
+    {
+      SPDLOG_ERROR("Failed to End commands buffer, exiting...");
+      throw std::runtime_error("Failed to end commands buffer!");
+    }
+  }
+
+  void Graphics::CreateProfiling()
+  {
+    const std::uint32_t graphics_family = FindQueueFamilies(physical_device_).graphics_family_.value();
+    gpu_queries_ = std::make_unique<GpuQueryPool>(
+        physical_device_, logical_device_, graphics_family, static_cast<std::uint32_t>(frames_.size()),
+        pipeline_statistics_enabled_);
+
+    // Tracy calibrates its context with a few submits of its own, from a pool it may reset buffers of
+    VkCommandPoolCreateInfo pool_info = NULL_STRUCT;
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = graphics_family;
+    VkCommandPool pool = VK_NULL_HANDLE;
+    if (vkCreateCommandPool(logical_device_, &pool_info, VK_NULL_HANDLE, &pool) != VK_SUCCESS)
+    {
+      SPDLOG_ERROR("Failed to create the profiler command pool, exiting...");
+      std::exit(EXIT_FAILURE);
+    }
+
+    VkCommandBufferAllocateInfo info = NULL_STRUCT;
+    info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    info.commandPool = pool;
+    info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    info.commandBufferCount = 1;
+    VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+    if (vkAllocateCommandBuffers(logical_device_, &info, &command_buffer) != VK_SUCCESS)
+    {
+      SPDLOG_ERROR("Failed to allocate the profiler command buffer, exiting...");
+      std::exit(EXIT_FAILURE);
+    }
+
+    tracy_context_ = TracyVkContext(physical_device_, logical_device_, graphics_queue_, command_buffer);
+    vkDestroyCommandPool(logical_device_, pool, VK_NULL_HANDLE);
+  }
+
+  void Graphics::CreateSignals()
+  {
+    VkSemaphoreCreateInfo semaphore_info = NULL_STRUCT;
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    VkFenceCreateInfo fence_info = NULL_STRUCT;
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;  // Start the fence in signaled state
+
+    for (FrameData& frame : frames_)
+    {
+      if (vkCreateSemaphore(logical_device_, &semaphore_info, VK_NULL_HANDLE, &frame.image_available_signal_) !=
+          VK_SUCCESS)
+      {
+        SPDLOG_ERROR("Failed to create the semaphore for image available, exiting...");
+        std::exit(EXIT_FAILURE);
+      }
+
+      if (vkCreateFence(logical_device_, &fence_info, VK_NULL_HANDLE, &frame.still_rendering_fence_) != VK_SUCCESS)
+      {
+        SPDLOG_ERROR("Failed to create the still rendering fence, exiting...");
+        std::exit(EXIT_FAILURE);
+      }
+    }
+
+    CreateRenderFinishedSignals();
+  }
+
+  void Graphics::CreateRenderFinishedSignals()
+  {
+    VkSemaphoreCreateInfo semaphore_info = NULL_STRUCT;
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    render_finished_signals_.resize(swap_chain_images_.size());
+    for (VkSemaphore& render_finished_signal : render_finished_signals_)
+    {
+      if (vkCreateSemaphore(logical_device_, &semaphore_info, VK_NULL_HANDLE, &render_finished_signal) != VK_SUCCESS)
+      {
+        SPDLOG_ERROR("Failed to create the semaphore for render finished, exiting...");
+        std::exit(EXIT_FAILURE);
+      }
+    }
+  }
+
+  void Graphics::BeginFrame()
+  {
+    ZoneScoped;
+    FrameData& frame = CurrentFrame();
+
+    // Wait until the GPU is done with the last frame that used this slot, frames in the other slots keep running
+    auto fence_start = std::chrono::steady_clock::now();
+    {
+      ZoneScopedN("Fence wait");
+      vkWaitForFences(logical_device_, 1, &frame.still_rendering_fence_, VK_TRUE, UINT64_MAX);
+    }
+    frame_timings_.fence_wait_ms_ = ElapsedMilliseconds(fence_start);
+
+    // Every frame up to the one that last used this slot has retired
+    if (frame_number_ >= frames_.size())
+    {
+      deletion_queue_.Flush(frame_number_ - frames_.size());
+    }
+    // The fence above also means the GPU is done with this slot's transient memory and uniforms
+    allocator_->BeginFrame(current_frame_);
+    uniform_ring_->BeginFrame(current_frame_);
+    frame.instance_count_ = 0;
+    frame_uniforms_offset_.reset();
+    if (shader_watcher_ != nullptr)
+    {
+      ReloadShaders();
+    }
+    // Saved as soon as new pipelines land rather than only at shutdown, a crash keeps what the session compiled.
+    // Save() skips the write when nothing changed.
+    const bool pipelines_compiling = pipeline_registry_->IsCompiling();
+    if (pipelines_compiling_ && !pipelines_compiling)
+    {
+      ZoneScopedN("Save pipeline cache");
+      pipeline_cache_->Save();
+    }
+    pipelines_compiling_ = pipelines_compiling;
+
+    // Acquire the next swapchain image, headless frames simply own the offscreen image of their slot
+    auto acquire_start = std::chrono::steady_clock::now();
+    if (IsHeadless())
+    {
+      current_image_index_ = current_frame_;
+    }
+    else
+    {
+      ZoneScopedN("Acquire");
+      VkResult acquire_result = vkAcquireNextImageKHR(
+          logical_device_, swap_chain_, UINT64_MAX, frame.image_available_signal_, VK_NULL_HANDLE,
+          &current_image_index_);
+
+      // Nothing was signaled on failure, so the same semaphore can be used again with the new swapchain
+      while (acquire_result == VK_ERROR_OUT_OF_DATE_KHR)
+      {
+        RecreateSwapChain();
+        acquire_result = vkAcquireNextImageKHR(
+            logical_device_, swap_chain_, UINT64_MAX, frame.image_available_signal_, VK_NULL_HANDLE,
+            &current_image_index_);
+      }
+
+      // Suboptimal images are still presentable, the swapchain gets recreated after presenting
+      if (acquire_result != VK_SUCCESS && acquire_result != VK_SUBOPTIMAL_KHR)
+      {
+        SPDLOG_ERROR("Failed to acquire the next swapchain image");
+        throw std::runtime_error("Failed to acquire swapchain image!");
+      }
+    }
+    frame_timings_.acquire_ms_ = ElapsedMilliseconds(acquire_start);
+
+    // Only reset the fence once this frame is certain to be submitted
+    vkResetFences(logical_device_, 1, &frame.still_rendering_fence_);
+
+    // Everything recorded in this slot's pool has retired, recycle it in one go
+    vkResetCommandPool(logical_device_, frame.command_pool_, 0);
+    for (VkCommandPool slice_pool : frame.slice_command_pools_)
+    {
+      vkResetCommandPool(logical_device_, slice_pool, 0);
+    }
+
+    // Begin the command buffer for the current frame
+    BeginCommands();
+  }
+
+  void Graphics::EndFrame()
+  {
+    ZoneScoped;
+    FrameData& frame = CurrentFrame();
+    VkSemaphore render_finished_signal = render_finished_signals_[current_image_index_];
 
-  void Graphics::EndFrame()
-  {
     // End the command buffer for the current frame
     EndCommands();
 
     // Submit the command buffer for execution
-    VkSubmitInfo submit_info = NULL_STRUCT;
-    VkPipelineStageFlags wait_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submit_info.waitSemaphoreCount = 1;
-    submit_info.pWaitSemaphores = &image_available_signal_;
-    submit_info.pWaitDstStageMask = &wait_stages;
-    submit_info.commandBufferCount = 1;
-    submit_info.pCommandBuffers = &command_buffer_;
-    submit_info.signalSemaphoreCount = 1;
-    submit_info.pSignalSemaphores = &render_finished_singal_;
+    std::array<VkSemaphoreSubmitInfo, 2> wait_infos = NULL_STRUCT;
+    std::uint32_t wait_count = 0;
+    // Nothing was acquired nor will be presented when headless
+    if (!IsHeadless())
+    {
+      // Waiting at the same stage as the layout transition out of UNDEFINED chains the two
+      wait_infos[wait_count].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+      wait_infos[wait_count].semaphore = frame.image_available_signal_;
+      wait_infos[wait_count].stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+      wait_count++;
+    }
+    // The uploads acquired this frame must have landed, usually they long have
+    if (uploader_->GetAcquiredValue() > 0)
+    {
+      wait_infos[wait_count].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+      wait_infos[wait_count].semaphore = uploader_->GetTimeline();
+      wait_infos[wait_count].value = uploader_->GetAcquiredValue();
+      wait_infos[wait_count].stageMask = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT |
+                                         VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT |
+                                         VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT |
+                                         VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+      wait_count++;
+    }
+
+    VkCommandBufferSubmitInfo command_buffer_info = NULL_STRUCT;
+    command_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+    command_buffer_info.commandBuffer = frame.command_buffer_;
+
+    // At ALL_COMMANDS, which the render graph's final layout transitions chain into, so presentation waits for them
+    VkSemaphoreSubmitInfo signal_info = NULL_STRUCT;
+    signal_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    signal_info.semaphore = render_finished_signal;
+    signal_info.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+    VkSubmitInfo2 submit_info = NULL_STRUCT;
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+    submit_info.commandBufferInfoCount = 1;
+    submit_info.pCommandBufferInfos = &command_buffer_info;
+    submit_info.waitSemaphoreInfoCount = wait_count;
+    submit_info.pWaitSemaphoreInfos = wait_infos.data();
+    if (!IsHeadless())
+    {
+      submit_info.signalSemaphoreInfoCount = 1;
+      submit_info.pSignalSemaphoreInfos = &signal_info;
+    }
 
     // Submit the command buffer to the graphics queue
     // The command buffer will be executed when the image is available
     // and the render finished semaphore will be signaled when the command buffer execution is complete.
-    // The still_rendering_fence will be signaled when the command buffer execution is complete.
-    VkResult submit_result = vkQueueSubmit(graphics_queue_, 1, &submit_info, still_rendering_fence_);
-    if (submit_result != VK_SUCCESS)
+    // The frame's still_rendering_fence will be signaled when the command buffer execution is complete.
     {
-      SPDLOG_ERROR("Failed to submit the draw command buffer, exiting...");
-      throw std::runtime_error("Failed to submit draw command buffer!");
+      ZoneScopedN("Submit");
+      VkResult submit_result = vkQueueSubmit2(graphics_queue_, 1, &submit_info, frame.still_rendering_fence_);
+      if (submit_result != VK_SUCCESS)
+      {
+        SPDLOG_ERROR("Failed to submit the draw command buffer, exiting...");
+        throw std::runtime_error("Failed to submit draw command buffer!");
+      }
     }
 
     // Present the rendered image to the swap chain
-    VkPresentInfoKHR present_info = NULL_STRUCT;
-    present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-    present_info.waitSemaphoreCount = 1;
-    present_info.pWaitSemaphores = &render_finished_singal_;
-    present_info.swapchainCount = 1;
-    present_info.pSwapchains = &swap_chain_;
-    present_info.pImageIndices = &current_image_index_;
+    auto present_start = std::chrono::steady_clock::now();
+    if (!IsHeadless())
+    {
+      ZoneScopedN("Present");
+      VkPresentInfoKHR present_info = NULL_STRUCT;
+      present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+      present_info.waitSemaphoreCount = 1;
+      present_info.pWaitSemaphores = &render_finished_signal;
+      present_info.swapchainCount = 1;
+      present_info.pSwapchains = &swap_chain_;
+      present_info.pImageIndices = &current_image_index_;
+
+      VkResult present_result = vkQueuePresentKHR(presentation_queue_, &present_info);
+      const bool resized = window_->ConsumeFramebufferResized();
+      if (present_result == VK_ERROR_OUT_OF_DATE_KHR || present_result == VK_SUBOPTIMAL_KHR || resized)
+      {
+        RecreateSwapChain();
+      }
+      else if (present_result != VK_SUCCESS)
+      {
+        SPDLOG_ERROR("Failed to present the swapchain image");
+        throw std::runtime_error("Failed to present swapchain image!");
+      }
+    }
+    frame_timings_.present_ms_ = ElapsedMilliseconds(present_start);
+
+    frame_number_++;
+    FrameMark;
+
+    // Move on to the next slot, the CPU can now record it while the GPU works on this one
+    current_frame_ = (current_frame_ + 1) % frames_.size();
+  }
+
+#pragma endregion
+
+#pragma region BUFFERS
+  Buffer Graphics::CreateDeviceBuffer(
+      const void* data, VkDeviceSize size, VkBufferUsageFlags usage, UploadTicket& ticket)
+  {
+    // Vulkan has no zero-size buffers
+    if (size == 0)
+    {
+      throw std::runtime_error("Cannot create an empty device buffer!");
+    }
+    Buffer buffer = allocator_->CreateBuffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryUsage::kGpuOnly);
+    if (buffer.buffer_ == VK_NULL_HANDLE)
+    {
+      throw std::runtime_error("Failed to create a device buffer!");
+    }
+
+    ticket = uploader_->UploadBuffer(buffer, data, size);
+    return buffer;
+  }
+
+  MeshHandle Graphics::CreateMesh(gsl::span<const Vertex> vertices, gsl::span<const std::uint32_t> indices)
+  {
+    if (vertices.empty() || indices.empty())
+    {
+      throw std::runtime_error("Cannot create a mesh without vertices or indices!");
+    }
+    Mesh mesh;
+    mesh.vertex_buffer_ = CreateDeviceBuffer(
+        vertices.data(), vertices.size_bytes(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, mesh.ready_ticket_);
+    mesh.index_count_ = static_cast<std::uint32_t>(indices.size());
+    mesh.bounds_ = ComputeBoundingSphere(vertices);
+
+    // 16-bit indices halve the index fetch bandwidth whenever the vertex count allows them
+    if (vertices.size() <= std::numeric_limits<std::uint16_t>::max() + 1)
+    {
+      std::vector<std::uint16_t> narrow_indices(indices.begin(), indices.end());
+      mesh.index_type_ = VK_INDEX_TYPE_UINT16;
+      mesh.index_buffer_ = CreateDeviceBuffer(
+          narrow_indices.data(), narrow_indices.size() * sizeof(std::uint16_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+          mesh.ready_ticket_);
+    }
+    else
+    {
+      mesh.index_type_ = VK_INDEX_TYPE_UINT32;
+      mesh.index_buffer_ = CreateDeviceBuffer(
+          indices.data(), indices.size_bytes(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, mesh.ready_ticket_);
+    }
+
+    return AddMesh(mesh);
+  }
+
+  std::optional<MeshHandle> Graphics::LoadMesh(const std::filesystem::path& path)
+  {
+    ZoneScoped;
+    std::optional<MeshFile> file = MeshFile::Open(path);
+    if (!file.has_value())
+    {
+      return std::nullopt;
+    }
+    SPDLOG_DEBUG(
+        "Loaded {}: {} vertices, {} indices", path.string(), file->GetVertices().size(),
+        file->GetLods().front().index_count_);
+    return CreateMesh(*file);
+  }
+
+  MeshHandle Graphics::CreateMesh(const MeshFile& file)
+  {
+    // The only copy of each byte is the uploader's, from the mapping into its staging buffer
+    const MeshFileLod& full_lod = file.GetLods().front();
+    const std::uint32_t index_size = file.GetHeader().index_size_;
+    Mesh mesh;
+    mesh.vertex_buffer_ = CreateDeviceBuffer(
+        file.GetVertices().data(), file.GetVertices().size_bytes(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        mesh.ready_ticket_);
+    mesh.index_buffer_ = CreateDeviceBuffer(
+        file.GetIndexBytes().data() + std::uint64_t{full_lod.first_index_} * index_size,
+        std::uint64_t{full_lod.index_count_} * index_size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, mesh.ready_ticket_);
+    mesh.index_count_ = full_lod.index_count_;
+    mesh.index_type_ = file.GetIndexType();
+    mesh.bounds_ = file.GetHeader().bounds_;
+    return AddMesh(mesh);
+  }
+
+  MeshHandle Graphics::AddMesh(const Mesh& mesh)
+  {
+    if (!free_mesh_handles_.empty())
+    {
+      MeshHandle handle = free_mesh_handles_.back();
+      free_mesh_handles_.pop_back();
+      meshes_[handle] = mesh;
+      return handle;
+    }
+    meshes_.push_back(mesh);
+    return static_cast<MeshHandle>(meshes_.size() - 1);
+  }
+
+  BindlessIndex Graphics::CreateTexture(
+      std::uint32_t width, std::uint32_t height, gsl::span<const std::uint32_t> texels)
+  {
+    Texture texture;
+
+    VkImageCreateInfo image_info = NULL_STRUCT;
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = VK_FORMAT_R8G8B8A8_SRGB;
+    image_info.extent = {width, height, 1};
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    texture.image_ = allocator_->CreateImage(image_info, MemoryUsage::kGpuOnly);
+    if (texture.image_.image_ == VK_NULL_HANDLE)
+    {
+      throw std::runtime_error("Failed to create a texture image!");
+    }
 
-    vkQueuePresentKHR(presentation_queue_, &present_info);
+    VkImageViewCreateInfo view_info = NULL_STRUCT;
+    view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_info.image = texture.image_.image_;
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format = image_info.format;
+    view_info.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    if (vkCreateImageView(logical_device_, &view_info, VK_NULL_HANDLE, &texture.view_) != VK_SUCCESS)
+    {
+      allocator_->DestroyImage(texture.image_);
+      throw std::runtime_error("Failed to create a texture view!");
+    }
+
+    texture.ready_ticket_ =
+        uploader_->UploadImage(texture.image_, texels.data(), texels.size_bytes(), image_info.extent);
+
+    BindlessIndex index = bindless_table_->RegisterTexture(texture.view_);
+    textures_[index] = texture;
+    return index;
   }
 
+  void Graphics::DestroyTexture(BindlessIndex texture)
+  {
+    auto it = textures_.find(texture);
+    if (it == textures_.end())
+    {
+      return;
+    }
+
+    deletion_queue_.Push(
+        frame_number_,
+        [this, texture, retired = it->second]() mutable
+        {
+          bindless_table_->ReleaseTexture(texture);
+          vkDestroyImageView(logical_device_, retired.view_, VK_NULL_HANDLE);
+          allocator_->DestroyImage(retired.image_);
+        });
+    textures_.erase(it);
+  }
+
+  void Graphics::DestroyMesh(MeshHandle mesh)
+  {
+    deletion_queue_.Push(
+        frame_number_,
+        [this, retired = meshes_[mesh]]() mutable
+        {
+          allocator_->DestroyBuffer(retired.vertex_buffer_);
+          allocator_->DestroyBuffer(retired.index_buffer_);
+        });
+    meshes_[mesh] = Mesh();
+    free_mesh_handles_.push_back(mesh);
+  }
 #pragma endregion
 
-  Graphics::Graphics(gsl::not_null<Window*> window) : window_(window)
+  Graphics::Graphics(gsl::not_null<Window*> window, GraphicsSettings settings) : window_(window), settings_(settings)
   {
 #ifndef NDEBUG
     validation_enabled_ = true;
 #endif  // !NDEBUG
 
+    ApplySettings();
     IntializeVulkan();
   }
 
+  Graphics::Graphics(GraphicsSettings settings) : settings_(settings)
+  {
+#ifndef NDEBUG
+    validation_enabled_ = true;
+#endif  // !NDEBUG
+
+    SPDLOG_INFO("Running headless at {}x{}", settings_.headless_extent_.width, settings_.headless_extent_.height);
+    ApplySettings();
+    IntializeVulkan();
+  }
+
+  void Graphics::ApplySettings()
+  {
+    settings_.frames_in_flight_ = std::clamp(settings_.frames_in_flight_, 1u, kMaxFramesInFlight);
+    frames_.resize(settings_.frames_in_flight_);
+    if (settings_.worker_threads_ == 0)
+    {
+      settings_.worker_threads_ = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+    settings_.draws_per_recording_slice_ = std::max(settings_.draws_per_recording_slice_, 1u);
+    jobs_ = std::make_unique<JobSystem>(settings_.worker_threads_);
+  }
+
   Graphics::~Graphics()
   {
     // IMPORTANT : The destroy should be in reverse order of the create. Refer to IntializeVulkan() for ref.
@@ -1036,49 +2284,105 @@ namespace veng
       vkDeviceWaitIdle(logical_device_);  // Wait for the device to finish all operations before destroying resources
       SPDLOG_TRACE("Finished waiting for the device to finish all operations.");
 
-      // Destroy the semaphores
-      if (image_available_signal_ != VK_NULL_HANDLE)
+      // Destroy everything retired while rendering
+      deletion_queue_.FlushAll();
+
+      // Destroy the per-image semaphores
+      for (VkSemaphore render_finished_signal : render_finished_signals_)
       {
-        SPDLOG_TRACE("Invoking Available image signal semaphore Destruction");
-        vkDestroySemaphore(logical_device_, image_available_signal_, VK_NULL_HANDLE);
+        SPDLOG_TRACE("Invoking render finished signal semaphore Destruction");
+        vkDestroySemaphore(logical_device_, render_finished_signal, VK_NULL_HANDLE);
         SPDLOG_TRACE("Finished");
       }
-      if (render_finished_singal_ != VK_NULL_HANDLE)
+
+      // Destroy the profiling queries
+      TracyVkDestroy(tracy_context_);
+      gpu_queries_.reset();
+
+      // Destroy the per-frame objects
+      for (FrameData& frame : frames_)
       {
-        SPDLOG_TRACE("Invoking render finished signal semaphore Destruction");
-        vkDestroySemaphore(logical_device_, render_finished_singal_, VK_NULL_HANDLE);
-        SPDLOG_TRACE("Finished");
+        if (frame.image_available_signal_ != VK_NULL_HANDLE)
+        {
+          SPDLOG_TRACE("Invoking Available image signal semaphore Destruction");
+          vkDestroySemaphore(logical_device_, frame.image_available_signal_, VK_NULL_HANDLE);
+          SPDLOG_TRACE("Finished");
+        }
+
+        if (frame.still_rendering_fence_ != VK_NULL_HANDLE)
+        {
+          SPDLOG_TRACE("Invoking still rendering fence Destruction");
+          vkDestroyFence(logical_device_, frame.still_rendering_fence_, VK_NULL_HANDLE);
+          SPDLOG_TRACE("Finished");
+        }
+
+        // Destroying the pool frees its command buffer
+        if (frame.command_pool_ != VK_NULL_HANDLE)
+        {
+          SPDLOG_TRACE("Invoking command pool Destruction");
+          vkDestroyCommandPool(logical_device_, frame.command_pool_, VK_NULL_HANDLE);
+          SPDLOG_TRACE("Finished");
+        }
+        for (VkCommandPool slice_pool : frame.slice_command_pools_)
+        {
+          vkDestroyCommandPool(logical_device_, slice_pool, VK_NULL_HANDLE);
+        }
       }
 
-      // Destroy the fence
-      if (still_rendering_fence_ != VK_NULL_HANDLE)
+      // Destroy the scene, the instance buffers, the textures, then the table that indexes them
+      gpu_scene_.reset();
+      render_graph_.reset();
+      for (FrameData& frame : frames_)
+      {
+        allocator_->DestroyBuffer(frame.instance_buffer_);
+      }
+      for (auto& [index, texture] : textures_)
+      {
+        vkDestroyImageView(logical_device_, texture.view_, VK_NULL_HANDLE);
+        allocator_->DestroyImage(texture.image_);
+      }
+      if (bindless_table_ != nullptr)
       {
-        SPDLOG_TRACE("Invoking still rendering fence Destruction");
-        vkDestroyFence(logical_device_, still_rendering_fence_, VK_NULL_HANDLE);
+        SPDLOG_TRACE("Invoking Bindless Table Destruction");
+        bindless_table_.reset();
         SPDLOG_TRACE("Finished");
       }
-
-      // Destroy the command pool
-      if (command_pool_ != VK_NULL_HANDLE)
+      // Destroy the uniform ring
+      if (uniform_ring_ != nullptr)
       {
-        SPDLOG_TRACE("Invoking command pool Destruction");
-        vkDestroyCommandPool(logical_device_, command_pool_, VK_NULL_HANDLE);
+        SPDLOG_TRACE("Invoking Uniform Ring Destruction");
+        uniform_ring_.reset();
         SPDLOG_TRACE("Finished");
       }
-
-      // Destroy Framebuffers
-      for (VkFramebuffer framebuffer : swap_chain_framebuffers_)
+      // Destroy the upload batches and their timeline
+      if (uploader_ != nullptr)
       {
-        SPDLOG_TRACE("Invoking a Frame buffer Destruction");
-        vkDestroyFramebuffer(logical_device_, framebuffer, VK_NULL_HANDLE);
+        SPDLOG_TRACE("Invoking Uploader Destruction");
+        uploader_.reset();
         SPDLOG_TRACE("Finished");
       }
 
-      // Destroy the graphics pipeline
-      if (pipeline_ != VK_NULL_HANDLE)
+      // Destroy the meshes still alive
+      for (Mesh& mesh : meshes_)
       {
-        SPDLOG_TRACE("Invoking PipeLine Destruction");
-        vkDestroyPipeline(logical_device_, pipeline_, VK_NULL_HANDLE);
+        allocator_->DestroyBuffer(mesh.vertex_buffer_);
+        allocator_->DestroyBuffer(mesh.index_buffer_);
+      }
+
+      // Stop recompiling shaders
+      shader_watcher_.reset();
+      // Destroy the graphics pipelines, waiting for the ones still compiling
+      if (pipeline_registry_ != nullptr)
+      {
+        SPDLOG_TRACE("Invoking Pipeline Registry Destruction");
+        pipeline_registry_.reset();
+        SPDLOG_TRACE("Finished");
+      }
+      // Destroy the shader modules
+      if (shader_library_ != nullptr)
+      {
+        SPDLOG_TRACE("Invoking Shader Library Destruction");
+        shader_library_.reset();
         SPDLOG_TRACE("Finished");
       }
       // Destroy Pipeline Layout
@@ -1088,11 +2392,11 @@ namespace veng
         vkDestroyPipelineLayout(logical_device_, pipeline_layout_, VK_NULL_HANDLE);
         SPDLOG_TRACE("Finished");
       }
-      // Destroy Render Pass
-      if (render_pass_ != VK_NULL_HANDLE)
+      // Destroy the pipeline cache, writing it back to disk first
+      if (pipeline_cache_ != nullptr)
       {
-        SPDLOG_TRACE("Invoking Render Pass Destruction");
-        vkDestroyRenderPass(logical_device_, render_pass_, VK_NULL_HANDLE);
+        SPDLOG_TRACE("Invoking Pipeline Cache Destruction");
+        pipeline_cache_.reset();
         SPDLOG_TRACE("Finished");
       }
       // Destroy Swap Chain Images
@@ -1103,6 +2407,14 @@ namespace veng
         SPDLOG_TRACE("Finished");
       }
 
+      // Destroy the offscreen images, unlike swapchain images they are owned by us
+      for (Image& image : offscreen_images_)
+      {
+        SPDLOG_TRACE("Invoking an offscreen image Destruction");
+        allocator_->DestroyImage(image);
+        SPDLOG_TRACE("Finished");
+      }
+
       // Destroy Swap Chain
       if (swap_chain_ != VK_NULL_HANDLE)
       {
@@ -1111,6 +2423,15 @@ namespace veng
         SPDLOG_TRACE("Finished");
       }
 
+      // Release the device memory blocks, every resource living in them must be gone by now
+      if (allocator_ != nullptr)
+      {
+        allocator_->LogStats();
+        SPDLOG_TRACE("Invoking GPU Allocator Destruction");
+        allocator_.reset();
+        SPDLOG_TRACE("Finished");
+      }
+
       // Then destroy the logical device
       SPDLOG_TRACE("Invoking logical device Destruction");
       vkDestroyDevice(logical_device_, VK_NULL_HANDLE);
@@ -1155,16 +2476,21 @@ namespace veng
     CreateSurface();
     PickPhysicalDevice();
     CreateLogicalDeviceAndQueues();
+    CreateAllocator();
+    CreateUploader();
+    CreateUniformRing();
+    CreateBindlessTable();
+    CreateRenderGraph();
 
     CreateSwapChain();
     CreateImageViews();
-    CreateRenderPass();
+    CreatePipelineCache();
     CreateGraphicsPipeline();
-    CreateFramebuffers();
 
-    CreateCommandPool();
-    CreateCommandBuffer();
+    CreateCommandPools();
+    CreateCommandBuffers();
     CreateSignals();
+    CreateProfiling();
     auto end = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
     SPDLOG_DEBUG("Graphics::InitializeVulkan() took {}ms", duration.count());
@@ -2,18 +2,129 @@
 
 #include <vulkan/vulkan.h>
 #include <glfw_window.h>
+#include <deletion_queue.h>
+#include <pipeline_cache.h>
+#include <gpu_allocator.h>
+#include <uploader.h>
+#include <uniform_ring.h>
+#include <bindless_table.h>
+#include <gpu_query_pool.h>
+#include <gpu_scene.h>
+#include <render_queue.h>
+#include <render_graph.h>
+#include <mesh_file.h>
+#include <shader_types.h>
+#include <shader_library.h>
+#include <pipeline_registry.h>
+#include <shader_watcher.h>
+#include <job_system.h>
+#include <vertex.h>
 
 namespace veng
 {
+  struct GraphicsSettings
+  {
+    // Number of frames the CPU may record ahead of the GPU. Clamped to [1, kMaxFramesInFlight].
+    std::uint32_t frames_in_flight_ = 2;
+    // Size of the offscreen images when running headless, ignored when a window is given
+    VkExtent2D headless_extent_ = {800, 600};
+    // Preferred presentation mode, falls back to the default choice when the surface does not support it
+    std::optional<VkPresentModeKHR> presentation_mode_ = std::nullopt;
+    // Compiled pipelines are kept here between runs
+    std::filesystem::path pipeline_cache_path_ = "pipeline_cache.bin";
+    // Bytes of per-frame and per-draw shader data each frame in flight may push
+    VkDeviceSize uniform_ring_frame_size_ = 4ull << 20;
+    // Job system worker threads, 0 leaves one core to the calling thread
+    std::uint32_t worker_threads_ = 0;
+    // Draw lists are split into slices of at least this many draws, shorter lists are recorded inline
+    std::uint32_t draws_per_recording_slice_ = 256;
+    // Built next to the executable by add_shaders(), every shader is created from this one mapping
+    std::filesystem::path shader_archive_path_ = "shaders.vsha";
+    // Recompiles edited shaders from the source tree while running and swaps in the rebuilt pipelines, Linux only
+    bool hot_reload_shaders_ = false;
+    // Draws everything depth only first, the main pass then tests for equality and shades each pixel once. Pays
+    // off when fragment shading outweighs transforming the geometry twice.
+    bool depth_prepass_ = false;
+  };
+
+  // Where the frame loop spent its time waiting on Vulkan, in milliseconds
+  struct FrameTimings
+  {
+    double fence_wait_ms_ = 0.0;
+    double acquire_ms_ = 0.0;
+    double present_ms_ = 0.0;
+    // GPU time of the latest frame whose queries came back, frames_in_flight_ frames old
+    double gpu_frame_ms_ = 0.0;
+  };
+
+  // Per-instance data as a structure of arrays, one element per instance in every non-empty stream
+  struct InstanceStream
+  {
+    gsl::span<const InstanceTransform> transforms_;
+    gsl::span<const InstanceColor> colors_;  // Empty: white
+    gsl::span<const InstanceMaterial> materials_;  // Empty: the default texture
+  };
+
   class Graphics final
   {
    public:
-    Graphics(gsl::not_null<Window*> window);
+    static constexpr std::uint32_t kMaxFramesInFlight = 4;
+
+    Graphics(gsl::not_null<Window*> window, GraphicsSettings settings = NULL_STRUCT);
+    // Headless: renders into a ring of offscreen images, needs neither a window nor a display
+    explicit Graphics(GraphicsSettings settings);
     ~Graphics();
 
+    Graphics(const Graphics&) = delete;
+    Graphics& operator=(const Graphics&) = delete;
+
+    bool IsHeadless() const { return window_ == nullptr; };
+    // Timings of the last BeginFrame()/EndFrame() pair
+    const FrameTimings& GetFrameTimings() const { return frame_timings_; };
+    // Shared by the engine's CPU work, the thread that created the Graphics is its main thread
+    JobSystem& GetJobSystem() { return *jobs_; };
+    // Per-pass GPU timings and pipeline statistics of the latest frame whose queries came back
+    const GpuFrameResults& GetGpuResults() const { return gpu_queries_->GetResults(); };
+    // Passes, barriers and transient memory of the last frame's render graph
+    const RenderGraphStats& GetRenderGraphStats() const { return render_graph_->GetStats(); };
+    void LogGpuResults() const { gpu_queries_->LogResults(); };
+
+    // Geometry lives in device-local buffers filled through the transfer queue, draws are skipped until it lands.
+    // Throws on empty vertices or indices.
+    MeshHandle CreateMesh(gsl::span<const Vertex> vertices, gsl::span<const std::uint32_t> indices);
+    // Maps a file written by MeshConverter and uploads its full level of detail without parsing or converting it.
+    // std::nullopt when the file is missing or invalid.
+    std::optional<MeshHandle> LoadMesh(const std::filesystem::path& path);
+    // Same from a file already mapped, e.g. by a streaming thread. The mapping can be closed once this returns.
+    MeshHandle CreateMesh(const MeshFile& file);
+    // The buffers are destroyed once the frames that may still draw the mesh have retired
+    void DestroyMesh(MeshHandle mesh);
+
+    // RGBA8 sRGB texels, tightly packed. The returned index addresses the texture in shaders.
+    BindlessIndex CreateTexture(std::uint32_t width, std::uint32_t height, gsl::span<const std::uint32_t> texels);
+    // The image and its table slot are released once the frames that may still sample it have retired
+    void DestroyTexture(BindlessIndex texture);
+
+    // Applies to the whole frame, whenever it is set. Scene objects are culled against its frustum.
+    void SetViewProjection(const glm::mat4& view_projection);
+
+    // GPU-driven objects: culled and drawn by the GPU every frame, without being queued again. Any change uploads
+    // the whole scene again, so they suit content that mostly stays put. The mesh must outlive its objects.
+    SceneObjectHandle AddSceneObject(
+        MeshHandle mesh, const glm::mat4& transform, std::optional<BindlessIndex> texture = std::nullopt);
+    void RemoveSceneObject(SceneObjectHandle object);
+    void SetSceneObjectTransform(SceneObjectHandle object, const glm::mat4& transform);
+
    public:
     void BeginFrame();
-    void RenderTriangle();
+    // Queues the draw. EndFrame() sorts the frame's draws by pipeline, material, mesh then depth and records them
+    // across the worker threads, only draws with equal keys keep their submission order. Textures still uploading
+    // are replaced by a white one.
+    void RenderIndexed(
+        MeshHandle mesh, const glm::mat4& model = glm::mat4(1.0f), std::optional<BindlessIndex> texture = std::nullopt);
+    // One draw for every instance. The streams are copied into this frame's instance buffer right away, instances
+    // read them in the shaders through gl_InstanceIndex.
+    void RenderInstanced(MeshHandle mesh, const InstanceStream& instances);
     void EndFrame();
 
    private:
@@ -21,6 +132,8 @@ namespace veng
     {
       std::optional<std::uint32_t> graphics_family_ = std::nullopt;
       std::optional<std::uint32_t> presentation_family_ = std::nullopt;
+      // Always set alongside graphics_family_, equal to it when the device has no separate transfer family
+      std::optional<std::uint32_t> transfer_family_ = std::nullopt;
       bool IsValid() const { return (graphics_family_.has_value() && presentation_family_.has_value()); };
     };
     struct SwapChainProperties
@@ -31,31 +144,112 @@ namespace veng
 
       bool IsValid() const { return (!formats_.empty() && !presentaion_modes_.empty()); };
     };
+    // Everything a single frame in flight records into and synchronizes on
+    struct FrameData
+    {
+      VkCommandPool command_pool_ = VK_NULL_HANDLE;
+      VkCommandBuffer command_buffer_ = VK_NULL_HANDLE;
+      VkSemaphore image_available_signal_ = VK_NULL_HANDLE;
+      VkFence still_rendering_fence_ = VK_NULL_HANDLE;
+      // One pool per recording slice, so no two threads ever record from the same pool
+      std::vector<VkCommandPool> slice_command_pools_ = NULL_STRUCT;
+      std::vector<VkCommandBuffer> slice_command_buffers_ = NULL_STRUCT;  // Secondary
+      // Allocated from the same pools, the depth prepass is recorded before the main pass begins
+      std::vector<VkCommandBuffer> prepass_slice_command_buffers_ = NULL_STRUCT;
+      // Host-visible, holds instance_capacity_ transforms, then as many colors, then as many materials
+      Buffer instance_buffer_ = NULL_STRUCT;
+      BindlessIndex instance_buffer_index_ = 0;
+      std::uint32_t instance_capacity_ = 0;
+      std::uint32_t instance_count_ = 0;  // Written this frame
+    };
+    struct Mesh
+    {
+      Buffer vertex_buffer_ = NULL_STRUCT;
+      Buffer index_buffer_ = NULL_STRUCT;
+      std::uint32_t index_count_ = 0;
+      VkIndexType index_type_ = VK_INDEX_TYPE_UINT32;
+      glm::vec4 bounds_ = glm::vec4(0.0f);  // Bounding sphere, center then radius
+      UploadTicket ready_ticket_ = 0;
+    };
+    struct DrawCommand
+    {
+      MeshHandle mesh_ = 0;
+      glm::mat4 model_ = glm::mat4(1.0f);
+      std::optional<BindlessIndex> texture_ = std::nullopt;
+      // Instanced draws only, their range in the frame's instance buffer. 0 instances draws model_ once.
+      std::uint32_t instance_count_ = 0;
+      std::uint32_t first_instance_ = 0;
+    };
+    struct Texture
+    {
+      Image image_ = NULL_STRUCT;
+      VkImageView view_ = VK_NULL_HANDLE;
+      UploadTicket ready_ticket_ = 0;
+    };
 
     // Inits
+    void ApplySettings();
     void IntializeVulkan();
     void CreateInstance();
     void SetupDebugMessenger();
     void PickPhysicalDevice();
     void CreateLogicalDeviceAndQueues();
+    void CreateAllocator();
+    void CreateUploader();
+    void CreateUniformRing();
+    void CreateBindlessTable();
+    void CreateRenderGraph();
     void CreateSurface();
     void CreateSwapChain();
+    void RecreateSwapChain();
+    void CreateOffscreenImages();
     void CreateImageViews();
-    void CreateRenderPass();
+    void CreatePipelineCache();
     void CreateGraphicsPipeline();
-    void CreateFramebuffers();
-    void CreateCommandPool();
-    void CreateCommandBuffer();
+    void CreateCommandPools();
+    void CreateCommandBuffers();
     void CreateSignals();
+    void CreateRenderFinishedSignals();
+    void CreateProfiling();
 
-    // Rendering
+    // Swaps in the pipelines rebuilt from recompiled shaders, at the start of a frame
+    void ReloadShaders();
 
+    // Rendering
+    FrameData& CurrentFrame() { return frames_[current_frame_]; };
+    VkCommandBuffer CurrentCommandBuffer() { return CurrentFrame().command_buffer_; };
     void BeginCommands();
     void EndCommands();
+    // Builds the frame's render graph: the scene's culling, the depth prepass if enabled then the main pass, and
+    // executes it
+    void RecordDrawList();
+    // Records the sorted draw list, inline or in slices across the worker threads. Without a color target only depth
+    // is written, with the depth pipelines.
+    void RecordDrawPass(
+        VkCommandBuffer command_buffer, VkImageView color_target, VkImageView depth_target, bool draw_scene);
+    // Keys the draw list into render_queue_ and sorts it, so that recording changes state as rarely as possible
+    void SortDrawList();
+    // Records the draws of draw_list_ in the given order inside the render pass, from any thread as long as
+    // command_buffer is its own. The scene's indirect draws go first when draw_scene is set. depth_only binds the
+    // prepass pipelines instead.
+    void RecordDraws(
+        VkCommandBuffer command_buffer, gsl::span<const SortEntry> order, bool draw_scene, bool depth_only);
+    // Fills the scene's indirect commands, a render graph pass ahead of the main pass
+    void RecordCulling(VkCommandBuffer command_buffer);
+    void RecordSceneDraws(VkCommandBuffer command_buffer, bool depth_only);
+    // Grows the frame's instance buffer to fit count more instances
+    void ReserveInstances(FrameData& frame, std::uint32_t count);
+
+    // Stores the mesh under a free handle
+    MeshHandle AddMesh(const Mesh& mesh);
+
+    // Buffers
+    Buffer CreateDeviceBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, UploadTicket& ticket);
 
     // Instance Extensions
     static gsl::span<gsl::czstring> GetSuggestedInstanceExtension();
     std::vector<gsl::czstring> GetRequiredInstanceExtension();
+    std::vector<gsl::czstring> GetRequiredDeviceExtensions();
     static std::vector<VkExtensionProperties> GetSupportedInstanceExtensions();
     static bool AreAllExtensionsSupported(gsl::span<gsl::czstring> extension);
 
@@ -66,13 +260,13 @@ namespace veng
     // Physical Devices
     std::vector<VkPhysicalDevice> GetAvailableDevices();
     bool isDeviceSuitable(VkPhysicalDevice device);
+    static bool AreAllDeviceFeaturesSupported(VkPhysicalDevice device);
 
     // Viewport
     VkViewport GetViewport();
     VkRect2D GetScissor();
 
     // Physical Devices - Extensions
-    std::array<gsl::czstring, 1> required_device_extensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
     std::vector<VkExtensionProperties> GetDeviceAvailableExtensions(VkPhysicalDevice physicaldevice);
     bool AreAllDeviceExtensionsSupported(VkPhysicalDevice device);
 
@@ -84,12 +278,13 @@ namespace veng
     VkPresentModeKHR ChooseSwapPresentationMode(gsl::span<VkPresentModeKHR> presentation_modes);
     VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
     std::uint32_t ChooseSwapImageCount(const VkSurfaceCapabilitiesKHR& capabilities);
+    // The most precise depth-only format the device can render to with optimal tiling
+    VkFormat ChooseDepthFormat();
     SwapChainProperties GetSwapChainProperties(VkPhysicalDevice device);
 
-    // Graphics Pipeline
-    VkShaderModule CreateShaderModule(gsl::span<std::uint8_t> buffer);
-
    private:
+    // Declared first so it is destroyed last, the objects below may still wait on its jobs
+    std::unique_ptr<JobSystem> jobs_ = nullptr;
     VkInstance instance_ = VK_NULL_HANDLE;
     VkDebugUtilsMessengerEXT debug_messenger_ = VK_NULL_HANDLE;
     VkPhysicalDevice physical_device_ = VK_NULL_HANDLE;
@@ -97,6 +292,16 @@ namespace veng
     VkDevice logical_device_ = VK_NULL_HANDLE;
     VkQueue graphics_queue_ = VK_NULL_HANDLE;
     VkQueue presentation_queue_ = VK_NULL_HANDLE;
+    VkQueue transfer_queue_ = VK_NULL_HANDLE;  // May be the graphics queue
+    std::unique_ptr<GpuAllocator> allocator_ = nullptr;
+    std::unique_ptr<Uploader> uploader_ = nullptr;
+    std::unique_ptr<UniformRing> uniform_ring_ = nullptr;
+    std::unique_ptr<BindlessTable> bindless_table_ = nullptr;
+    std::unique_ptr<GpuQueryPool> gpu_queries_ = nullptr;
+    std::unique_ptr<GpuScene> gpu_scene_ = nullptr;
+    std::unique_ptr<RenderGraph> render_graph_ = nullptr;
+    TracyVkCtx tracy_context_ = nullptr;
+    bool pipeline_statistics_enabled_ = false;
 
     VkSurfaceKHR surface_ = VK_NULL_HANDLE;
     VkSurfaceFormatKHR surface_format_ = NULL_STRUCT;
@@ -106,22 +311,64 @@ namespace veng
     VkSwapchainKHR swap_chain_ = VK_NULL_HANDLE;
     std::vector<VkImage> swap_chain_images_ = NULL_STRUCT;
     std::vector<VkImageView> swap_chain_image_views_ = NULL_STRUCT;
-    std::vector<VkFramebuffer> swap_chain_framebuffers_ = NULL_STRUCT;
+    // Headless only: the offscreen images standing in for the swapchain images
+    std::vector<Image> offscreen_images_ = NULL_STRUCT;
 
-    VkRenderPass render_pass_ = VK_NULL_HANDLE;
+    std::unique_ptr<PipelineCache> pipeline_cache_ = nullptr;
     VkPipelineLayout pipeline_layout_ = VK_NULL_HANDLE;
-    VkPipeline pipeline_ = VK_NULL_HANDLE;
+    std::unique_ptr<ShaderLibrary> shader_library_ = nullptr;
+    std::unique_ptr<PipelineRegistry> pipeline_registry_ = nullptr;
+    // As of the last frame, the cache is saved whenever a batch of compiles has landed
+    bool pipelines_compiling_ = true;
+    std::unique_ptr<ShaderWatcher> shader_watcher_ = nullptr;
+    // Recompiled while the registry was busy, reloaded on a later frame
+    std::set<std::string> pending_shader_reloads_;
+    PipelineHandle basic_pipeline_ = 0;
+    // basic_pipeline_ specialized without the texture sample, for draws that have none
+    PipelineHandle untextured_pipeline_ = 0;
+    PipelineHandle instanced_pipeline_ = 0;
+    PipelineHandle cull_pipeline_ = 0;
+    // Invocations per workgroup of the culling pass, specialized into shaders/cull.comp
+    static constexpr std::uint32_t kCullGroupSize = 64;
+    PipelineHandle scene_pipeline_ = 0;
+    // Depth only, for the prepass: basic and untextured draws share the first
+    PipelineHandle depth_pipeline_ = 0;
+    PipelineHandle instanced_depth_pipeline_ = 0;
+    PipelineHandle scene_depth_pipeline_ = 0;
+    VkFormat depth_format_ = VK_FORMAT_UNDEFINED;
+    std::uint32_t max_instance_capacity_ = 0;
+    std::uint32_t max_draw_indirect_count_ = 0;
+
+    // Per-frame shader data, pushed to the uniform ring before the first draw that needs it
+    FrameUniforms frame_uniforms_ = NULL_STRUCT;
+    std::optional<std::uint32_t> frame_uniforms_offset_ = std::nullopt;
+
+    // Textures by their bindless index, the white default one stands in while the others upload
+    std::unordered_map<BindlessIndex, Texture> textures_ = NULL_STRUCT;
+    BindlessIndex default_texture_ = 0;
+
+    // Meshes, freed handles are reused
+    std::vector<Mesh> meshes_ = NULL_STRUCT;
+    std::vector<MeshHandle> free_mesh_handles_ = NULL_STRUCT;
 
-    VkCommandPool command_pool_ = VK_NULL_HANDLE;
-    VkCommandBuffer command_buffer_ = VK_NULL_HANDLE;
+    // Draws queued since BeginFrame(), sorted then recorded in slices by the job system in EndFrame()
+    std::vector<DrawCommand> draw_list_ = NULL_STRUCT;
+    RenderQueue render_queue_;
 
-    VkSemaphore image_available_signal_ = VK_NULL_HANDLE;
-    VkSemaphore render_finished_singal_ = VK_NULL_HANDLE;
-    VkFence still_rendering_fence_ = VK_NULL_HANDLE;
+    // One slot per frame in flight, cycled through by current_frame_
+    std::vector<FrameData> frames_ = NULL_STRUCT;
+    // One per swapchain image: presentation of an image may outlive the frame slot that rendered it
+    std::vector<VkSemaphore> render_finished_signals_ = NULL_STRUCT;
 
-    gsl::not_null<Window*> window_;
+    Window* window_ = nullptr;  // nullptr when headless
+    GraphicsSettings settings_ = NULL_STRUCT;
+    FrameTimings frame_timings_ = NULL_STRUCT;
+    std::uint32_t frame_scope_ = GpuQueryPool::kInvalidScope;  // GPU query scope around the whole frame
     VkPresentModeKHR presentation_mode_ = NULL_STRUCT;  // Moved here for memory layout
     std::uint32_t current_image_index_ = 0;
+    std::uint32_t current_frame_ = 0;
+    std::uint64_t frame_number_ = 0;  // Frames begun so far, used to tell when retired objects are safe to destroy
+    DeletionQueue deletion_queue_;
     bool validation_enabled_ = false;
   };
 
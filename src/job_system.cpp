@@ -0,0 +1,290 @@
+#include <job_system.h>
+
+namespace veng
+{
+  // Which system the calling thread belongs to, and its queue there
+  static thread_local const JobSystem* current_system = nullptr;
+  static thread_local std::uint32_t current_thread_index = JobSystem::kNotAWorker;
+
+  JobSystem::JobSystem(std::uint32_t worker_count)
+  {
+    for (std::uint32_t i = 0; i < worker_count + 1; i++)
+    {
+      queues_.emplace_back();
+    }
+
+    current_system = this;
+    current_thread_index = 0;
+
+    workers_.reserve(worker_count);
+    for (std::uint32_t i = 1; i <= worker_count; i++)
+    {
+      workers_.emplace_back(std::bind_front(&JobSystem::WorkerLoop, this), i);
+    }
+  }
+
+  JobSystem::~JobSystem()
+  {
+    for (std::jthread& worker : workers_)
+    {
+      worker.request_stop();
+    }
+    // jthread joins on destruction, the workers drain the queues first
+    workers_.clear();
+
+    // Without workers nothing else would run what is left
+    while (TryRunOne(0))
+    {
+    }
+    RunMainThreadJobs();
+
+    if (current_system == this)
+    {
+      current_system = nullptr;
+      current_thread_index = kNotAWorker;
+    }
+  }
+
+  std::uint32_t JobSystem::GetThreadIndex() const
+  {
+    return current_system == this ? current_thread_index : kNotAWorker;
+  }
+
+  void JobSystem::Submit(Job job, JobCounter* counter, JobPriority priority)
+  {
+    if (counter != nullptr)
+    {
+      counter->value_.fetch_add(1, std::memory_order_relaxed);
+    }
+    Push(Task{std::move(job), counter}, priority);
+  }
+
+  void JobSystem::SubmitAfter(JobCounter& dependency, Job job, JobCounter* counter)
+  {
+    if (counter != nullptr)
+    {
+      counter->value_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    {
+      // The last job of the dependency drains the continuations under the same lock
+      std::scoped_lock lock(dependency.mutex_);
+      if (!dependency.IsDone())
+      {
+        dependency.continuations_.push_back(
+            [this, task = Task{std::move(job), counter}]() mutable
+            {
+              Push(std::move(task), JobPriority::kNormal);
+            });
+        return;
+      }
+    }
+    Push(Task{std::move(job), counter}, JobPriority::kNormal);
+  }
+
+  void JobSystem::Wait(JobCounter& counter)
+  {
+    const std::uint32_t thread_index = GetThreadIndex();
+    while (!counter.IsDone())
+    {
+      if (thread_index == 0)
+      {
+        RunMainThreadJobs();
+      }
+      if (!TryRunOne(thread_index))
+      {
+        std::this_thread::yield();
+      }
+    }
+    // The last job may still be unlocking the counter
+    std::scoped_lock lock(counter.mutex_);
+  }
+
+  void JobSystem::ParallelFor(
+      std::uint32_t count, std::uint32_t min_batch_size,
+      const std::function<void(std::uint32_t begin, std::uint32_t end)>& body)
+  {
+    if (count == 0)
+    {
+      return;
+    }
+
+    // A few batches per thread leave room for stealing when some run slower
+    const std::uint32_t target_batches = GetThreadCount() * 4;
+    const std::uint32_t batch_size = std::max({min_batch_size, (count + target_batches - 1) / target_batches, 1u});
+    if (batch_size >= count)
+    {
+      body(0, count);
+      return;
+    }
+
+    JobCounter counter;
+    for (std::uint32_t begin = 0; begin < count; begin += batch_size)
+    {
+      const std::uint32_t end = std::min(begin + batch_size, count);
+      Submit(
+          [&body, begin, end]()
+          {
+            body(begin, end);
+          },
+          &counter);
+    }
+    Wait(counter);
+  }
+
+  void JobSystem::SubmitMainThread(Job job)
+  {
+    std::scoped_lock lock(main_thread_queue_.mutex_);
+    main_thread_queue_.tasks_.push_back(Task{std::move(job), nullptr});
+  }
+
+  void JobSystem::RunMainThreadJobs()
+  {
+    std::deque<Task> tasks;
+    {
+      std::scoped_lock lock(main_thread_queue_.mutex_);
+      tasks.swap(main_thread_queue_.tasks_);
+    }
+    for (Task& task : tasks)
+    {
+      Run(task);
+    }
+  }
+
+  void JobSystem::Push(Task task, JobPriority priority)
+  {
+    // Background jobs only go to the side when there are workers to pick them up
+    const std::uint32_t thread_index = GetThreadIndex();
+    WorkerQueue& queue = (priority == JobPriority::kBackground && !workers_.empty()) ? background_queue_
+                         : thread_index == kNotAWorker                               ? shared_queue_
+                                                                                     : queues_[thread_index];
+    {
+      std::scoped_lock lock(queue.mutex_);
+      // Counted before it becomes visible, so the count never drops below the jobs actually queued
+      queued_count_.fetch_add(1);
+      queue.tasks_.push_back(std::move(task));
+    }
+
+    // Pairs with the sleeping count being raised before the queued count is checked in WorkerLoop()
+    if (sleeping_count_.load() > 0)
+    {
+      {
+        std::scoped_lock lock(sleep_mutex_);
+      }
+      sleep_signal_.notify_one();
+    }
+  }
+
+  bool JobSystem::TryRunOne(std::uint32_t thread_index)
+  {
+    auto pop = [this](WorkerQueue& queue, bool newest, Task& task)
+    {
+      std::scoped_lock lock(queue.mutex_);
+      if (queue.tasks_.empty())
+      {
+        return false;
+      }
+      if (newest)
+      {
+        task = std::move(queue.tasks_.back());
+        queue.tasks_.pop_back();
+      }
+      else
+      {
+        task = std::move(queue.tasks_.front());
+        queue.tasks_.pop_front();
+      }
+      queued_count_.fetch_sub(1);
+      return true;
+    };
+
+    // Own jobs newest first while their data is still in cache, then the shared ones, then steal the oldest
+    Task task;
+    const bool is_worker = thread_index != kNotAWorker;
+    bool found = (is_worker && pop(queues_[thread_index], true, task)) || pop(shared_queue_, false, task);
+    const std::uint32_t queue_count = GetThreadCount();
+    const std::uint32_t first_victim = is_worker ? thread_index + 1 : 0;
+    for (std::uint32_t i = 0; !found && i < queue_count; i++)
+    {
+      const std::uint32_t victim = (first_victim + i) % queue_count;
+      found = victim != thread_index && pop(queues_[victim], false, task);
+    }
+    // The main thread never picks up background work, it would stall the frame
+    if (!found && is_worker && thread_index != 0)
+    {
+      found = pop(background_queue_, false, task);
+    }
+
+    if (found)
+    {
+      Run(task);
+    }
+    return found;
+  }
+
+  void JobSystem::Run(Task& task)
+  {
+    task.job_();
+
+    JobCounter* counter = task.counter_;
+    if (counter == nullptr)
+    {
+      return;
+    }
+
+    // Decremented under the lock: Wait() takes it before returning, so the counter outlives this block
+    std::vector<std::function<void()>> continuations;
+    {
+      std::scoped_lock lock(counter->mutex_);
+      if (counter->value_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+        continuations.swap(counter->continuations_);
+      }
+    }
+    for (std::function<void()>& continuation : continuations)
+    {
+      continuation();
+    }
+  }
+
+  void JobSystem::WorkerLoop(std::stop_token stop_token, std::uint32_t thread_index)
+  {
+    current_system = this;
+    current_thread_index = thread_index;
+    tracy::SetThreadName(fmt::format("Job worker {}", thread_index).c_str());
+
+    // Spinning a little before sleeping keeps the worker hot between the bursts of a frame
+    constexpr std::uint32_t kSpinCount = 64;
+    while (true)
+    {
+      bool ran = false;
+      for (std::uint32_t spin = 0; spin < kSpinCount && !ran; spin++)
+      {
+        ran = TryRunOne(thread_index);
+        if (!ran)
+        {
+          std::this_thread::yield();
+        }
+      }
+      if (ran)
+      {
+        continue;
+      }
+
+      std::unique_lock lock(sleep_mutex_);
+      sleeping_count_.fetch_add(1);
+      // Wakes on a new job or on a stop request, stop only once the queues are drained
+      sleep_signal_.wait(
+          lock, stop_token,
+          [this]()
+          {
+            return queued_count_.load() > 0;
+          });
+      sleeping_count_.fetch_sub(1);
+      if (queued_count_.load() == 0)
+      {
+        return;
+      }
+    }
+  }
+}  // namespace veng
@@ -0,0 +1,101 @@
+#pragma once
+
+namespace veng
+{
+  using Job = std::function<void()>;
+
+  enum class JobPriority
+  {
+    kNormal,  // Frame work, run by any thread including one waiting on a counter
+    kBackground  // Long work (pipeline compiles, decoding), only picked up by idle workers
+  };
+
+  // Counts the unfinished jobs submitted against it. Jobs can be chained to run once it drops to zero. Only
+  // destroy it after JobSystem::Wait() on it returned.
+  class JobCounter
+  {
+   public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool IsDone() const { return value_.load(std::memory_order_acquire) == 0; };
+
+   private:
+    friend class JobSystem;
+
+    std::atomic<std::uint32_t> value_ = 0;
+    std::mutex mutex_;
+    std::vector<std::function<void()>> continuations_;
+  };
+
+  // Work-stealing scheduler. Each thread owns a deque, pops its own jobs newest first and steals the oldest from
+  // the others when it runs dry. The thread that creates the system takes part as thread 0 whenever it waits, and
+  // alone runs the jobs submitted through SubmitMainThread().
+  class JobSystem
+  {
+   public:
+    static constexpr std::uint32_t kNotAWorker = std::numeric_limits<std::uint32_t>::max();
+
+    // worker_count threads are spawned on top of the calling thread, 0 leaves it alone
+    explicit JobSystem(std::uint32_t worker_count);
+    // Finishes the queued jobs then joins the workers
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // The counter, if any, must outlive the job
+    void Submit(Job job, JobCounter* counter = nullptr, JobPriority priority = JobPriority::kNormal);
+    // Holds the job back until the dependency drops to zero
+    void SubmitAfter(JobCounter& dependency, Job job, JobCounter* counter = nullptr);
+    // Runs other jobs until the counter drops to zero
+    void Wait(JobCounter& counter);
+
+    // Splits [0, count) into batches of at least min_batch_size items and blocks until all ran
+    void ParallelFor(
+        std::uint32_t count, std::uint32_t min_batch_size,
+        const std::function<void(std::uint32_t begin, std::uint32_t end)>& body);
+
+    // For the calls that must happen on the main thread (GLFW), run by RunMainThreadJobs() or while it waits
+    void SubmitMainThread(Job job);
+    void RunMainThreadJobs();
+
+    // Worker threads plus the main thread
+    std::uint32_t GetThreadCount() const { return static_cast<std::uint32_t>(queues_.size()); };
+    // Index of the calling thread in [0, GetThreadCount()), kNotAWorker for threads the system does not own
+    std::uint32_t GetThreadIndex() const;
+
+   private:
+    struct Task
+    {
+      Job job_;
+      JobCounter* counter_ = nullptr;
+    };
+    // Padded so neighbouring queues do not share a cache line
+    struct alignas(64) WorkerQueue
+    {
+      std::mutex mutex_;
+      std::deque<Task> tasks_;
+    };
+
+    void Push(Task task, JobPriority priority);
+    bool TryRunOne(std::uint32_t thread_index);
+    void Run(Task& task);
+    void WorkerLoop(std::stop_token stop_token, std::uint32_t thread_index);
+
+    std::deque<WorkerQueue> queues_;  // Index 0 belongs to the main thread
+    // Jobs submitted from threads the system does not own
+    WorkerQueue shared_queue_;
+    WorkerQueue background_queue_;
+    WorkerQueue main_thread_queue_;
+
+    // Queued jobs any worker may run, idle workers sleep while it is zero
+    std::atomic<std::uint32_t> queued_count_ = 0;
+    std::atomic<std::uint32_t> sleeping_count_ = 0;
+    std::mutex sleep_mutex_;
+    std::condition_variable_any sleep_signal_;
+
+    std::vector<std::jthread> workers_;
+  };
+}  // namespace veng
@@ -2,6 +2,36 @@
 #include <glfw_window.h>
 #include <glfw_monitor.h>
 #include <graphics.h>
+#include <asset_streamer.h>
+#include <benchmark.h>
+
+static std::optional<VkPresentModeKHR> ParsePresentMode(std::string_view name)
+{
+  if (name == "fifo")
+  {
+    return VK_PRESENT_MODE_FIFO_KHR;
+  }
+  if (name == "mailbox")
+  {
+    return VK_PRESENT_MODE_MAILBOX_KHR;
+  }
+  if (name == "immediate")
+  {
+    return VK_PRESENT_MODE_IMMEDIATE_KHR;
+  }
+  return std::nullopt;
+}
+
+// Cell of a square grid covering clip space, holding a smaller copy of the spinning quad
+static glm::mat4 GridCellTransform(std::uint64_t index, std::uint64_t count, const glm::mat4& spin)
+{
+  const std::uint64_t columns = static_cast<std::uint64_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+  const float cell = 2.0f / static_cast<float>(columns);
+  const glm::vec3 center(
+      -1.0f + cell * (static_cast<float>(index % columns) + 0.5f),
+      -1.0f + cell * (static_cast<float>(index / columns) + 0.5f), 0.0f);
+  return glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(cell)) * spin;
+}
 
 std::int32_t main(std::int32_t argc, gsl::zstring* argv)
 {
@@ -12,17 +42,212 @@ std::int32_t main(std::int32_t argc, gsl::zstring* argv)
 
   SPDLOG_INFO("Current working directory: {}", std::filesystem::current_path().string());
 
-  const veng::GlfwInitialization _glfw;
-  veng::Window window("Vulkan Renderer", {800, 600});
-  window.TryMoveToMonitor(1);
+  gsl::span<gsl::zstring> arguments(argv, argc);
+
+  // Job system microbenchmark, runs on its own without a renderer
+  if (veng::HasArgument(arguments, "--bench-jobs"))
+  {
+    const std::uint64_t max_threads =
+        veng::ParseUnsigned(veng::GetArgumentValue(arguments, "--threads").value_or(""))
+            .value_or(std::max(std::thread::hardware_concurrency(), 1u));
+    const std::uint64_t repetitions =
+        veng::ParseUnsigned(veng::GetArgumentValue(arguments, "--repetitions").value_or("")).value_or(20);
+    veng::RunJobScalingBenchmark(
+        static_cast<std::uint32_t>(std::max<std::uint64_t>(max_threads, 1)),
+        static_cast<std::uint32_t>(std::max<std::uint64_t>(repetitions, 1)));
+    return EXIT_SUCCESS;
+  }
+  const bool headless = veng::HasArgument(arguments, "--headless");
+  // Headless runs have no close button, they stop after a fixed amount of frames
+  const std::uint64_t frame_limit =
+      veng::ParseUnsigned(veng::GetArgumentValue(arguments, "--frames").value_or("")).value_or(1000);
 
-  veng::Graphics graphics(&window);
-  while (!window.ShouldClose())
+  veng::GraphicsSettings settings;
+  if (auto frames_in_flight = veng::GetArgumentValue(arguments, "--frames-in-flight"))
+  {
+    settings.frames_in_flight_ = veng::ParseUnsigned(*frames_in_flight).value_or(settings.frames_in_flight_);
+  }
+  if (auto present_mode = veng::GetArgumentValue(arguments, "--present-mode"))
+  {
+    settings.presentation_mode_ = ParsePresentMode(*present_mode);
+  }
+  if (auto worker_threads = veng::GetArgumentValue(arguments, "--worker-threads"))
+  {
+    settings.worker_threads_ = veng::ParseUnsigned(*worker_threads).value_or(settings.worker_threads_);
+  }
+  settings.hot_reload_shaders_ = veng::HasArgument(arguments, "--hot-reload");
+  settings.depth_prepass_ = veng::HasArgument(arguments, "--depth-prepass");
+  // Draws a grid of this many quads, to load the recording threads
+  const std::uint64_t draw_count = std::max<std::uint64_t>(
+      veng::ParseUnsigned(veng::GetArgumentValue(arguments, "--draws").value_or("")).value_or(1), 1);
+  // Draws the grid as this many instances of one draw instead, e.g. --instances 1000000 --benchmark
+  const std::uint32_t instance_count = static_cast<std::uint32_t>(
+      veng::ParseUnsigned(veng::GetArgumentValue(arguments, "--instances").value_or("")).value_or(0));
+  // Adds this many quads to the GPU-driven scene, over a grid four times wider than the panning view
+  const std::uint32_t scene_object_count = static_cast<std::uint32_t>(
+      veng::ParseUnsigned(veng::GetArgumentValue(arguments, "--scene-objects").value_or("")).value_or(0));
+
+  // Benchmark mode: --warmup frames are discarded, then --frames frames are measured
+  std::optional<veng::FrameBenchmark> benchmark;
+  if (veng::HasArgument(arguments, "--benchmark"))
+  {
+    const std::uint64_t warmup =
+        veng::ParseUnsigned(veng::GetArgumentValue(arguments, "--warmup").value_or("")).value_or(100);
+    benchmark.emplace(static_cast<std::uint32_t>(warmup), static_cast<std::uint32_t>(frame_limit));
+  }
+
+  std::optional<veng::GlfwInitialization> glfw;
+  std::optional<veng::Window> window;
+  std::optional<veng::Graphics> graphics;
+  if (headless)
+  {
+    graphics.emplace(settings);
+  }
+  else
+  {
+    glfw.emplace();
+    window.emplace("Vulkan Renderer", glm::ivec2(800, 600));
+    window->TryMoveToMonitor(1);
+    graphics.emplace(&*window, settings);
+  }
+
+  // A quad: four vertices shared by two triangles through the index buffer
+  std::array<veng::Vertex, 4> quad_vertices = {
+      veng::Vertex{glm::vec3(-0.5f, -0.5f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec2(0.0f, 0.0f)},
+      veng::Vertex{glm::vec3(0.5f, -0.5f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(1.0f, 0.0f)},
+      veng::Vertex{glm::vec3(0.5f, 0.5f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(1.0f, 1.0f)},
+      veng::Vertex{glm::vec3(-0.5f, 0.5f, 0.0f), glm::vec3(1.0f, 0.0f, 0.5f), glm::vec2(0.0f, 1.0f)}};
+  std::array<std::uint32_t, 6> quad_indices = {0, 1, 2, 2, 3, 0};
+  veng::MeshHandle quad = graphics->CreateMesh(quad_vertices, quad_indices);
+  // A mesh file written by MeshConverter is drawn in place of the quad
+  veng::MeshHandle mesh = quad;
+  if (auto mesh_path = veng::GetArgumentValue(arguments, "--mesh"))
+  {
+    mesh = graphics->LoadMesh(std::filesystem::path(*mesh_path)).value_or(quad);
+  }
+  // Or streamed in the background, the quad is drawn until the file is resident
+  std::optional<veng::AssetStreamer> streamer;
+  std::optional<veng::AssetHandle> streamed_mesh;
+  if (auto stream_path = veng::GetArgumentValue(arguments, "--stream"))
+  {
+    streamer.emplace(*graphics);
+    streamed_mesh = streamer->RequestMesh(std::filesystem::path(*stream_path), 0.0f);
+  }
+
+  // 8x8 checkerboard, sampled through the bindless table
+  std::vector<std::uint32_t> checker_texels(64 * 64);
+  for (std::uint32_t y = 0; y < 64; y++)
+  {
+    for (std::uint32_t x = 0; x < 64; x++)
+    {
+      checker_texels[y * 64 + x] = ((x / 8 + y / 8) % 2 == 0) ? 0xffffffff : 0xff404040;
+    }
+  }
+  veng::BindlessIndex checker = graphics->CreateTexture(64, 64, checker_texels);
+
+  // Instance streams, the transforms are rewritten every frame
+  std::vector<veng::InstanceTransform> instance_transforms(instance_count);
+  std::vector<veng::InstanceColor> instance_colors(instance_count);
+  std::vector<veng::InstanceMaterial> instance_materials(instance_count, checker);
+  for (std::uint32_t i = 0; i < instance_count; i++)
+  {
+    const float hue = static_cast<float>(i) / static_cast<float>(instance_count);
+    instance_colors[i] = glm::vec4(1.0f - hue, 0.5f, hue, 1.0f);
+  }
+
+  // Static, uploaded once and culled by the GPU every frame
+  const glm::mat4 scene_scale = glm::scale(glm::mat4(1.0f), glm::vec3(4.0f, 4.0f, 1.0f));
+  for (std::uint32_t i = 0; i < scene_object_count; i++)
+  {
+    graphics->AddSceneObject(mesh, scene_scale * GridCellTransform(i, scene_object_count, glm::mat4(1.0f)), checker);
+  }
+
+  const auto start_time = std::chrono::steady_clock::now();
+  std::uint64_t frame_count = 0;
+  auto keep_running = [&]()
+  {
+    if (benchmark.has_value())
+    {
+      return !benchmark->IsFinished() && (headless || !window->ShouldClose());
+    }
+    return headless ? frame_count < frame_limit : !window->ShouldClose();
+  };
+
+  while (keep_running())
+  {
+    if (benchmark.has_value())
+    {
+      benchmark->BeginFrame();
+    }
+    if (!headless)
+    {
+      glfwPollEvents();
+    }
+    graphics->GetJobSystem().RunMainThreadJobs();
+    graphics->BeginFrame();
+    veng::MeshHandle frame_mesh = mesh;
+    if (streamer.has_value())
+    {
+      streamer->Update();
+      frame_mesh = streamer->GetMesh(*streamed_mesh).value_or(mesh);
+    }
+    // Spin the mesh, 90 degrees per second
+    const float angle = glm::radians(90.0f) * static_cast<float>(veng::ElapsedMilliseconds(start_time) / 1000.0);
+    const glm::mat4 spin = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 0.0f, 1.0f));
+    if (scene_object_count > 0)
+    {
+      const glm::vec3 pan(3.0f * std::sin(angle * 0.25f), 0.0f, 0.0f);
+      graphics->SetViewProjection(glm::translate(glm::mat4(1.0f), pan));
+    }
+    if (instance_count > 0)
+    {
+      graphics->GetJobSystem().ParallelFor(
+          instance_count, 16 * 1024,
+          [&](std::uint32_t begin, std::uint32_t end)
+          {
+            for (std::uint32_t i = begin; i < end; i++)
+            {
+              instance_transforms[i] = GridCellTransform(i, instance_count, spin);
+            }
+          });
+      graphics->RenderInstanced(
+          frame_mesh, veng::InstanceStream{instance_transforms, instance_colors, instance_materials});
+    }
+    else if (draw_count == 1)
+    {
+      graphics->RenderIndexed(frame_mesh, spin, checker);
+    }
+    else
+    {
+      for (std::uint64_t i = 0; i < draw_count; i++)
+      {
+        graphics->RenderIndexed(frame_mesh, GridCellTransform(i, draw_count, spin), checker);
+      }
+    }
+    graphics->EndFrame();
+    if (benchmark.has_value())
+    {
+      benchmark->EndFrame(graphics->GetFrameTimings());
+    }
+    frame_count++;
+  }
+
+  if (veng::HasArgument(arguments, "--gpu-stats"))
+  {
+    graphics->LogGpuResults();
+    const veng::RenderGraphStats& graph = graphics->GetRenderGraphStats();
+    SPDLOG_INFO(
+        "Render graph: {} passes ({} culled), {} barrier batches, {} transient images in {} bytes ({} unaliased)",
+        graph.pass_count_, graph.culled_pass_count_, graph.barrier_batch_count_, graph.transient_image_count_,
+        graph.transient_bytes_, graph.unaliased_bytes_);
+  }
+  if (benchmark.has_value())
   {
-    glfwPollEvents();
-    graphics.BeginFrame();
-    graphics.RenderTriangle();
-    graphics.EndFrame();
+    benchmark->LogSummary();
+    if (auto output = veng::GetArgumentValue(arguments, "--benchmark-output"))
+    {
+      benchmark->WriteReport(*output);
+    }
   }
 
   return EXIT_SUCCESS;
@@ -0,0 +1,107 @@
+#include <mapped_file.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace veng
+{
+  std::optional<MappedFile> MappedFile::Open(const std::filesystem::path& path)
+  {
+    std::error_code error;
+    const std::uintmax_t size = std::filesystem::file_size(path, error);
+    if (error || size == 0)
+    {
+      SPDLOG_ERROR("Cannot map {}: {}", path.string(), error ? error.message() : "the file is empty");
+      return std::nullopt;
+    }
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(
+        path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+      SPDLOG_ERROR("Failed to open {}", path.string());
+      return std::nullopt;
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr)
+    {
+      SPDLOG_ERROR("Failed to map {}", path.string());
+      return std::nullopt;
+    }
+    // The view keeps the mapping alive
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (data == nullptr)
+    {
+      SPDLOG_ERROR("Failed to map {}", path.string());
+      return std::nullopt;
+    }
+#else
+    const std::int32_t file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0)
+    {
+      SPDLOG_ERROR("Failed to open {}: {}", path.string(), std::strerror(errno));
+      return std::nullopt;
+    }
+    // The mapping keeps the file alive
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED)
+    {
+      SPDLOG_ERROR("Failed to map {}: {}", path.string(), std::strerror(errno));
+      return std::nullopt;
+    }
+    // Files are read front to back once, let the kernel read ahead. The advice values are not flags.
+    madvise(data, size, MADV_SEQUENTIAL);
+    madvise(data, size, MADV_WILLNEED);
+#endif
+
+    return MappedFile(static_cast<const std::uint8_t*>(data), static_cast<std::size_t>(size));
+  }
+
+  MappedFile::~MappedFile()
+  {
+    Unmap();
+  }
+
+  MappedFile::MappedFile(MappedFile&& other) noexcept :
+      data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0))
+  {
+  }
+
+  MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+  {
+    if (this != &other)
+    {
+      Unmap();
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
+
+  void MappedFile::Unmap()
+  {
+    if (data_ == nullptr)
+    {
+      return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+#else
+    munmap(const_cast<std::uint8_t*>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+  }
+}  // namespace veng
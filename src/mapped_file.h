@@ -0,0 +1,29 @@
+#pragma once
+
+namespace veng
+{
+  // A whole file mapped read-only into memory. Pages are read from the disk cache as they are touched, reading a
+  // file costs no buffer of its own and no copy.
+  class MappedFile
+  {
+   public:
+    // std::nullopt when the file cannot be opened or is empty
+    static std::optional<MappedFile> Open(const std::filesystem::path& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Starts at a page boundary, so any alignment the file's layout keeps holds in memory too
+    gsl::span<const std::uint8_t> GetBytes() const { return {data_, size_}; };
+
+   private:
+    MappedFile(const std::uint8_t* data, std::size_t size) : data_(data), size_(size) {};
+    void Unmap();
+
+    const std::uint8_t* data_ = nullptr;
+    std::size_t size_ = 0;
+  };
+}  // namespace veng
@@ -0,0 +1,157 @@
+#include <mesh_file.h>
+
+namespace veng
+{
+  // True when [offset, offset + size) lies in a file of file_size bytes and starts aligned
+  static bool IsSectionValid(std::uint64_t offset, std::uint64_t size, std::uint64_t file_size)
+  {
+    return offset % kMeshSectionAlignment == 0 && offset <= file_size && size <= file_size - offset;
+  }
+
+  // An index past the vertices would make the GPU read outside of the vertex buffer
+  template <typename Index>
+  static bool AreIndicesValid(gsl::span<const std::uint8_t> index_bytes, std::uint32_t vertex_count)
+  {
+    const gsl::span<const Index> indices(
+        reinterpret_cast<const Index*>(index_bytes.data()), index_bytes.size() / sizeof(Index));
+    return std::ranges::all_of(
+        indices,
+        [vertex_count](Index index)
+        {
+          return index < vertex_count;
+        });
+  }
+
+  std::optional<MeshFile> MeshFile::Open(const std::filesystem::path& path)
+  {
+    ZoneScoped;
+    std::optional<MappedFile> mapped = MappedFile::Open(path);
+    if (!mapped.has_value())
+    {
+      return std::nullopt;
+    }
+
+    MeshFile mesh(std::move(*mapped));
+    gsl::span<const std::uint8_t> bytes = mesh.file_.GetBytes();
+    if (bytes.size() < sizeof(MeshFileHeader))
+    {
+      SPDLOG_ERROR("{} is too small to be a mesh file", path.string());
+      return std::nullopt;
+    }
+    const MeshFileHeader& header = *reinterpret_cast<const MeshFileHeader*>(bytes.data());
+    if (header.magic_ != kMeshFileMagic || header.version_ != kMeshFileVersion ||
+        header.vertex_stride_ != sizeof(Vertex))
+    {
+      SPDLOG_ERROR(
+          "{} is not a version {} mesh file with {} byte vertices", path.string(), kMeshFileVersion, sizeof(Vertex));
+      return std::nullopt;
+    }
+
+    const std::uint64_t lod_size = std::uint64_t{header.lod_count_} * sizeof(MeshFileLod);
+    const std::uint64_t vertex_size = std::uint64_t{header.vertex_count_} * sizeof(Vertex);
+    const std::uint64_t index_size = std::uint64_t{header.index_count_} * header.index_size_;
+    const bool sections_valid = IsSectionValid(header.lod_offset_, lod_size, bytes.size()) &&
+                                IsSectionValid(header.vertex_offset_, vertex_size, bytes.size()) &&
+                                IsSectionValid(header.index_offset_, index_size, bytes.size());
+    if ((header.index_size_ != 2 && header.index_size_ != 4) || header.vertex_count_ == 0 || header.lod_count_ == 0 ||
+        !sections_valid)
+    {
+      SPDLOG_ERROR("{} is truncated or its sections are corrupt", path.string());
+      return std::nullopt;
+    }
+
+    mesh.header_ = &header;
+    mesh.lods_ = {reinterpret_cast<const MeshFileLod*>(bytes.data() + header.lod_offset_), header.lod_count_};
+    mesh.vertices_ = {reinterpret_cast<const Vertex*>(bytes.data() + header.vertex_offset_), header.vertex_count_};
+    mesh.index_bytes_ = bytes.subspan(header.index_offset_, index_size);
+    for (const MeshFileLod& lod : mesh.lods_)
+    {
+      if (lod.index_count_ == 0 || lod.first_index_ > header.index_count_ ||
+          lod.index_count_ > header.index_count_ - lod.first_index_)
+      {
+        SPDLOG_ERROR("{} has an empty level of detail or one outside of its indices", path.string());
+        return std::nullopt;
+      }
+    }
+    const bool indices_valid = header.index_size_ == 2
+                                   ? AreIndicesValid<std::uint16_t>(mesh.index_bytes_, header.vertex_count_)
+                                   : AreIndicesValid<std::uint32_t>(mesh.index_bytes_, header.vertex_count_);
+    if (!indices_valid)
+    {
+      SPDLOG_ERROR("{} has indices past its {} vertices", path.string(), header.vertex_count_);
+      return std::nullopt;
+    }
+    return mesh;
+  }
+
+  VkIndexType MeshFile::GetIndexType() const
+  {
+    return header_->index_size_ == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+  }
+
+  bool WriteMeshFile(
+      const std::filesystem::path& path, gsl::span<const Vertex> vertices, gsl::span<const std::uint32_t> indices,
+      gsl::span<const MeshFileLod> lods)
+  {
+    const MeshFileLod full_lod{0, static_cast<std::uint32_t>(indices.size()), 0.0f};
+    if (lods.empty())
+    {
+      lods = gsl::span<const MeshFileLod>(&full_lod, 1);
+    }
+
+    MeshFileHeader header;
+    header.vertex_count_ = static_cast<std::uint32_t>(vertices.size());
+    header.index_count_ = static_cast<std::uint32_t>(indices.size());
+    header.index_size_ = vertices.size() <= std::numeric_limits<std::uint16_t>::max() + 1 ? 2 : 4;
+    header.lod_count_ = static_cast<std::uint32_t>(lods.size());
+    header.bounds_ = ComputeBoundingSphere(vertices);
+    header.lod_offset_ = AlignUp(sizeof(MeshFileHeader), kMeshSectionAlignment);
+    header.vertex_offset_ = AlignUp(header.lod_offset_ + lods.size_bytes(), kMeshSectionAlignment);
+    header.index_offset_ = AlignUp(header.vertex_offset_ + vertices.size_bytes(), kMeshSectionAlignment);
+
+    std::vector<std::uint8_t> bytes(header.index_offset_ + std::uint64_t{header.index_count_} * header.index_size_);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    std::memcpy(bytes.data() + header.lod_offset_, lods.data(), lods.size_bytes());
+    std::memcpy(bytes.data() + header.vertex_offset_, vertices.data(), vertices.size_bytes());
+    if (header.index_size_ == 2)
+    {
+      std::vector<std::uint16_t> narrow_indices(indices.begin(), indices.end());
+      std::memcpy(bytes.data() + header.index_offset_, narrow_indices.data(), narrow_indices.size() * 2);
+    }
+    else
+    {
+      std::memcpy(bytes.data() + header.index_offset_, indices.data(), indices.size_bytes());
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!file.good())
+    {
+      SPDLOG_ERROR("Failed to write the mesh file {}", path.string());
+      return false;
+    }
+    return true;
+  }
+
+  glm::vec4 ComputeBoundingSphere(gsl::span<const Vertex> vertices)
+  {
+    if (vertices.empty())
+    {
+      return glm::vec4(0.0f);
+    }
+    glm::vec3 min_corner(std::numeric_limits<float>::max());
+    glm::vec3 max_corner(std::numeric_limits<float>::lowest());
+    for (const Vertex& vertex : vertices)
+    {
+      min_corner = glm::min(min_corner, vertex.position_);
+      max_corner = glm::max(max_corner, vertex.position_);
+    }
+    const glm::vec3 center = (min_corner + max_corner) * 0.5f;
+    float radius = 0.0f;
+    for (const Vertex& vertex : vertices)
+    {
+      radius = std::max(radius, glm::distance(center, vertex.position_));
+    }
+    return glm::vec4(center, radius);
+  }
+}  // namespace veng
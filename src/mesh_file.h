@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <mapped_file.h>
+#include <vertex.h>
+
+namespace veng
+{
+  // Binary mesh container, produced offline by MeshConverter and mapped as is at load time. Little endian, every
+  // section starts at a multiple of kMeshSectionAlignment:
+  //   MeshFileHeader | MeshFileLod[lod_count_] | Vertex[vertex_count_] | indices[index_count_]
+  // Indices are stored at their final width, so both buffers go from the mapping to the staging buffers untouched.
+  constexpr std::array<char, 4> kMeshFileMagic = {'V', 'M', 'S', 'H'};
+  constexpr std::uint32_t kMeshFileVersion = 1;
+  constexpr std::uint64_t kMeshSectionAlignment = 16;
+
+  struct MeshFileHeader
+  {
+    std::array<char, 4> magic_ = kMeshFileMagic;
+    std::uint32_t version_ = kMeshFileVersion;
+    std::uint32_t vertex_stride_ = sizeof(Vertex);  // Guards against a Vertex layout change without a version bump
+    std::uint32_t index_size_ = 4;  // 2 or 4 bytes
+    std::uint32_t vertex_count_ = 0;
+    std::uint32_t index_count_ = 0;
+    std::uint32_t lod_count_ = 0;
+    std::uint32_t padding_ = 0;
+    glm::vec4 bounds_ = glm::vec4(0.0f);  // Bounding sphere, center then radius
+    std::uint64_t lod_offset_ = 0;
+    std::uint64_t vertex_offset_ = 0;
+    std::uint64_t index_offset_ = 0;
+  };
+
+  // A level of detail, a range of the shared index data. LOD 0 is the full mesh, each next one coarser.
+  struct MeshFileLod
+  {
+    std::uint32_t first_index_ = 0;
+    std::uint32_t index_count_ = 0;
+    float error_ = 0.0f;  // Object-space deviation from LOD 0
+    std::uint32_t padding_ = 0;
+  };
+
+  // A mesh file mapped in memory. The spans point into the mapping and live as long as the MeshFile.
+  class MeshFile
+  {
+   public:
+    // Validates the header, every section against the file size and every index against the vertex count,
+    // std::nullopt when anything is off, an empty mesh or level of detail included
+    static std::optional<MeshFile> Open(const std::filesystem::path& path);
+
+    const MeshFileHeader& GetHeader() const { return *header_; };
+    gsl::span<const MeshFileLod> GetLods() const { return lods_; };
+    gsl::span<const Vertex> GetVertices() const { return vertices_; };
+    gsl::span<const std::uint8_t> GetIndexBytes() const { return index_bytes_; };
+    VkIndexType GetIndexType() const;
+
+   private:
+    explicit MeshFile(MappedFile file) : file_(std::move(file)) {};
+
+    MappedFile file_;
+    const MeshFileHeader* header_ = nullptr;
+    gsl::span<const MeshFileLod> lods_;
+    gsl::span<const Vertex> vertices_;
+    gsl::span<const std::uint8_t> index_bytes_;
+  };
+
+  // Writes a mesh file. Indices are narrowed to 16 bits when the vertex count allows it, no LODs means a single
+  // one covering every index.
+  bool WriteMeshFile(
+      const std::filesystem::path& path, gsl::span<const Vertex> vertices, gsl::span<const std::uint32_t> indices,
+      gsl::span<const MeshFileLod> lods = {});
+
+  // Sphere around the center of the bounding box, looser than the tightest one but cheap and stable: center, radius
+  glm::vec4 ComputeBoundingSphere(gsl::span<const Vertex> vertices);
+}  // namespace veng
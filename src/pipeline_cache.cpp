@@ -0,0 +1,155 @@
+#include <pipeline_cache.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace veng
+{
+  // Writes bytes to path and flushes them to the disk before returning, so a rename published afterwards never
+  // points at data still in the OS cache when the power goes
+  static bool WriteFileDurably(const std::filesystem::path& path, gsl::span<const std::uint8_t> bytes)
+  {
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+      return false;
+    }
+    bool written = true;
+    for (std::size_t offset = 0; written && offset < bytes.size();)
+    {
+      const DWORD chunk = static_cast<DWORD>(std::min<std::size_t>(bytes.size() - offset, 1u << 30));
+      DWORD chunk_written = 0;
+      written = WriteFile(file, bytes.data() + offset, chunk, &chunk_written, nullptr) && chunk_written > 0;
+      offset += chunk_written;
+    }
+    written = written && FlushFileBuffers(file);
+    CloseHandle(file);
+    return written;
+#else
+    const std::int32_t file = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (file < 0)
+    {
+      return false;
+    }
+    bool written = true;
+    for (std::size_t offset = 0; written && offset < bytes.size();)
+    {
+      const ssize_t chunk_written = write(file, bytes.data() + offset, bytes.size() - offset);
+      if (chunk_written < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      written = chunk_written > 0;
+      offset += written ? static_cast<std::size_t>(chunk_written) : 0;
+    }
+    written = written && fsync(file) == 0;
+    return close(file) == 0 && written;
+#endif
+  }
+
+  PipelineCache::PipelineCache(VkPhysicalDevice physical_device, VkDevice device, std::filesystem::path path) :
+      device_(device), path_(std::move(path))
+  {
+    vkGetPhysicalDeviceProperties(physical_device, &device_properties_);
+
+    std::vector<std::uint8_t> data;
+    if (std::filesystem::exists(path_))
+    {
+      data = ReadFile(path_);
+      if (!IsCompatible(data))
+      {
+        SPDLOG_WARN("Discarding the pipeline cache {}, it was written for another device or driver", path_.string());
+        data.clear();
+      }
+    }
+
+    VkPipelineCacheCreateInfo info = NULL_STRUCT;
+    info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    info.initialDataSize = data.size();
+    info.pInitialData = data.empty() ? nullptr : data.data();
+
+    if (vkCreatePipelineCache(device_, &info, VK_NULL_HANDLE, &cache_) != VK_SUCCESS)
+    {
+      SPDLOG_ERROR("Failed creating the pipeline cache");
+      std::exit(EXIT_FAILURE);
+    }
+
+    saved_hash_ = HashBytes(data);
+    SPDLOG_INFO("Loaded {} bytes of pipeline cache from {}", data.size(), path_.string());
+  }
+
+  PipelineCache::~PipelineCache()
+  {
+    if (cache_ != VK_NULL_HANDLE)
+    {
+      Save();
+      vkDestroyPipelineCache(device_, cache_, VK_NULL_HANDLE);
+    }
+  }
+
+  bool PipelineCache::IsCompatible(gsl::span<const std::uint8_t> data) const
+  {
+    VkPipelineCacheHeaderVersionOne header = NULL_STRUCT;
+    if (data.size() < sizeof(header))
+    {
+      return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    return header.headerSize >= sizeof(header) && header.headerSize <= data.size() &&
+           header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header.vendorID == device_properties_.vendorID && header.deviceID == device_properties_.deviceID &&
+           std::memcmp(header.pipelineCacheUUID, device_properties_.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+  }
+
+  bool PipelineCache::Save()
+  {
+    std::size_t size = 0;
+    if (vkGetPipelineCacheData(device_, cache_, &size, nullptr) != VK_SUCCESS)
+    {
+      return false;
+    }
+
+    std::vector<std::uint8_t> data(size);
+    if (vkGetPipelineCacheData(device_, cache_, &size, data.data()) != VK_SUCCESS)
+    {
+      SPDLOG_ERROR("Failed reading back the pipeline cache data");
+      return false;
+    }
+    data.resize(size);
+    const std::uint64_t hash = HashBytes(data);
+    if (hash == saved_hash_)
+    {
+      return false;
+    }
+
+    // Write next to the destination, flush it to the disk, then rename over it: a crash or power loss at any point
+    // leaves either the previous cache or the complete new one
+    std::filesystem::path temporary_path = path_;
+    temporary_path += ".tmp";
+    if (!WriteFileDurably(temporary_path, data))
+    {
+      SPDLOG_ERROR("Failed writing the pipeline cache to {}", temporary_path.string());
+      return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path_, error);
+    if (error)
+    {
+      SPDLOG_ERROR("Failed replacing the pipeline cache {}: {}", path_.string(), error.message());
+      return false;
+    }
+
+    saved_hash_ = hash;
+    SPDLOG_INFO("Saved {} bytes of pipeline cache to {}", size, path_.string());
+    return true;
+  }
+}  // namespace veng
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+namespace veng
+{
+  // VkPipelineCache persisted on disk between runs. Data written by another driver or device is discarded on load.
+  class PipelineCache
+  {
+   public:
+    PipelineCache(VkPhysicalDevice physical_device, VkDevice device, std::filesystem::path path);
+    ~PipelineCache();
+
+    PipelineCache(const PipelineCache&) = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+
+    VkPipelineCache GetHandle() const { return cache_; };
+
+    // Writes the cache back to disk if its contents changed since the last save. The file is flushed to the disk
+    // and replaced atomically.
+    bool Save();
+
+   private:
+    bool IsCompatible(gsl::span<const std::uint8_t> data) const;
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    VkPipelineCache cache_ = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties device_properties_ = NULL_STRUCT;
+    std::filesystem::path path_;
+    // HashBytes() of what is on disk, the driver may change the contents without changing the size
+    std::uint64_t saved_hash_ = 0;
+  };
+}  // namespace veng
@@ -0,0 +1,451 @@
+#include <pipeline_registry.h>
+
+namespace veng
+{
+  PipelineRegistry::PipelineRegistry(
+      VkDevice device, VkPipelineCache cache, ShaderLibrary& shaders, JobSystem& jobs, VkPipelineLayout layout) :
+      device_(device), cache_(cache), shaders_(shaders), jobs_(jobs), layout_(layout)
+  {
+  }
+
+  PipelineRegistry::~PipelineRegistry()
+  {
+    // Let in-flight compilations land before destroying what they produced
+    jobs_.Wait(compiles_in_flight_);
+
+    for (PipelineHandle handle = 0; handle < entry_count_; handle++)
+    {
+      Entry& entry = GetEntry(handle);
+      VkPipeline pipeline = entry.pipeline_.load();
+      if (pipeline != VK_NULL_HANDLE)
+      {
+        vkDestroyPipeline(device_, pipeline, VK_NULL_HANDLE);
+      }
+      if (entry.reloaded_pipeline_ != VK_NULL_HANDLE)
+      {
+        vkDestroyPipeline(device_, entry.reloaded_pipeline_, VK_NULL_HANDLE);
+      }
+    }
+  }
+
+  std::uint64_t PipelineRegistry::Hash(const PipelineDescription& description, const ShaderLibrary& shaders)
+  {
+    std::uint64_t hash = 0;
+    hash = HashCombine(hash, shaders.GetHash(description.vertex_shader_));
+    hash = HashCombine(hash, shaders.GetHash(description.fragment_shader_));
+    hash = HashCombine(hash, shaders.GetHash(description.compute_shader_));
+    for (const SpecializationConstant& constant : description.specialization_constants_)
+    {
+      hash = HashCombine(hash, constant.id_);
+      hash = HashCombine(hash, constant.value_);
+    }
+
+    for (const VkVertexInputBindingDescription& binding : description.vertex_layout_.bindings_)
+    {
+      hash = HashCombine(hash, binding.binding);
+      hash = HashCombine(hash, binding.stride);
+      hash = HashCombine(hash, binding.inputRate);
+    }
+    for (const VkVertexInputAttributeDescription& attribute : description.vertex_layout_.attributes_)
+    {
+      hash = HashCombine(hash, attribute.location);
+      hash = HashCombine(hash, attribute.binding);
+      hash = HashCombine(hash, attribute.format);
+      hash = HashCombine(hash, attribute.offset);
+    }
+    hash = HashCombine(hash, description.topology_);
+
+    hash = HashCombine(hash, description.polygon_mode_);
+    hash = HashCombine(hash, description.cull_mode_);
+    hash = HashCombine(hash, description.front_face_);
+
+    hash = HashCombine(hash, description.blend_enable_);
+
+    hash = HashCombine(hash, description.depth_test_enable_);
+    hash = HashCombine(hash, description.depth_write_enable_);
+    hash = HashCombine(hash, description.depth_compare_op_);
+
+    hash = HashCombine(hash, description.color_format_);
+    hash = HashCombine(hash, description.depth_format_);
+
+    return hash;
+  }
+
+  PipelineHandle PipelineRegistry::Request(const PipelineDescription& requested)
+  {
+    // Sorted by id, the order constants are given in must not make a new variant. Vulkan takes each id once, the
+    // first value given wins.
+    PipelineDescription description = requested;
+    std::vector<SpecializationConstant>& constants = description.specialization_constants_;
+    std::stable_sort(
+        constants.begin(), constants.end(),
+        [](const SpecializationConstant& left, const SpecializationConstant& right)
+        {
+          return left.id_ < right.id_;
+        });
+    constants.erase(
+        std::unique(
+            constants.begin(), constants.end(),
+            [](const SpecializationConstant& left, const SpecializationConstant& right)
+            {
+              return left.id_ == right.id_;
+            }),
+        constants.end());
+
+    // Loading the modules first makes their content part of the hash
+    const bool is_compute = !description.compute_shader_.empty();
+    VkShaderModule vertex_module = is_compute ? VK_NULL_HANDLE : shaders_.GetModule(description.vertex_shader_);
+    const bool has_fragment = !is_compute && !description.fragment_shader_.empty();
+    VkShaderModule fragment_module = has_fragment ? shaders_.GetModule(description.fragment_shader_) : VK_NULL_HANDLE;
+    VkShaderModule compute_module = is_compute ? shaders_.GetModule(description.compute_shader_) : VK_NULL_HANDLE;
+
+    const std::uint64_t hash = Hash(description, shaders_);
+    auto [first, last] = handles_by_hash_.equal_range(hash);
+    for (auto it = first; it != last; ++it)
+    {
+      if (GetEntry(it->second).description_ == description)
+      {
+        return it->second;
+      }
+    }
+
+    const PipelineHandle handle = entry_count_;
+    if (handle == kEntriesPerChunk * kMaxChunks)
+    {
+      throw std::runtime_error("Too many pipelines requested!");
+    }
+    if (handle % kEntriesPerChunk == 0)
+    {
+      chunks_[handle / kEntriesPerChunk] = std::make_unique<Entry[]>(kEntriesPerChunk);
+    }
+    entry_count_++;
+    Entry& entry = GetEntry(handle);
+    entry.description_ = description;
+    entry.vertex_module_ = vertex_module;
+    entry.fragment_module_ = fragment_module;
+    entry.compute_module_ = compute_module;
+    entry.hash_ = hash;
+    for (const SpecializationConstant& constant : description.specialization_constants_)
+    {
+      entry.specialization_entries_.push_back(VkSpecializationMapEntry{
+          constant.id_, static_cast<std::uint32_t>(entry.specialization_data_.size() * sizeof(std::uint32_t)),
+          sizeof(std::uint32_t)});
+      entry.specialization_data_.push_back(constant.value_);
+    }
+    handles_by_hash_.emplace(hash, handle);
+
+    const bool missing_shader = is_compute ? compute_module == VK_NULL_HANDLE
+                                           : (vertex_module == VK_NULL_HANDLE ||
+                                              (has_fragment && fragment_module == VK_NULL_HANDLE));
+    if (missing_shader)
+    {
+      SPDLOG_ERROR("Pipeline {} is missing a shader, its draws will be skipped", handle);
+      return handle;
+    }
+
+    // Background priority: a compile can take milliseconds, it must not land on a thread the frame waits on
+    jobs_.Submit(
+        [this, &entry]()
+        {
+          ZoneScopedN("Compile pipeline");
+          [[maybe_unused]] auto start = std::chrono::steady_clock::now();
+          entry.pipeline_.store(entry.compute_module_ != VK_NULL_HANDLE ? CompileCompute(entry) : Compile(entry));
+          SPDLOG_DEBUG(
+              "Compiled pipeline {} in {:.2f}ms", DescribeShaders(entry.description_), ElapsedMilliseconds(start));
+        },
+        &compiles_in_flight_, JobPriority::kBackground);
+
+    return handle;
+  }
+
+  VkPipeline PipelineRegistry::Get(PipelineHandle handle) const
+  {
+    return GetEntry(handle).pipeline_.load(std::memory_order_acquire);
+  }
+
+  bool PipelineRegistry::Reload(const std::set<std::string>& shaders)
+  {
+    // Compile jobs read the entries' modules, they must not change underneath them
+    if (reload_pending_ || !compiles_in_flight_.IsDone())
+    {
+      return false;
+    }
+
+    std::set<std::string> reloaded;
+    std::vector<VkShaderModule> replaced_modules;
+    for (const std::string& name : shaders)
+    {
+      std::optional<VkShaderModule> replaced = shaders_.Reload(name);
+      if (replaced.has_value())
+      {
+        reloaded.insert(name);
+        replaced_modules.push_back(*replaced);
+      }
+    }
+
+    for (PipelineHandle handle = 0; handle < entry_count_; handle++)
+    {
+      Entry& entry = GetEntry(handle);
+      const PipelineDescription& description = entry.description_;
+      if (!reloaded.contains(description.vertex_shader_) && !reloaded.contains(description.fragment_shader_) &&
+          !reloaded.contains(description.compute_shader_))
+      {
+        continue;
+      }
+
+      const bool is_compute = !description.compute_shader_.empty();
+      entry.vertex_module_ = is_compute ? VK_NULL_HANDLE : shaders_.GetModule(description.vertex_shader_);
+      const bool has_fragment = !is_compute && !description.fragment_shader_.empty();
+      entry.fragment_module_ = has_fragment ? shaders_.GetModule(description.fragment_shader_) : VK_NULL_HANDLE;
+      entry.compute_module_ = is_compute ? shaders_.GetModule(description.compute_shader_) : VK_NULL_HANDLE;
+
+      // New SPIR-V, new hash: later requests for the same description must find the rebuilt pipeline
+      auto [first, last] = handles_by_hash_.equal_range(entry.hash_);
+      handles_by_hash_.erase(std::find_if(
+          first, last,
+          [handle](const std::pair<const std::uint64_t, PipelineHandle>& item)
+          {
+            return item.second == handle;
+          }));
+      entry.hash_ = Hash(description, shaders_);
+      handles_by_hash_.emplace(entry.hash_, handle);
+
+      const bool missing_shader = is_compute ? entry.compute_module_ == VK_NULL_HANDLE
+                                             : (entry.vertex_module_ == VK_NULL_HANDLE ||
+                                                (has_fragment && entry.fragment_module_ == VK_NULL_HANDLE));
+      if (missing_shader)
+      {
+        continue;
+      }
+
+      entry.reloading_ = true;
+      reload_pending_ = true;
+      jobs_.Submit(
+          [this, &entry]()
+          {
+            ZoneScopedN("Recompile pipeline");
+            [[maybe_unused]] auto start = std::chrono::steady_clock::now();
+            entry.reloaded_pipeline_ = entry.compute_module_ != VK_NULL_HANDLE ? CompileCompute(entry) : Compile(entry);
+            SPDLOG_DEBUG(
+                "Recompiled pipeline {} in {:.2f}ms", DescribeShaders(entry.description_), ElapsedMilliseconds(start));
+          },
+          &compiles_in_flight_, JobPriority::kBackground);
+    }
+
+    // A pipeline no longer needs the modules it was created from, and no compile job uses the replaced ones
+    for (VkShaderModule module : replaced_modules)
+    {
+      vkDestroyShaderModule(device_, module, VK_NULL_HANDLE);
+    }
+    return true;
+  }
+
+  void PipelineRegistry::CommitReloads(const std::function<void(VkPipeline)>& retire)
+  {
+    if (!reload_pending_ || !compiles_in_flight_.IsDone())
+    {
+      return;
+    }
+
+    for (PipelineHandle handle = 0; handle < entry_count_; handle++)
+    {
+      Entry& entry = GetEntry(handle);
+      if (!entry.reloading_)
+      {
+        continue;
+      }
+      entry.reloading_ = false;
+      if (entry.reloaded_pipeline_ == VK_NULL_HANDLE)
+      {
+        continue;
+      }
+      const VkPipeline replaced = entry.pipeline_.exchange(std::exchange(entry.reloaded_pipeline_, VK_NULL_HANDLE));
+      if (replaced != VK_NULL_HANDLE)
+      {
+        retire(replaced);
+      }
+    }
+    reload_pending_ = false;
+  }
+
+  VkSpecializationInfo PipelineRegistry::GetSpecializationInfo(const Entry& entry)
+  {
+    VkSpecializationInfo specialization_info = NULL_STRUCT;
+    specialization_info.mapEntryCount = static_cast<std::uint32_t>(entry.specialization_entries_.size());
+    specialization_info.pMapEntries = entry.specialization_entries_.data();
+    specialization_info.dataSize = entry.specialization_data_.size() * sizeof(std::uint32_t);
+    specialization_info.pData = entry.specialization_data_.data();
+    return specialization_info;
+  }
+
+  VkPipeline PipelineRegistry::Compile(const Entry& entry) const
+  {
+    const PipelineDescription& description = entry.description_;
+    const VkSpecializationInfo specialization_info = GetSpecializationInfo(entry);
+
+    // Shader Staging
+    VkPipelineShaderStageCreateInfo vertex_stage_info = NULL_STRUCT;
+    vertex_stage_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertex_stage_info.stage = VkShaderStageFlagBits::VK_SHADER_STAGE_VERTEX_BIT;
+    vertex_stage_info.module = entry.vertex_module_;
+    vertex_stage_info.pName = "main";
+    vertex_stage_info.pSpecializationInfo = &specialization_info;
+
+    VkPipelineShaderStageCreateInfo fragment_stage_info = NULL_STRUCT;
+    fragment_stage_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragment_stage_info.stage = VkShaderStageFlagBits::VK_SHADER_STAGE_FRAGMENT_BIT;
+    fragment_stage_info.module = entry.fragment_module_;
+    fragment_stage_info.pName = "main";
+    fragment_stage_info.pSpecializationInfo = &specialization_info;
+
+    std::array<VkPipelineShaderStageCreateInfo, 2> stage_infos = {vertex_stage_info, fragment_stage_info};
+    // Depth-only pipelines run no fragment shader
+    const std::uint32_t stage_count = entry.fragment_module_ != VK_NULL_HANDLE ? 2 : 1;
+
+    // Dynamic State Create info, viewport and scissor follow the swapchain so they are set while recording
+    std::array<VkDynamicState, 2> dynamic_states = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamic_state_info = NULL_STRUCT;
+    dynamic_state_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamic_state_info.dynamicStateCount = dynamic_states.size();
+    dynamic_state_info.pDynamicStates = dynamic_states.data();
+
+    VkPipelineViewportStateCreateInfo viewport_state_info = NULL_STRUCT;
+    viewport_state_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewport_state_info.viewportCount = 1;
+    viewport_state_info.scissorCount = 1;
+
+    // Vertex Input State Create info
+    VkPipelineVertexInputStateCreateInfo vertex_input_state_info = NULL_STRUCT;
+    vertex_input_state_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertex_input_state_info.vertexBindingDescriptionCount = description.vertex_layout_.bindings_.size();
+    vertex_input_state_info.pVertexBindingDescriptions = description.vertex_layout_.bindings_.data();
+    vertex_input_state_info.vertexAttributeDescriptionCount = description.vertex_layout_.attributes_.size();
+    vertex_input_state_info.pVertexAttributeDescriptions = description.vertex_layout_.attributes_.data();
+
+    // Input Assembly State Create info
+    VkPipelineInputAssemblyStateCreateInfo input_assembly_state_info = NULL_STRUCT;
+    input_assembly_state_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    input_assembly_state_info.topology = description.topology_;
+    input_assembly_state_info.primitiveRestartEnable = VK_FALSE;
+
+    // Rasterization State Create info
+    VkPipelineRasterizationStateCreateInfo rasterization_state_info = NULL_STRUCT;
+    rasterization_state_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterization_state_info.depthBiasClamp = VK_FALSE;
+    rasterization_state_info.rasterizerDiscardEnable = VK_FALSE;
+    rasterization_state_info.polygonMode = description.polygon_mode_;
+    rasterization_state_info.lineWidth = 1.0f;
+    rasterization_state_info.cullMode = description.cull_mode_;
+    rasterization_state_info.frontFace = description.front_face_;
+    rasterization_state_info.depthBiasEnable = VK_FALSE;
+
+    // Multisample State Create info
+    VkPipelineMultisampleStateCreateInfo multisampling_state_info = NULL_STRUCT;
+    multisampling_state_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling_state_info.sampleShadingEnable = VK_FALSE;
+    multisampling_state_info.rasterizationSamples = VkSampleCountFlagBits::VK_SAMPLE_COUNT_1_BIT;
+
+    // Depth Stencil State Create info
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_state_info = NULL_STRUCT;
+    depth_stencil_state_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depth_stencil_state_info.depthTestEnable = description.depth_test_enable_;
+    depth_stencil_state_info.depthWriteEnable = description.depth_write_enable_;
+    depth_stencil_state_info.depthCompareOp = description.depth_compare_op_;
+    depth_stencil_state_info.depthBoundsTestEnable = VK_FALSE;
+    depth_stencil_state_info.stencilTestEnable = VK_FALSE;
+
+    // Color Blend State Create info
+    VkPipelineColorBlendAttachmentState color_blend_attachment_state = NULL_STRUCT;
+    color_blend_attachment_state.blendEnable = description.blend_enable_;
+    color_blend_attachment_state.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    color_blend_attachment_state.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    color_blend_attachment_state.colorBlendOp = VK_BLEND_OP_ADD;
+    color_blend_attachment_state.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    color_blend_attachment_state.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    color_blend_attachment_state.alphaBlendOp = VK_BLEND_OP_ADD;
+    color_blend_attachment_state.colorWriteMask =
+        VkColorComponentFlagBits::VK_COLOR_COMPONENT_R_BIT | VkColorComponentFlagBits::VK_COLOR_COMPONENT_G_BIT |
+        VkColorComponentFlagBits::VK_COLOR_COMPONENT_B_BIT | VkColorComponentFlagBits::VK_COLOR_COMPONENT_A_BIT;
+    VkPipelineColorBlendStateCreateInfo color_blend_state_info = NULL_STRUCT;
+    color_blend_state_info.sType = VkStructureType::VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    color_blend_state_info.logicOpEnable = VK_FALSE;
+    color_blend_state_info.attachmentCount = description.color_format_ != VK_FORMAT_UNDEFINED ? 1 : 0;
+    color_blend_state_info.pAttachments = &color_blend_attachment_state;
+
+    // Dynamic rendering: the pipeline only knows the formats of the attachments it renders to
+    VkPipelineRenderingCreateInfo rendering_info = NULL_STRUCT;
+    rendering_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    rendering_info.colorAttachmentCount = description.color_format_ != VK_FORMAT_UNDEFINED ? 1 : 0;
+    rendering_info.pColorAttachmentFormats = &description.color_format_;
+    rendering_info.depthAttachmentFormat = description.depth_format_;
+
+    // Pipeline creation
+    VkGraphicsPipelineCreateInfo graphics_pipeline_info = NULL_STRUCT;
+    graphics_pipeline_info.sType = VkStructureType::VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    graphics_pipeline_info.pNext = &rendering_info;
+    graphics_pipeline_info.stageCount = stage_count;
+    graphics_pipeline_info.pStages = stage_infos.data();
+    graphics_pipeline_info.layout = layout_;
+    graphics_pipeline_info.renderPass = VK_NULL_HANDLE;
+
+    graphics_pipeline_info.pDynamicState = &dynamic_state_info;
+    graphics_pipeline_info.pViewportState = &viewport_state_info;
+    graphics_pipeline_info.pVertexInputState = &vertex_input_state_info;
+    graphics_pipeline_info.pInputAssemblyState = &input_assembly_state_info;
+    graphics_pipeline_info.pRasterizationState = &rasterization_state_info;
+    graphics_pipeline_info.pMultisampleState = &multisampling_state_info;
+    graphics_pipeline_info.pColorBlendState = &color_blend_state_info;
+    // Only pipelines rendering to a depth attachment have depth state
+    graphics_pipeline_info.pDepthStencilState =
+        description.depth_format_ != VK_FORMAT_UNDEFINED ? &depth_stencil_state_info : nullptr;
+
+    // The pipeline cache is internally synchronized, workers can share it
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult pipeline_result =
+        vkCreateGraphicsPipelines(device_, cache_, 1, &graphics_pipeline_info, VK_NULL_HANDLE, &pipeline);
+    if (pipeline_result != VK_SUCCESS)
+    {
+      SPDLOG_ERROR("Failed creating the graphics pipeline {}", DescribeShaders(description));
+      return VK_NULL_HANDLE;
+    }
+
+    return pipeline;
+  }
+
+  VkPipeline PipelineRegistry::CompileCompute(const Entry& entry) const
+  {
+    const VkSpecializationInfo specialization_info = GetSpecializationInfo(entry);
+    VkComputePipelineCreateInfo compute_pipeline_info = NULL_STRUCT;
+    compute_pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    compute_pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    compute_pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    compute_pipeline_info.stage.module = entry.compute_module_;
+    compute_pipeline_info.stage.pName = "main";
+    compute_pipeline_info.stage.pSpecializationInfo = &specialization_info;
+    compute_pipeline_info.layout = layout_;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult pipeline_result =
+        vkCreateComputePipelines(device_, cache_, 1, &compute_pipeline_info, VK_NULL_HANDLE, &pipeline);
+    if (pipeline_result != VK_SUCCESS)
+    {
+      SPDLOG_ERROR("Failed creating the compute pipeline {}", DescribeShaders(entry.description_));
+      return VK_NULL_HANDLE;
+    }
+
+    return pipeline;
+  }
+
+  std::string PipelineRegistry::DescribeShaders(const PipelineDescription& description)
+  {
+    std::string shaders = description.compute_shader_.empty()
+                              ? description.vertex_shader_ +
+                                    (description.fragment_shader_.empty() ? "" : " + " + description.fragment_shader_)
+                              : description.compute_shader_;
+    for (const SpecializationConstant& constant : description.specialization_constants_)
+    {
+      shaders += fmt::format(" [{}={}]", constant.id_, constant.value_);
+    }
+    return shaders;
+  }
+}  // namespace veng
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <shader_library.h>
+#include <job_system.h>
+#include <vertex.h>
+
+namespace veng
+{
+  // Replaces the default of a "layout(constant_id = id_) const" before the driver compiles the stage, which then
+  // drops the code the value disables. Every stage gets every constant, stages ignore the ids they do not declare.
+  struct SpecializationConstant
+  {
+    std::uint32_t id_ = 0;
+    // Bit pattern: bools are 0 or 1, floats go through std::bit_cast
+    std::uint32_t value_ = 0;
+
+    bool operator==(const SpecializationConstant&) const = default;
+  };
+
+  // Everything a pipeline is built from, two equal descriptions always share the same pipeline
+  struct PipelineDescription
+  {
+    std::string vertex_shader_;
+    // Empty for a depth-only pipeline, which then has no color format either
+    std::string fragment_shader_;
+    // Set instead of the two above for a compute pipeline, the fixed-function state is then ignored
+    std::string compute_shader_;
+    // Each set of values is its own pipeline variant, unset constants keep the shader's defaults
+    std::vector<SpecializationConstant> specialization_constants_;
+
+    // Vertex layout
+    VertexLayout vertex_layout_ = NULL_STRUCT;
+    VkPrimitiveTopology topology_ = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    // Rasterization
+    VkPolygonMode polygon_mode_ = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cull_mode_ = VK_CULL_MODE_NONE;
+    VkFrontFace front_face_ = VK_FRONT_FACE_CLOCKWISE;
+
+    // Blending
+    bool blend_enable_ = false;
+
+    // Depth
+    bool depth_test_enable_ = false;
+    bool depth_write_enable_ = false;
+    VkCompareOp depth_compare_op_ = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+    // Render targets, only their formats: any pass rendering to attachments of these formats can use the pipeline.
+    // No color format makes a depth-only pipeline.
+    VkFormat color_format_ = VK_FORMAT_UNDEFINED;
+    VkFormat depth_format_ = VK_FORMAT_UNDEFINED;
+
+    bool operator==(const PipelineDescription&) const = default;
+  };
+
+  using PipelineHandle = std::uint32_t;
+
+  // Deduplicates pipeline requests by description and compiles new pipelines as background jobs,
+  // so the render thread never waits on the driver's compiler
+  class PipelineRegistry
+  {
+   public:
+    PipelineRegistry(
+        VkDevice device, VkPipelineCache cache, ShaderLibrary& shaders, JobSystem& jobs, VkPipelineLayout layout);
+    ~PipelineRegistry();
+
+    PipelineRegistry(const PipelineRegistry&) = delete;
+    PipelineRegistry& operator=(const PipelineRegistry&) = delete;
+
+    // Returns immediately, the pipeline compiles in the background. Render thread only.
+    PipelineHandle Request(const PipelineDescription& description);
+    // VK_NULL_HANDLE until the pipeline has finished compiling (or if compilation failed). Any thread, also while
+    // Request() adds pipelines.
+    VkPipeline Get(PipelineHandle handle) const;
+
+    // Reloads the recompiled shaders and rebuilds the pipelines made from them in the background, handles keep
+    // returning the current pipelines until CommitReloads(). False, reloading nothing, while pipelines are still
+    // compiling or a reload waits to be committed. Render thread only.
+    bool Reload(const std::set<std::string>& shaders);
+    // Once every rebuilt pipeline has compiled, swaps them in and hands the replaced ones to retire. Render thread,
+    // between frames.
+    void CommitReloads(const std::function<void(VkPipeline)>& retire);
+
+    // True while requested or reloaded pipelines are still being compiled
+    bool IsCompiling() const { return !compiles_in_flight_.IsDone(); };
+
+    static std::uint64_t Hash(const PipelineDescription& description, const ShaderLibrary& shaders);
+
+   private:
+    struct Entry
+    {
+      PipelineDescription description_;
+      VkShaderModule vertex_module_ = VK_NULL_HANDLE;
+      VkShaderModule fragment_module_ = VK_NULL_HANDLE;
+      VkShaderModule compute_module_ = VK_NULL_HANDLE;
+      std::atomic<VkPipeline> pipeline_ = VK_NULL_HANDLE;
+      std::uint64_t hash_ = 0;
+      // The description's specialization constants in the layout VkSpecializationInfo points at
+      std::vector<VkSpecializationMapEntry> specialization_entries_;
+      std::vector<std::uint32_t> specialization_data_;
+
+      // Rebuilt by Reload(), swapped in by CommitReloads(). VK_NULL_HANDLE if it failed, keeping the current one.
+      bool reloading_ = false;
+      VkPipeline reloaded_pipeline_ = VK_NULL_HANDLE;
+    };
+
+    Entry& GetEntry(PipelineHandle handle) { return chunks_[handle / kEntriesPerChunk][handle % kEntriesPerChunk]; };
+    const Entry& GetEntry(PipelineHandle handle) const
+    {
+      return chunks_[handle / kEntriesPerChunk][handle % kEntriesPerChunk];
+    };
+    // Points into entry, valid as long as it is
+    static VkSpecializationInfo GetSpecializationInfo(const Entry& entry);
+    VkPipeline Compile(const Entry& entry) const;
+    VkPipeline CompileCompute(const Entry& entry) const;
+    // For logs, the shaders the pipeline is made of
+    static std::string DescribeShaders(const PipelineDescription& description);
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    VkPipelineCache cache_ = VK_NULL_HANDLE;
+    ShaderLibrary& shaders_;
+    JobSystem& jobs_;
+    VkPipelineLayout layout_ = VK_NULL_HANDLE;
+
+    // Fixed-size chunks in a table that never grows: entries stay in place while workers fill them in, and Get() on
+    // the recording threads never reads a structure Request() is modifying, as it would with a deque
+    static constexpr std::uint32_t kEntriesPerChunk = 64;
+    static constexpr std::uint32_t kMaxChunks = 64;
+    std::array<std::unique_ptr<Entry[]>, kMaxChunks> chunks_;
+    std::uint32_t entry_count_ = 0;
+    // Colliding descriptions get an entry each, a hash hit is confirmed by comparing them
+    std::unordered_multimap<std::uint64_t, PipelineHandle> handles_by_hash_;
+    JobCounter compiles_in_flight_;
+    bool reload_pending_ = false;
+  };
+}  // namespace veng
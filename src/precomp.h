@@ -12,15 +12,34 @@
 #include <set>
 #include <functional>
 #include <optional>
+#include <deque>
+#include <queue>
+#include <list>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <unordered_map>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <numeric>
+#include <bit>
+#include <limits>
 
 // Vendor
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <gsl/gsl>
 // #define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE // Uncomment for trace level logging
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h> // For color formatting
+#include <tracy/Tracy.hpp>
+#include <tracy/TracyVulkan.hpp>
 
 // User Defined
 #include <utilities.h>
@@ -0,0 +1,568 @@
+#include <render_graph.h>
+
+namespace veng
+{
+  struct UsageInfo
+  {
+    VkPipelineStageFlags2 stages_ = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 access_ = VK_ACCESS_2_NONE;
+    VkImageLayout layout_ = VK_IMAGE_LAYOUT_UNDEFINED;  // Images only
+    bool reads_ = false;
+    bool writes_ = false;
+  };
+
+  static UsageInfo Describe(ResourceUsage usage)
+  {
+    switch (usage)
+    {
+      case ResourceUsage::kColorAttachment:
+        return {
+            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, false, true};
+      case ResourceUsage::kDepthAttachment:
+        return {
+            VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, true, true};
+      case ResourceUsage::kDepthRead:
+        return {
+            VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, true, false};
+      case ResourceUsage::kSampled:
+        return {
+            VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, true, false};
+      case ResourceUsage::kStorageRead:
+        return {
+            VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT |
+                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, true, false};
+      case ResourceUsage::kStorageWrite:
+        return {
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true,
+            true};
+      case ResourceUsage::kIndirectRead:
+        return {
+            VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+            true, false};
+      case ResourceUsage::kTransferRead:
+        return {
+            VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            true, false};
+      case ResourceUsage::kTransferWrite:
+        return {
+            VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            false, true};
+    }
+    return NULL_STRUCT;
+  }
+
+  static VkImageCreateInfo GetImageInfo(const TransientImageDescription& description)
+  {
+    VkImageCreateInfo info = NULL_STRUCT;
+    info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    info.imageType = VK_IMAGE_TYPE_2D;
+    info.format = description.format_;
+    info.extent = {description.extent_.width, description.extent_.height, 1};
+    info.mipLevels = 1;
+    info.arrayLayers = 1;
+    info.samples = VK_SAMPLE_COUNT_1_BIT;
+    info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    info.usage = description.usage_;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    return info;
+  }
+
+  RenderGraph::RenderGraph(VkDevice device, GpuAllocator& allocator, std::uint32_t frames_in_flight) :
+      device_(device), allocator_(allocator), heaps_(frames_in_flight)
+  {
+  }
+
+  RenderGraph::~RenderGraph()
+  {
+    for (TransientHeap& heap : heaps_)
+    {
+      DestroyHeap(heap);
+    }
+  }
+
+  RenderResource RenderGraph::ImportImage(
+      VkImage image, VkImageView view, VkImageAspectFlags aspect, VkImageLayout initial_layout,
+      VkPipelineStageFlags2 initial_stage, VkImageLayout final_layout)
+  {
+    Resource resource;
+    resource.image_ = image;
+    resource.view_ = view;
+    resource.aspect_ = aspect;
+    resource.final_layout_ = final_layout;
+    resource.state_.layout_ = initial_layout;
+    resource.state_.write_stages_ = initial_stage;
+    resources_.push_back(resource);
+    return static_cast<RenderResource>(resources_.size() - 1);
+  }
+
+  RenderResource RenderGraph::ImportBuffer(
+      VkBuffer buffer, VkPipelineStageFlags2 last_stage, VkAccessFlags2 last_access)
+  {
+    Resource resource;
+    resource.buffer_ = buffer;
+    resource.state_.write_stages_ = last_stage;
+    resource.state_.write_access_ = last_access;
+    resources_.push_back(resource);
+    return static_cast<RenderResource>(resources_.size() - 1);
+  }
+
+  RenderResource RenderGraph::CreateImage(const TransientImageDescription& description)
+  {
+    Resource resource;
+    resource.aspect_ = description.aspect_;
+    resource.transient_ = description;
+    resources_.push_back(resource);
+    return static_cast<RenderResource>(resources_.size() - 1);
+  }
+
+  void RenderGraph::AddPass(
+      gsl::czstring name, std::vector<ResourceAccess> accesses, std::function<void(VkCommandBuffer)> record)
+  {
+    passes_.push_back({name, std::move(accesses), std::move(record)});
+  }
+
+  VkImage RenderGraph::GetImage(RenderResource image) const
+  {
+    return resources_[image].image_;
+  }
+
+  VkImageView RenderGraph::GetImageView(RenderResource image) const
+  {
+    return resources_[image].view_;
+  }
+
+  std::vector<std::uint32_t> RenderGraph::Cull() const
+  {
+    std::vector<bool> needed(resources_.size(), false);
+    std::vector<std::uint32_t> running;
+    for (std::uint32_t i = static_cast<std::uint32_t>(passes_.size()); i-- > 0;)
+    {
+      const Pass& pass = passes_[i];
+      const bool runs = std::any_of(
+          pass.accesses_.begin(), pass.accesses_.end(),
+          [this, &needed](const ResourceAccess& access)
+          {
+            const bool imported = !resources_[access.resource_].transient_.has_value();
+            return Describe(access.usage_).writes_ && (imported || needed[access.resource_]);
+          });
+      if (!runs)
+      {
+        continue;
+      }
+      running.push_back(i);
+      // Whatever it reads must have been written by the passes before it
+      for (const ResourceAccess& access : pass.accesses_)
+      {
+        if (Describe(access.usage_).reads_)
+        {
+          needed[access.resource_] = true;
+        }
+      }
+    }
+    std::reverse(running.begin(), running.end());
+    return running;
+  }
+
+  void RenderGraph::DestroyHeap(TransientHeap& heap)
+  {
+    for (VkImageView view : heap.views_)
+    {
+      vkDestroyImageView(device_, view, VK_NULL_HANDLE);
+    }
+    for (VkImage image : heap.images_)
+    {
+      vkDestroyImage(device_, image, VK_NULL_HANDLE);
+    }
+    if (heap.allocation_.IsValid())
+    {
+      allocator_.Free(heap.allocation_);
+    }
+    heap = TransientHeap();
+  }
+
+  void RenderGraph::PlaceTransientImages(gsl::span<const std::uint32_t> passes, std::uint32_t frame_index)
+  {
+    ZoneScoped;
+    // The lifetime of every transient image, in running passes
+    std::vector<RenderResource> transients;
+    for (std::uint32_t order = 0; order < passes.size(); order++)
+    {
+      for (const ResourceAccess& access : passes_[passes[order]].accesses_)
+      {
+        Resource& resource = resources_[access.resource_];
+        if (!resource.transient_.has_value())
+        {
+          continue;
+        }
+        if (resource.first_pass_ == std::numeric_limits<std::uint32_t>::max())
+        {
+          resource.first_pass_ = order;
+          transients.push_back(access.resource_);
+        }
+        resource.last_pass_ = order;
+      }
+    }
+
+    std::vector<VkMemoryRequirements> requirements(transients.size());
+    VkMemoryRequirements heap_requirements = NULL_STRUCT;
+    heap_requirements.alignment = 1;
+    heap_requirements.memoryTypeBits = ~0u;
+    for (std::uint32_t i = 0; i < transients.size(); i++)
+    {
+      const VkImageCreateInfo image_info = GetImageInfo(*resources_[transients[i]].transient_);
+      VkDeviceImageMemoryRequirements query = NULL_STRUCT;
+      query.sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS;
+      query.pCreateInfo = &image_info;
+      VkMemoryRequirements2 result = NULL_STRUCT;
+      result.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+      vkGetDeviceImageMemoryRequirements(device_, &query, &result);
+      requirements[i] = result.memoryRequirements;
+      heap_requirements.alignment = std::max(heap_requirements.alignment, requirements[i].alignment);
+      heap_requirements.memoryTypeBits &= requirements[i].memoryTypeBits;
+    }
+
+    // Largest first, each at the lowest offset that overlaps no image alive at the same time
+    std::vector<std::uint32_t> by_size(transients.size());
+    std::iota(by_size.begin(), by_size.end(), 0);
+    std::sort(
+        by_size.begin(), by_size.end(),
+        [&requirements](std::uint32_t left, std::uint32_t right)
+        {
+          return requirements[left].size > requirements[right].size;
+        });
+    std::vector<VkDeviceSize> offsets(transients.size(), 0);
+    std::vector<std::uint32_t> placed;
+    auto lifetimes_overlap = [this, &transients](std::uint32_t left, std::uint32_t right)
+    {
+      const Resource& a = resources_[transients[left]];
+      const Resource& b = resources_[transients[right]];
+      return a.first_pass_ <= b.last_pass_ && b.first_pass_ <= a.last_pass_;
+    };
+    auto memory_overlaps = [&](std::uint32_t left, std::uint32_t right)
+    {
+      return offsets[left] < offsets[right] + requirements[right].size &&
+             offsets[right] < offsets[left] + requirements[left].size;
+    };
+    for (std::uint32_t i : by_size)
+    {
+      std::vector<VkDeviceSize> candidates = {0};
+      for (std::uint32_t other : placed)
+      {
+        if (lifetimes_overlap(i, other))
+        {
+          candidates.push_back(AlignUp(offsets[other] + requirements[other].size, requirements[i].alignment));
+        }
+      }
+      std::sort(candidates.begin(), candidates.end());
+      for (VkDeviceSize candidate : candidates)
+      {
+        offsets[i] = candidate;
+        const bool fits = std::none_of(
+            placed.begin(), placed.end(),
+            [&](std::uint32_t other)
+            {
+              return lifetimes_overlap(i, other) && memory_overlaps(i, other);
+            });
+        if (fits)
+        {
+          break;
+        }
+      }
+      placed.push_back(i);
+      heap_requirements.size = std::max(heap_requirements.size, offsets[i] + requirements[i].size);
+      stats_.unaliased_bytes_ += requirements[i].size;
+    }
+    stats_.transient_image_count_ = static_cast<std::uint32_t>(transients.size());
+    stats_.transient_bytes_ = heap_requirements.size;
+
+    // The later image in a shared range waits on the earlier one's accesses before it takes over the memory
+    for (std::uint32_t i = 0; i < transients.size(); i++)
+    {
+      for (std::uint32_t other = 0; other < transients.size(); other++)
+      {
+        if (!lifetimes_overlap(i, other) && memory_overlaps(i, other) &&
+            resources_[transients[other]].last_pass_ < resources_[transients[i]].first_pass_)
+        {
+          aliased_[transients[i]].push_back(transients[other]);
+        }
+      }
+    }
+
+    // The slot's previous frame has retired, its images can be replaced right away when the placement changed
+    TransientHeap& heap = heaps_[frame_index];
+    std::vector<TransientImageDescription> descriptions;
+    for (RenderResource transient : transients)
+    {
+      descriptions.push_back(*resources_[transient].transient_);
+    }
+    if (descriptions != heap.descriptions_ || offsets != heap.offsets_ ||
+        (heap.allocation_.IsValid() && heap.allocation_.size_ < heap_requirements.size))
+    {
+      DestroyHeap(heap);
+      if (!transients.empty())
+      {
+        heap.allocation_ = allocator_.Allocate(heap_requirements, MemoryUsage::kGpuOnly, ResourceKind::kImage);
+        if (!heap.allocation_.IsValid())
+        {
+          SPDLOG_ERROR("Failed to allocate {} bytes for the transient images", heap_requirements.size);
+          throw std::runtime_error("Failed to allocate the transient images!");
+        }
+      }
+      for (std::uint32_t i = 0; i < transients.size(); i++)
+      {
+        const VkImageCreateInfo image_info = GetImageInfo(descriptions[i]);
+        VkImage image = VK_NULL_HANDLE;
+        if (vkCreateImage(device_, &image_info, VK_NULL_HANDLE, &image) != VK_SUCCESS)
+        {
+          SPDLOG_ERROR("Failed creating a transient image of {}x{}", image_info.extent.width, image_info.extent.height);
+          throw std::runtime_error("Failed to create a transient image!");
+        }
+        heap.images_.push_back(image);
+        vkBindImageMemory(device_, image, heap.allocation_.memory_, heap.allocation_.offset_ + offsets[i]);
+
+        VkImageViewCreateInfo view_info = NULL_STRUCT;
+        view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        view_info.image = image;
+        view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.format = descriptions[i].format_;
+        view_info.subresourceRange = {descriptions[i].aspect_, 0, 1, 0, 1};
+        VkImageView view = VK_NULL_HANDLE;
+        if (vkCreateImageView(device_, &view_info, VK_NULL_HANDLE, &view) != VK_SUCCESS)
+        {
+          SPDLOG_ERROR("Failed creating a transient image view");
+          throw std::runtime_error("Failed to create a transient image view!");
+        }
+        heap.views_.push_back(view);
+      }
+      heap.descriptions_ = std::move(descriptions);
+      heap.offsets_ = offsets;
+      SPDLOG_DEBUG(
+          "Placed {} transient images in {} bytes, {} without aliasing", transients.size(), stats_.transient_bytes_,
+          stats_.unaliased_bytes_);
+    }
+
+    for (std::uint32_t i = 0; i < transients.size(); i++)
+    {
+      resources_[transients[i]].image_ = heap.images_[i];
+      resources_[transients[i]].view_ = heap.views_[i];
+    }
+  }
+
+  std::vector<std::pair<RenderResource, RenderGraph::Use>> RenderGraph::MergeAccesses(const Pass& pass) const
+  {
+    std::vector<std::pair<RenderResource, Use>> uses;
+    for (const ResourceAccess& access : pass.accesses_)
+    {
+      const UsageInfo info = Describe(access.usage_);
+      auto it = std::find_if(
+          uses.begin(), uses.end(),
+          [&access](const std::pair<RenderResource, Use>& use)
+          {
+            return use.first == access.resource_;
+          });
+      if (it == uses.end())
+      {
+        uses.push_back({access.resource_, Use{info.stages_, info.access_, info.layout_, info.reads_, info.writes_}});
+        continue;
+      }
+      // An image has one layout for the whole pass, the pass orders its own accesses to it
+      Use& use = it->second;
+      const bool is_image = resources_[access.resource_].buffer_ == VK_NULL_HANDLE;
+      if (is_image && use.layout_ != info.layout_)
+      {
+        SPDLOG_ERROR("The pass {} uses an image in two layouts", pass.name_);
+        throw std::runtime_error("Render graph pass uses an image in two layouts!");
+      }
+      use.stages_ |= info.stages_;
+      use.access_ |= info.access_;
+      use.reads_ |= info.reads_;
+      use.writes_ |= info.writes_;
+    }
+    return uses;
+  }
+
+  void RenderGraph::AddBarrier(
+      RenderResource resource_index, const Use& use, VkMemoryBarrier2& memory_barrier,
+      std::vector<VkImageMemoryBarrier2>& image_barriers)
+  {
+    Resource& resource = resources_[resource_index];
+    ResourceState& state = resource.state_;
+    const bool is_image = resource.image_ != VK_NULL_HANDLE;
+
+    // A transient image's first use waits on the images that used its memory before it
+    auto aliased_it = aliased_.find(resource_index);
+    if (aliased_it != aliased_.end())
+    {
+      for (RenderResource previous : aliased_it->second)
+      {
+        const ResourceState& previous_state = resources_[previous].state_;
+        state.write_stages_ |= previous_state.write_stages_ | previous_state.read_stages_;
+        state.write_access_ |= previous_state.write_access_;
+      }
+      aliased_.erase(aliased_it);
+    }
+
+    VkPipelineStageFlags2 src_stages = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 src_access = VK_ACCESS_2_NONE;
+    const bool transition = is_image && state.layout_ != use.layout_;
+    if (use.writes_ || transition)
+    {
+      // Writes wait on every earlier access, reads only need the execution dependency
+      src_stages = state.write_stages_ | state.read_stages_;
+      src_access = state.write_access_;
+    }
+    else if (state.write_stages_ != VK_PIPELINE_STAGE_2_NONE &&
+             ((use.stages_ & ~state.visible_stages_) != 0 || (use.access_ & ~state.visible_access_) != 0))
+    {
+      // Reads after reads of the same write share its barrier
+      src_stages = state.write_stages_;
+      src_access = state.write_access_;
+    }
+    else
+    {
+      state.read_stages_ |= use.stages_;
+      return;
+    }
+
+    if (transition)
+    {
+      VkImageMemoryBarrier2 barrier = NULL_STRUCT;
+      barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+      barrier.srcStageMask = src_stages;
+      barrier.srcAccessMask = src_access;
+      barrier.dstStageMask = use.stages_;
+      barrier.dstAccessMask = use.access_;
+      barrier.oldLayout = state.layout_;
+      barrier.newLayout = use.layout_;
+      barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.image = resource.image_;
+      barrier.subresourceRange = {resource.aspect_, 0, 1, 0, 1};
+      image_barriers.push_back(barrier);
+    }
+    else if (src_stages != VK_PIPELINE_STAGE_2_NONE)
+    {
+      // Buffers and images that keep their layout share one global barrier per batch
+      memory_barrier.srcStageMask |= src_stages;
+      memory_barrier.srcAccessMask |= src_access;
+      memory_barrier.dstStageMask |= use.stages_;
+      memory_barrier.dstAccessMask |= use.access_;
+    }
+
+    if (use.writes_)
+    {
+      state.write_stages_ = use.stages_;
+      state.write_access_ = use.access_;
+      state.read_stages_ = VK_PIPELINE_STAGE_2_NONE;
+      state.visible_stages_ = VK_PIPELINE_STAGE_2_NONE;
+      state.visible_access_ = VK_ACCESS_2_NONE;
+    }
+    else if (transition)
+    {
+      // The transition is the last write, later readers chain onto it
+      state.write_stages_ = use.stages_;
+      state.write_access_ = VK_ACCESS_2_NONE;
+      state.read_stages_ = use.stages_;
+      state.visible_stages_ = use.stages_;
+      state.visible_access_ = use.access_;
+    }
+    else
+    {
+      state.read_stages_ |= use.stages_;
+      state.visible_stages_ |= use.stages_;
+      state.visible_access_ |= use.access_;
+    }
+    if (is_image)
+    {
+      state.layout_ = use.layout_;
+    }
+  }
+
+  static void RecordBarriers(
+      VkCommandBuffer command_buffer, const VkMemoryBarrier2& memory_barrier,
+      gsl::span<const VkImageMemoryBarrier2> image_barriers, std::uint32_t& batch_count)
+  {
+    const bool has_memory_barrier = memory_barrier.srcStageMask != VK_PIPELINE_STAGE_2_NONE;
+    if (!has_memory_barrier && image_barriers.empty())
+    {
+      return;
+    }
+    VkDependencyInfo dependency_info = NULL_STRUCT;
+    dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependency_info.memoryBarrierCount = has_memory_barrier ? 1 : 0;
+    dependency_info.pMemoryBarriers = &memory_barrier;
+    dependency_info.imageMemoryBarrierCount = static_cast<std::uint32_t>(image_barriers.size());
+    dependency_info.pImageMemoryBarriers = image_barriers.data();
+    vkCmdPipelineBarrier2(command_buffer, &dependency_info);
+    batch_count++;
+  }
+
+  void RenderGraph::Execute(VkCommandBuffer command_buffer, std::uint32_t frame_index)
+  {
+    ZoneScoped;
+    stats_ = NULL_STRUCT;
+    const std::vector<std::uint32_t> running = Cull();
+    stats_.pass_count_ = static_cast<std::uint32_t>(running.size());
+    stats_.culled_pass_count_ = static_cast<std::uint32_t>(passes_.size() - running.size());
+    PlaceTransientImages(running, frame_index);
+
+    std::vector<VkImageMemoryBarrier2> image_barriers;
+    for (std::uint32_t pass_index : running)
+    {
+      const Pass& pass = passes_[pass_index];
+      VkMemoryBarrier2 memory_barrier = NULL_STRUCT;
+      memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+      image_barriers.clear();
+      for (const auto& [resource, use] : MergeAccesses(pass))
+      {
+        AddBarrier(resource, use, memory_barrier, image_barriers);
+      }
+      RecordBarriers(command_buffer, memory_barrier, image_barriers, stats_.barrier_batch_count_);
+
+      ZoneScopedN("Record pass");
+      ZoneText(pass.name_, std::strlen(pass.name_));
+      pass.record_(command_buffer);
+    }
+
+    // Imported images are left in the layout their next user expects. The submit must signal at ALL_COMMANDS, the
+    // transitions' second scope, for its semaphore to wait for them.
+    image_barriers.clear();
+    for (Resource& resource : resources_)
+    {
+      if (resource.transient_.has_value() || resource.image_ == VK_NULL_HANDLE ||
+          resource.final_layout_ == VK_IMAGE_LAYOUT_UNDEFINED || resource.final_layout_ == resource.state_.layout_)
+      {
+        continue;
+      }
+      VkImageMemoryBarrier2 barrier = NULL_STRUCT;
+      barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+      barrier.srcStageMask = resource.state_.write_stages_ | resource.state_.read_stages_;
+      barrier.srcAccessMask = resource.state_.write_access_;
+      barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+      barrier.dstAccessMask = VK_ACCESS_2_NONE;
+      barrier.oldLayout = resource.state_.layout_;
+      barrier.newLayout = resource.final_layout_;
+      barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.image = resource.image_;
+      barrier.subresourceRange = {resource.aspect_, 0, 1, 0, 1};
+      image_barriers.push_back(barrier);
+    }
+    VkMemoryBarrier2 no_memory_barrier = NULL_STRUCT;
+    no_memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    RecordBarriers(command_buffer, no_memory_barrier, image_barriers, stats_.barrier_batch_count_);
+
+    resources_.clear();
+    passes_.clear();
+    aliased_.clear();
+  }
+}  // namespace veng
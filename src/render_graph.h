@@ -0,0 +1,163 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <gpu_allocator.h>
+
+namespace veng
+{
+  using RenderResource = std::uint32_t;
+
+  // How a pass uses a resource, each implies the stages, accesses and image layout its barriers need
+  enum class ResourceUsage
+  {
+    kColorAttachment,  // Written, the previous contents are cleared or overwritten
+    kDepthAttachment,  // Tested and written
+    kDepthRead,  // Tested only, kept in the attachment layout so a depth prepass needs no transition
+    kSampled,  // Sampled by fragment or compute shaders
+    kStorageRead,  // Read by vertex, fragment or compute shaders
+    kStorageWrite,  // Read and written by compute shaders
+    kIndirectRead,  // Indirect draw commands and counts
+    kTransferRead,
+    kTransferWrite
+  };
+
+  struct ResourceAccess
+  {
+    RenderResource resource_ = 0;
+    ResourceUsage usage_ = ResourceUsage::kSampled;
+  };
+
+  // An image owned by the graph whose contents do not outlive the frame
+  struct TransientImageDescription
+  {
+    VkFormat format_ = VK_FORMAT_UNDEFINED;
+    VkExtent2D extent_ = NULL_STRUCT;
+    VkImageUsageFlags usage_ = 0;
+    VkImageAspectFlags aspect_ = VK_IMAGE_ASPECT_COLOR_BIT;
+
+    bool operator==(const TransientImageDescription& other) const
+    {
+      return format_ == other.format_ && extent_.width == other.extent_.width &&
+             extent_.height == other.extent_.height && usage_ == other.usage_ && aspect_ == other.aspect_;
+    };
+  };
+
+  // Of the latest Execute()
+  struct RenderGraphStats
+  {
+    std::uint32_t pass_count_ = 0;
+    std::uint32_t culled_pass_count_ = 0;
+    std::uint32_t barrier_batch_count_ = 0;  // vkCmdPipelineBarrier2 calls, at most one per pass plus one at the end
+    std::uint32_t transient_image_count_ = 0;
+    VkDeviceSize transient_bytes_ = 0;  // Memory the transient images share
+    VkDeviceSize unaliased_bytes_ = 0;  // What they would take with memory of their own
+  };
+
+  // Rebuilt every frame: passes declare the resources they read and write, then Execute() culls the passes nothing
+  // uses, batches the barriers each pass needs in front of it and places the transient images so that those whose
+  // lifetimes do not overlap share memory. Render thread only.
+  class RenderGraph
+  {
+   public:
+    RenderGraph(VkDevice device, GpuAllocator& allocator, std::uint32_t frames_in_flight);
+    // The device must be idle
+    ~RenderGraph();
+
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    // An image the graph does not own, e.g. the swapchain image. It is made available in initial_layout at
+    // initial_stage, where the acquire semaphore is waited on for instance, and left in final_layout.
+    RenderResource ImportImage(
+        VkImage image, VkImageView view, VkImageAspectFlags aspect, VkImageLayout initial_layout,
+        VkPipelineStageFlags2 initial_stage, VkImageLayout final_layout);
+    // last_stage and last_access are the buffer's last use before the graph, e.g. by the previous frame
+    RenderResource ImportBuffer(VkBuffer buffer, VkPipelineStageFlags2 last_stage, VkAccessFlags2 last_access);
+    // Its contents are undefined when its first pass begins
+    RenderResource CreateImage(const TransientImageDescription& description);
+
+    // Passes run in the order they are added. A pass is culled unless it writes an imported resource or something a
+    // later pass that runs reads. The name must outlive the frame, string literals are meant.
+    void AddPass(gsl::czstring name, std::vector<ResourceAccess> accesses, std::function<void(VkCommandBuffer)> record);
+
+    // Valid inside the passes' record functions
+    VkImage GetImage(RenderResource image) const;
+    VkImageView GetImageView(RenderResource image) const;
+
+    // Records the passes that survive culling with their barriers into command_buffer, then clears the graph for
+    // the next frame. The transient images of frame_index must no longer be in use by the GPU.
+    void Execute(VkCommandBuffer command_buffer, std::uint32_t frame_index);
+
+    const RenderGraphStats& GetStats() const { return stats_; };
+
+   private:
+    // What has touched a resource so far in the frame
+    struct ResourceState
+    {
+      VkImageLayout layout_ = VK_IMAGE_LAYOUT_UNDEFINED;
+      VkPipelineStageFlags2 write_stages_ = VK_PIPELINE_STAGE_2_NONE;
+      VkAccessFlags2 write_access_ = VK_ACCESS_2_NONE;
+      VkPipelineStageFlags2 read_stages_ = VK_PIPELINE_STAGE_2_NONE;  // Since the last write
+      // The accesses the last write was already made visible to
+      VkPipelineStageFlags2 visible_stages_ = VK_PIPELINE_STAGE_2_NONE;
+      VkAccessFlags2 visible_access_ = VK_ACCESS_2_NONE;
+    };
+    struct Resource
+    {
+      VkImage image_ = VK_NULL_HANDLE;
+      VkImageView view_ = VK_NULL_HANDLE;
+      VkImageAspectFlags aspect_ = 0;
+      VkBuffer buffer_ = VK_NULL_HANDLE;
+      std::optional<TransientImageDescription> transient_ = std::nullopt;
+      VkImageLayout final_layout_ = VK_IMAGE_LAYOUT_UNDEFINED;
+      ResourceState state_ = NULL_STRUCT;
+      // First and last of the running passes that use it
+      std::uint32_t first_pass_ = std::numeric_limits<std::uint32_t>::max();
+      std::uint32_t last_pass_ = 0;
+    };
+    struct Pass
+    {
+      gsl::czstring name_ = nullptr;
+      std::vector<ResourceAccess> accesses_;
+      std::function<void(VkCommandBuffer)> record_;
+    };
+    // The transient images of one frame slot and the memory they share, kept while the frames place them alike
+    struct TransientHeap
+    {
+      std::vector<TransientImageDescription> descriptions_;
+      std::vector<VkDeviceSize> offsets_;
+      std::vector<VkImage> images_;
+      std::vector<VkImageView> views_;
+      Allocation allocation_ = NULL_STRUCT;
+    };
+    // A resource's accesses in one pass, merged
+    struct Use
+    {
+      VkPipelineStageFlags2 stages_ = VK_PIPELINE_STAGE_2_NONE;
+      VkAccessFlags2 access_ = VK_ACCESS_2_NONE;
+      VkImageLayout layout_ = VK_IMAGE_LAYOUT_UNDEFINED;
+      bool reads_ = false;
+      bool writes_ = false;
+    };
+
+    // Marks the passes to run, back to front from the ones writing imported resources
+    std::vector<std::uint32_t> Cull() const;
+    void PlaceTransientImages(gsl::span<const std::uint32_t> passes, std::uint32_t frame_index);
+    void DestroyHeap(TransientHeap& heap);
+    std::vector<std::pair<RenderResource, Use>> MergeAccesses(const Pass& pass) const;
+    // Appends the barrier resource needs before use, if any, and updates its state
+    void AddBarrier(
+        RenderResource resource, const Use& use, VkMemoryBarrier2& memory_barrier,
+        std::vector<VkImageMemoryBarrier2>& image_barriers);
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    GpuAllocator& allocator_;
+    std::vector<TransientHeap> heaps_;  // One per frame in flight
+
+    std::vector<Resource> resources_;
+    std::vector<Pass> passes_;
+    // Transient images mapped to the earlier ones of the frame whose memory they take over
+    std::unordered_map<RenderResource, std::vector<RenderResource>> aliased_;
+    RenderGraphStats stats_ = NULL_STRUCT;
+  };
+}  // namespace veng
@@ -0,0 +1,93 @@
+#include <render_queue.h>
+
+namespace veng
+{
+  static_assert(
+      RenderQueue::kPassBits + RenderQueue::kPipelineBits + RenderQueue::kMaterialBits + RenderQueue::kMeshBits +
+          RenderQueue::kDepthBits ==
+      64);
+
+  SortKey RenderQueue::MakeKey(
+      std::uint32_t pass, std::uint32_t pipeline, std::uint32_t material, std::uint32_t mesh, float depth)
+  {
+    auto field = [](std::uint64_t value, std::uint32_t bits)
+    {
+      return value & ((1ull << bits) - 1);
+    };
+    const float max_depth = static_cast<float>((1u << kDepthBits) - 1);
+    const std::uint64_t quantized_depth = static_cast<std::uint64_t>(std::clamp(depth, 0.0f, 1.0f) * max_depth);
+
+    SortKey key = field(pass, kPassBits);
+    key = (key << kPipelineBits) | field(pipeline, kPipelineBits);
+    key = (key << kMaterialBits) | field(material, kMaterialBits);
+    key = (key << kMeshBits) | field(mesh, kMeshBits);
+    key = (key << kDepthBits) | quantized_depth;
+    return key;
+  }
+
+  void RenderQueue::Sort()
+  {
+    ZoneScoped;
+    // Below this a comparison sort wins over eight histogram passes
+    constexpr std::size_t kRadixThreshold = 256;
+    if (entries_.size() < kRadixThreshold)
+    {
+      std::stable_sort(
+          entries_.begin(), entries_.end(),
+          [](const SortEntry& left, const SortEntry& right)
+          {
+            return left.key_ < right.key_;
+          });
+      return;
+    }
+
+    constexpr std::uint32_t kDigitBits = 8;
+    constexpr std::uint32_t kBucketCount = 1 << kDigitBits;
+    constexpr std::uint32_t kPassCount = sizeof(SortKey) * 8 / kDigitBits;
+
+    // Every digit's histogram in a single read of the keys
+    std::array<std::array<std::uint32_t, kBucketCount>, kPassCount> histograms = NULL_STRUCT;
+    for (const SortEntry& entry : entries_)
+    {
+      for (std::uint32_t pass = 0; pass < kPassCount; pass++)
+      {
+        histograms[pass][(entry.key_ >> (pass * kDigitBits)) & (kBucketCount - 1)]++;
+      }
+    }
+
+    scratch_.resize(entries_.size());
+    SortEntry* source = entries_.data();
+    SortEntry* destination = scratch_.data();
+    const std::uint32_t count = static_cast<std::uint32_t>(entries_.size());
+    for (std::uint32_t pass = 0; pass < kPassCount; pass++)
+    {
+      const std::uint32_t shift = pass * kDigitBits;
+      std::array<std::uint32_t, kBucketCount>& histogram = histograms[pass];
+      // All keys share this digit, the pass would leave them in place. Common for the high fields.
+      if (histogram[(source[0].key_ >> shift) & (kBucketCount - 1)] == count)
+      {
+        continue;
+      }
+
+      // Histogram to exclusive prefix sums: where each bucket starts
+      std::uint32_t offset = 0;
+      for (std::uint32_t& bucket : histogram)
+      {
+        const std::uint32_t bucket_count = bucket;
+        bucket = offset;
+        offset += bucket_count;
+      }
+      // Front to back keeps the pass stable
+      for (std::uint32_t i = 0; i < count; i++)
+      {
+        destination[histogram[(source[i].key_ >> shift) & (kBucketCount - 1)]++] = source[i];
+      }
+      std::swap(source, destination);
+    }
+
+    if (source != entries_.data())
+    {
+      entries_.swap(scratch_);
+    }
+  }
+}  // namespace veng
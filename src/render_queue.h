@@ -0,0 +1,43 @@
+#pragma once
+
+namespace veng
+{
+  using SortKey = std::uint64_t;
+
+  // A submission's key and its index in the caller's command list
+  struct SortEntry
+  {
+    SortKey key_ = 0;
+    std::uint32_t index_ = 0;
+  };
+
+  // Orders a frame's submissions by 64-bit keys so that replaying them changes state as rarely as possible. The key
+  // packs, most significant first: pass, pipeline, material, mesh, then depth, so draws sharing a pipeline end up
+  // together, within it those sharing a material, and so on. Sorting is an LSD radix sort over the key bytes.
+  class RenderQueue
+  {
+   public:
+    // Field widths in bits, from the top of the key. Larger values wrap, which only costs some grouping.
+    static constexpr std::uint32_t kPassBits = 4;
+    static constexpr std::uint32_t kPipelineBits = 10;
+    static constexpr std::uint32_t kMaterialBits = 18;
+    static constexpr std::uint32_t kMeshBits = 16;
+    static constexpr std::uint32_t kDepthBits = 16;
+
+    // depth is clamped to [0, 1], smaller sorts first
+    static SortKey MakeKey(
+        std::uint32_t pass, std::uint32_t pipeline, std::uint32_t material, std::uint32_t mesh, float depth);
+
+    void Push(SortKey key, std::uint32_t index) { entries_.push_back(SortEntry{key, index}); };
+    // Ties keep the order they were pushed in
+    void Sort();
+    void Clear() { entries_.clear(); };
+    void Reserve(std::size_t count) { entries_.reserve(count); };
+
+    gsl::span<const SortEntry> GetEntries() const { return entries_; };
+
+   private:
+    std::vector<SortEntry> entries_;
+    std::vector<SortEntry> scratch_;  // Kept between frames, the sort ping-pongs between both
+  };
+}  // namespace veng
@@ -0,0 +1,116 @@
+#include <shader_archive.h>
+
+namespace veng
+{
+  static std::string_view GetName(const ShaderArchiveEntry& entry)
+  {
+    return std::string_view(entry.name_.data(), strnlen(entry.name_.data(), entry.name_.size()));
+  }
+
+  std::optional<ShaderArchive> ShaderArchive::Open(const std::filesystem::path& path)
+  {
+    ZoneScoped;
+    std::optional<MappedFile> mapped = MappedFile::Open(path);
+    if (!mapped.has_value())
+    {
+      return std::nullopt;
+    }
+
+    ShaderArchive archive(std::move(*mapped));
+    gsl::span<const std::uint8_t> bytes = archive.file_.GetBytes();
+    if (bytes.size() < sizeof(ShaderArchiveHeader))
+    {
+      SPDLOG_ERROR("{} is too small to be a shader archive", path.string());
+      return std::nullopt;
+    }
+    const ShaderArchiveHeader& header = *reinterpret_cast<const ShaderArchiveHeader*>(bytes.data());
+    if (header.magic_ != kShaderArchiveMagic || header.version_ != kShaderArchiveVersion)
+    {
+      SPDLOG_ERROR("{} is not a version {} shader archive", path.string(), kShaderArchiveVersion);
+      return std::nullopt;
+    }
+
+    const std::uint64_t entries_end = sizeof(ShaderArchiveHeader) + header.shader_count_ * sizeof(ShaderArchiveEntry);
+    if (entries_end > bytes.size())
+    {
+      SPDLOG_ERROR("{} is truncated", path.string());
+      return std::nullopt;
+    }
+    archive.entries_ = {
+        reinterpret_cast<const ShaderArchiveEntry*>(bytes.data() + sizeof(ShaderArchiveHeader)), header.shader_count_};
+    for (const ShaderArchiveEntry& entry : archive.entries_)
+    {
+      // SPIR-V is read in words, the code must be whole words at a word boundary
+      if (entry.offset_ % kShaderArchiveAlignment != 0 || entry.size_ % sizeof(std::uint32_t) != 0 ||
+          entry.offset_ > bytes.size() || entry.size_ > bytes.size() - entry.offset_)
+      {
+        SPDLOG_ERROR("{} has a corrupt entry for {}", path.string(), GetName(entry));
+        return std::nullopt;
+      }
+    }
+    return archive;
+  }
+
+  std::optional<ArchivedShader> ShaderArchive::Find(std::string_view name) const
+  {
+    auto it = std::lower_bound(
+        entries_.begin(), entries_.end(), name,
+        [](const ShaderArchiveEntry& entry, std::string_view name)
+        {
+          return GetName(entry) < name;
+        });
+    if (it == entries_.end() || GetName(*it) != name)
+    {
+      return std::nullopt;
+    }
+    const std::uint8_t* code = file_.GetBytes().data() + it->offset_;
+    return ArchivedShader{
+        {reinterpret_cast<const std::uint32_t*>(code), it->size_ / sizeof(std::uint32_t)}, it->hash_};
+  }
+
+  bool WriteShaderArchive(const std::filesystem::path& path, std::vector<PackedShader> shaders)
+  {
+    std::sort(
+        shaders.begin(), shaders.end(),
+        [](const PackedShader& left, const PackedShader& right)
+        {
+          return left.name_ < right.name_;
+        });
+
+    ShaderArchiveHeader header;
+    header.shader_count_ = static_cast<std::uint32_t>(shaders.size());
+    std::vector<ShaderArchiveEntry> entries(shaders.size());
+    std::uint64_t offset =
+        AlignUp(sizeof(ShaderArchiveHeader) + entries.size() * sizeof(ShaderArchiveEntry), kShaderArchiveAlignment);
+    for (std::size_t i = 0; i < shaders.size(); i++)
+    {
+      if (shaders[i].name_.size() >= kShaderNameSize)
+      {
+        SPDLOG_ERROR("The shader name {} is longer than {} characters", shaders[i].name_, kShaderNameSize - 1);
+        return false;
+      }
+      std::copy(shaders[i].name_.begin(), shaders[i].name_.end(), entries[i].name_.begin());
+      entries[i].offset_ = offset;
+      entries[i].size_ = shaders[i].code_.size();
+      entries[i].hash_ = HashBytes(shaders[i].code_);
+      offset = AlignUp(offset + entries[i].size_, kShaderArchiveAlignment);
+    }
+
+    std::vector<std::uint8_t> bytes(offset);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    std::memcpy(bytes.data() + sizeof(header), entries.data(), entries.size() * sizeof(ShaderArchiveEntry));
+    for (std::size_t i = 0; i < shaders.size(); i++)
+    {
+      std::memcpy(bytes.data() + entries[i].offset_, shaders[i].code_.data(), shaders[i].code_.size());
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!file.good())
+    {
+      SPDLOG_ERROR("Failed to write the shader archive {}", path.string());
+      return false;
+    }
+    return true;
+  }
+}  // namespace veng
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <mapped_file.h>
+
+namespace veng
+{
+  // Every compiled shader in one file, packed at build time by ShaderPacker and mapped as is at startup. Little
+  // endian, the code of each shader starts at a multiple of kShaderArchiveAlignment:
+  //   ShaderArchiveHeader | ShaderArchiveEntry[shader_count_], sorted by name | SPIR-V...
+  constexpr std::array<char, 4> kShaderArchiveMagic = {'V', 'S', 'H', 'A'};
+  constexpr std::uint32_t kShaderArchiveVersion = 1;
+  constexpr std::uint64_t kShaderArchiveAlignment = 16;
+  constexpr std::size_t kShaderNameSize = 48;
+
+  struct ShaderArchiveHeader
+  {
+    std::array<char, 4> magic_ = kShaderArchiveMagic;
+    std::uint32_t version_ = kShaderArchiveVersion;
+    std::uint32_t shader_count_ = 0;
+    std::uint32_t padding_ = 0;
+  };
+
+  struct ShaderArchiveEntry
+  {
+    std::array<char, kShaderNameSize> name_ = NULL_STRUCT;  // "basic.vert", null terminated
+    std::uint64_t offset_ = 0;
+    std::uint64_t size_ = 0;
+    std::uint64_t hash_ = 0;  // HashBytes() of the code, computed when packing
+    std::uint64_t padding_ = 0;
+  };
+
+  // A shader's code inside the mapping, valid as long as the archive
+  struct ArchivedShader
+  {
+    gsl::span<const std::uint32_t> code_;
+    std::uint64_t hash_ = 0;
+  };
+
+  class ShaderArchive
+  {
+   public:
+    // Validates the header and the entries against the file size, std::nullopt when anything is off
+    static std::optional<ShaderArchive> Open(const std::filesystem::path& path);
+
+    // Binary search over the sorted entries, std::nullopt for unknown names
+    std::optional<ArchivedShader> Find(std::string_view name) const;
+
+   private:
+    explicit ShaderArchive(MappedFile file) : file_(std::move(file)) {};
+
+    MappedFile file_;
+    gsl::span<const ShaderArchiveEntry> entries_;
+  };
+
+  struct PackedShader
+  {
+    std::string name_;
+    std::vector<std::uint8_t> code_;
+  };
+
+  // Writes an archive of the given shaders, sorting them by name
+  bool WriteShaderArchive(const std::filesystem::path& path, std::vector<PackedShader> shaders);
+}  // namespace veng
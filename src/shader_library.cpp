@@ -0,0 +1,103 @@
+#include <shader_library.h>
+
+namespace veng
+{
+  ShaderLibrary::ShaderLibrary(VkDevice device, const std::filesystem::path& archive_path) :
+      device_(device), archive_(ShaderArchive::Open(archive_path))
+  {
+    if (!archive_.has_value())
+    {
+      SPDLOG_WARN("No shader archive at {}, loading the shaders one file at a time", archive_path.string());
+    }
+  }
+
+  ShaderLibrary::~ShaderLibrary()
+  {
+    for (auto& [name, shader] : shaders_)
+    {
+      vkDestroyShaderModule(device_, shader.module_, VK_NULL_HANDLE);
+    }
+  }
+
+  VkShaderModule ShaderLibrary::CreateShaderModule(gsl::span<const std::uint8_t> buffer)
+  {
+    if (buffer.empty())
+    {
+      return VK_NULL_HANDLE;
+    }
+
+    VkShaderModuleCreateInfo info = NULL_STRUCT;
+    info.sType = VkStructureType::VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    info.codeSize = buffer.size();
+    info.pCode = reinterpret_cast<const std::uint32_t*>(buffer.data());
+
+    VkShaderModule shader_module;
+
+    VkResult result = vkCreateShaderModule(device_, &info, VK_NULL_HANDLE, &shader_module);
+    if (result != VK_SUCCESS)
+    {
+      return VK_NULL_HANDLE;
+    }
+
+    return shader_module;
+  }
+
+  VkShaderModule ShaderLibrary::GetModule(const std::string& name)
+  {
+    auto it = shaders_.find(name);
+    if (it != shaders_.end())
+    {
+      return it->second.module_;
+    }
+
+    // The archive's code is word aligned in the mapping, the driver reads it in place
+    if (archive_.has_value())
+    {
+      if (std::optional<ArchivedShader> archived = archive_->Find(name))
+      {
+        VkShaderModule module = CreateShaderModule(gsl::span<const std::uint8_t>(
+            reinterpret_cast<const std::uint8_t*>(archived->code_.data()), archived->code_.size_bytes()));
+        if (module == VK_NULL_HANDLE)
+        {
+          SPDLOG_ERROR("Failed loading the shader {} from the archive", name);
+          return VK_NULL_HANDLE;
+        }
+        shaders_.emplace(name, Shader{module, archived->hash_});
+        return module;
+      }
+    }
+
+    std::vector<std::uint8_t> code = ReadFile("./" + name + ".spv");
+    VkShaderModule module = CreateShaderModule(code);
+    if (module == VK_NULL_HANDLE)
+    {
+      SPDLOG_ERROR("Failed loading the shader {}", name);
+      return VK_NULL_HANDLE;
+    }
+
+    shaders_.emplace(name, Shader{module, HashBytes(code)});
+    return module;
+  }
+
+  std::optional<VkShaderModule> ShaderLibrary::Reload(const std::string& name)
+  {
+    std::vector<std::uint8_t> code = ReadFile("./" + name + ".spv");
+    VkShaderModule module = CreateShaderModule(code);
+    if (module == VK_NULL_HANDLE)
+    {
+      SPDLOG_ERROR("Failed reloading the shader {}", name);
+      return std::nullopt;
+    }
+
+    Shader& shader = shaders_[name];
+    const VkShaderModule replaced = std::exchange(shader.module_, module);
+    shader.hash_ = HashBytes(code);
+    return replaced;
+  }
+
+  std::uint64_t ShaderLibrary::GetHash(const std::string& name) const
+  {
+    auto it = shaders_.find(name);
+    return it != shaders_.end() ? it->second.hash_ : 0;
+  }
+}  // namespace veng
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <shader_archive.h>
+
+namespace veng
+{
+  // Owns the shader modules, loaded once by name ("basic.vert") straight from the mapped shader archive. Shaders
+  // missing from it, or every shader without an archive, are read from their ".spv" next to the executable.
+  class ShaderLibrary
+  {
+   public:
+    ShaderLibrary(VkDevice device, const std::filesystem::path& archive_path);
+    ~ShaderLibrary();
+
+    ShaderLibrary(const ShaderLibrary&) = delete;
+    ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
+    // Returns VK_NULL_HANDLE if the shader could not be loaded
+    VkShaderModule GetModule(const std::string& name);
+    // Loads the ".spv" again after it was recompiled and returns the module it replaces, VK_NULL_HANDLE if the shader
+    // was not loaded yet. The caller destroys it once no pipeline compile uses it anymore. std::nullopt, keeping the
+    // current module, when the new one fails to load.
+    std::optional<VkShaderModule> Reload(const std::string& name);
+    // Hash of the SPIR-V the module was created from, 0 for unknown shaders
+    std::uint64_t GetHash(const std::string& name) const;
+
+   private:
+    struct Shader
+    {
+      VkShaderModule module_ = VK_NULL_HANDLE;
+      std::uint64_t hash_ = 0;
+    };
+
+    VkShaderModule CreateShaderModule(gsl::span<const std::uint8_t> buffer);
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    std::optional<ShaderArchive> archive_;
+    std::unordered_map<std::string, Shader> shaders_;
+  };
+}  // namespace veng
@@ -0,0 +1,70 @@
+#pragma once
+
+namespace veng
+{
+  // CPU side of the blocks declared in shaders/common.glsl, std140 layout
+
+  // Set 0, binding 0: pushed once per frame
+  struct FrameUniforms
+  {
+    glm::mat4 view_projection_ = glm::mat4(1.0f);
+    // World-space planes (xyz normal pointing inwards, w distance): left, right, bottom, top, near, far. All zero,
+    // culling nothing, until Graphics::SetViewProjection().
+    std::array<glm::vec4, 6> frustum_planes_ = NULL_STRUCT;
+  };
+
+  // Set 0, binding 1: pushed per draw
+  struct DrawUniforms
+  {
+    glm::mat4 model_ = glm::mat4(1.0f);
+  };
+
+  // Push constants: indices into the bindless table (set 1)
+  struct DrawPushConstants
+  {
+    std::uint32_t texture_index_ = 0;
+    std::uint32_t sampler_index_ = 0;
+    std::uint32_t buffer_index_ = 0;
+    // Instanced draws: buffer_index_ is the frame's instance buffer, sized for this many instances per stream
+    std::uint32_t instance_capacity_ = 0;
+
+    bool operator==(const DrawPushConstants&) const = default;
+  };
+
+  // Instanced draws: per-instance streams, stored back to back in the frame's instance buffer
+  using InstanceTransform = glm::mat4;  // std430 mat4
+  using InstanceColor = glm::vec4;  // std430 vec4, only rgb is used
+  using InstanceMaterial = std::uint32_t;  // Bindless texture index
+  constexpr VkDeviceSize kInstanceStride = sizeof(InstanceTransform) + sizeof(InstanceColor) + sizeof(InstanceMaterial);
+
+  // GPU-driven scene, std430: one per object, culled by shaders/cull.comp and drawn by shaders/scene.vert
+  struct SceneObject
+  {
+    glm::mat4 transform_ = glm::mat4(1.0f);
+    glm::vec4 bounds_ = glm::vec4(0.0f);  // Model-space bounding sphere, center then radius
+    std::uint32_t batch_ = 0;
+    std::uint32_t material_ = 0;
+    std::uint32_t padding_[2] = {0, 0};
+  };
+
+  // One per mesh of the scene, its visible objects are compacted from first_command_ on
+  struct SceneBatch
+  {
+    std::uint32_t index_count_ = 0;
+    std::uint32_t first_command_ = 0;
+  };
+
+  // Push constants of the culling pass, every buffer is a bindless index
+  struct CullPushConstants
+  {
+    std::uint32_t object_buffer_ = 0;
+    std::uint32_t batch_buffer_ = 0;
+    std::uint32_t command_buffer_ = 0;
+    std::uint32_t count_buffer_ = 0;
+    std::uint32_t object_count_ = 0;
+  };
+
+  // Specialization constants, the constant_id each shader declares them with
+  constexpr std::uint32_t kTexturedConstantId = 0;  // basic.frag, bool: samples the draw's texture
+  constexpr std::uint32_t kCullGroupSizeConstantId = 0;  // cull.comp, uint: local_size_x
+}  // namespace veng
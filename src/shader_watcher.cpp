@@ -0,0 +1,208 @@
+#include <shader_watcher.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#ifndef VENG_GLSLC
+#define VENG_GLSLC "glslc"
+#endif
+
+namespace veng
+{
+  static bool IsShaderStage(const std::filesystem::path& path)
+  {
+    const std::filesystem::path extension = path.extension();
+    return extension == ".vert" || extension == ".frag" || extension == ".comp";
+  }
+
+  // Adds the files named by the quoted #include directives of source, and theirs, relative to its directory
+  static void CollectIncludes(const std::filesystem::path& source, std::set<std::string>& includes)
+  {
+    std::ifstream file(source);
+    std::string line;
+    while (std::getline(file, line))
+    {
+      const std::size_t directive = line.find_first_not_of(" \t");
+      if (directive == std::string::npos || line.compare(directive, 8, "#include") != 0)
+      {
+        continue;
+      }
+      const std::size_t open = line.find('"', directive);
+      const std::size_t close = open != std::string::npos ? line.find('"', open + 1) : std::string::npos;
+      if (close == std::string::npos)
+      {
+        continue;
+      }
+      const std::string include = line.substr(open + 1, close - open - 1);
+      if (includes.insert(include).second)
+      {
+        CollectIncludes(source.parent_path() / include, includes);
+      }
+    }
+  }
+
+#ifdef __linux__
+  ShaderWatcher::ShaderWatcher(std::filesystem::path source_directory, std::filesystem::path output_directory) :
+      source_directory_(std::move(source_directory)), output_directory_(std::move(output_directory))
+  {
+    inotify_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_ < 0)
+    {
+      SPDLOG_ERROR("Failed to initialize inotify: {}", std::strerror(errno));
+      return;
+    }
+    // Editors either rewrite the file in place or save a new one over it
+    if (inotify_add_watch(inotify_, source_directory_.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+      SPDLOG_ERROR("Failed to watch {}: {}", source_directory_.string(), std::strerror(errno));
+      close(inotify_);
+      inotify_ = -1;
+      return;
+    }
+
+    SPDLOG_INFO("Watching {} for shader changes", source_directory_.string());
+    thread_ = std::jthread(std::bind_front(&ShaderWatcher::WatchLoop, this));
+  }
+
+  ShaderWatcher::~ShaderWatcher()
+  {
+    // The loop polls with a timeout, it notices the stop request within one
+    thread_ = std::jthread();
+    if (inotify_ >= 0)
+    {
+      close(inotify_);
+    }
+  }
+
+  bool ShaderWatcher::IsSupported()
+  {
+    return true;
+  }
+
+  void ShaderWatcher::WatchLoop(std::stop_token stop_token)
+  {
+    tracy::SetThreadName("Shader watcher");
+    constexpr std::int32_t kPollTimeoutMs = 100;
+    // Saving often takes several writes, they are gathered until the directory stays quiet this long
+    constexpr std::int32_t kSettleTimeMs = 50;
+
+    pollfd descriptor = NULL_STRUCT;
+    descriptor.fd = inotify_;
+    descriptor.events = POLLIN;
+    while (!stop_token.stop_requested())
+    {
+      if (poll(&descriptor, 1, kPollTimeoutMs) <= 0)
+      {
+        continue;
+      }
+
+      std::set<std::string> changed_files;
+      do
+      {
+        alignas(inotify_event) std::array<char, 4096> buffer;
+        ssize_t length = 0;
+        while ((length = read(inotify_, buffer.data(), buffer.size())) > 0)
+        {
+          for (ssize_t offset = 0; offset < length;)
+          {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+            if (event->len > 0)
+            {
+              changed_files.insert(event->name);
+            }
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+          }
+        }
+      } while (poll(&descriptor, 1, kSettleTimeMs) > 0);
+
+      ZoneScopedN("Recompile shaders");
+      for (const std::filesystem::path& source : FindAffectedShaders(changed_files))
+      {
+        if (Compile(source))
+        {
+          std::scoped_lock lock(mutex_);
+          recompiled_.push_back(source.filename().string());
+        }
+      }
+    }
+  }
+#else
+  ShaderWatcher::ShaderWatcher(std::filesystem::path source_directory, std::filesystem::path output_directory) :
+      source_directory_(std::move(source_directory)), output_directory_(std::move(output_directory))
+  {
+    SPDLOG_WARN("Shader hot reload needs inotify, shaders will not be watched");
+  }
+
+  ShaderWatcher::~ShaderWatcher() = default;
+
+  bool ShaderWatcher::IsSupported()
+  {
+    return false;
+  }
+
+  void ShaderWatcher::WatchLoop([[maybe_unused]] std::stop_token stop_token) {}
+#endif  // __linux__
+
+  std::vector<std::string> ShaderWatcher::TakeRecompiled()
+  {
+    std::scoped_lock lock(mutex_);
+    return std::exchange(recompiled_, {});
+  }
+
+  std::set<std::filesystem::path> ShaderWatcher::FindAffectedShaders(const std::set<std::string>& changed_files) const
+  {
+    std::set<std::filesystem::path> affected;
+    std::error_code error;
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(source_directory_, error))
+    {
+      if (!IsShaderStage(entry.path()))
+      {
+        continue;
+      }
+      std::set<std::string> dependencies = {entry.path().filename().string()};
+      CollectIncludes(entry.path(), dependencies);
+      const bool changed = std::any_of(
+          dependencies.begin(), dependencies.end(),
+          [&changed_files](const std::string& dependency)
+          {
+            return changed_files.contains(dependency);
+          });
+      if (changed)
+      {
+        affected.insert(entry.path());
+      }
+    }
+    return affected;
+  }
+
+  bool ShaderWatcher::Compile(const std::filesystem::path& source) const
+  {
+    ZoneScoped;
+    [[maybe_unused]] auto start = std::chrono::steady_clock::now();
+    // Optimized like the build does. Written next to the target then renamed over it, the library never reads a
+    // half-written module.
+    const std::filesystem::path output = output_directory_ / (source.filename().string() + ".spv");
+    const std::filesystem::path temporary = output.string() + ".tmp";
+    const std::string command =
+        fmt::format("\"{}\" -O \"{}\" -o \"{}\"", VENG_GLSLC, source.string(), temporary.string());
+    std::error_code error;
+    if (std::system(command.c_str()) != 0)
+    {
+      std::filesystem::remove(temporary, error);
+      SPDLOG_ERROR("Failed to recompile {}, keeping the previous version", source.filename().string());
+      return false;
+    }
+
+    std::filesystem::rename(temporary, output, error);
+    if (error)
+    {
+      SPDLOG_ERROR("Failed to replace {}: {}", output.string(), error.message());
+      return false;
+    }
+    SPDLOG_INFO("Recompiled {} in {:.2f}ms", source.filename().string(), ElapsedMilliseconds(start));
+    return true;
+  }
+}  // namespace veng
@@ -0,0 +1,39 @@
+#pragma once
+
+namespace veng
+{
+  // Watches the GLSL sources for changes and recompiles the affected shaders with glslc on its own thread, so a
+  // saved shader shows up without restarting. Editing an include recompiles every shader that includes it. Only
+  // available on Linux, through inotify.
+  class ShaderWatcher
+  {
+   public:
+    // Compiled shaders are written to output_directory as "<name>.spv", where the ShaderLibrary loads them from
+    ShaderWatcher(std::filesystem::path source_directory, std::filesystem::path output_directory);
+    ~ShaderWatcher();
+
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    static bool IsSupported();
+
+    // Names ("basic.vert") of the shaders recompiled since the last call, the ones that failed to compile are left
+    // out and keep their previous SPIR-V
+    std::vector<std::string> TakeRecompiled();
+
+   private:
+    void WatchLoop(std::stop_token stop_token);
+    // Every shader that is one of the changed files or includes one, directly or not
+    std::set<std::filesystem::path> FindAffectedShaders(const std::set<std::string>& changed_files) const;
+    bool Compile(const std::filesystem::path& source) const;
+
+    std::filesystem::path source_directory_;
+    std::filesystem::path output_directory_;
+    std::int32_t inotify_ = -1;
+
+    std::mutex mutex_;
+    std::vector<std::string> recompiled_;
+
+    std::jthread thread_;
+  };
+}  // namespace veng
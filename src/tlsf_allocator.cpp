@@ -0,0 +1,255 @@
+#include <tlsf_allocator.h>
+
+namespace veng
+{
+  TlsfAllocator::TlsfAllocator(std::uint64_t size) : size_(size)
+  {
+    free_heads_.fill(kNone);
+
+    std::uint32_t whole = NewRegion();
+    regions_[whole].size_ = size;
+    InsertFree(whole);
+  }
+
+  void TlsfAllocator::Mapping(std::uint64_t size, std::uint32_t& first_level, std::uint32_t& second_level)
+  {
+    // Sizes below kSecondLevelCount get one exact class each in the first row
+    if (size < kSecondLevelCount)
+    {
+      first_level = 0;
+      second_level = static_cast<std::uint32_t>(size);
+      return;
+    }
+
+    const std::uint32_t top_bit = std::bit_width(size) - 1;
+    first_level = top_bit - kSecondLevelLog2 + 1;
+    second_level = static_cast<std::uint32_t>((size >> (top_bit - kSecondLevelLog2)) ^ kSecondLevelCount);
+  }
+
+  std::uint32_t TlsfAllocator::FindFreeRegion(std::uint64_t size) const
+  {
+    // Round up to the next class boundary so every region of the class found is large enough
+    if (size >= kSecondLevelCount)
+    {
+      const std::uint32_t top_bit = std::bit_width(size) - 1;
+      const std::uint64_t rounding = (1ull << (top_bit - kSecondLevelLog2)) - 1;
+      if (size > ~0ull - rounding)
+      {
+        return kNone;
+      }
+      size += rounding;
+    }
+
+    std::uint32_t first_level = 0;
+    std::uint32_t second_level = 0;
+    Mapping(size, first_level, second_level);
+    if (first_level >= kFirstLevelCount)
+    {
+      return kNone;
+    }
+
+    std::uint32_t second_level_map = second_level_bitmaps_[first_level] & (~0u << second_level);
+    if (second_level_map == 0)
+    {
+      const std::uint64_t first_level_map =
+          first_level + 1 < 64 ? first_level_bitmap_ & (~0ull << (first_level + 1)) : 0;
+      if (first_level_map == 0)
+      {
+        return kNone;
+      }
+      first_level = std::countr_zero(first_level_map);
+      second_level_map = second_level_bitmaps_[first_level];
+    }
+    second_level = std::countr_zero(second_level_map);
+
+    return free_heads_[first_level * kSecondLevelCount + second_level];
+  }
+
+  void TlsfAllocator::InsertFree(std::uint32_t region)
+  {
+    std::uint32_t first_level = 0;
+    std::uint32_t second_level = 0;
+    Mapping(regions_[region].size_, first_level, second_level);
+
+    std::uint32_t& head = free_heads_[first_level * kSecondLevelCount + second_level];
+    regions_[region].free_ = true;
+    regions_[region].previous_free_ = kNone;
+    regions_[region].next_free_ = head;
+    if (head != kNone)
+    {
+      regions_[head].previous_free_ = region;
+    }
+    head = region;
+
+    first_level_bitmap_ |= 1ull << first_level;
+    second_level_bitmaps_[first_level] |= 1u << second_level;
+    free_region_count_++;
+  }
+
+  void TlsfAllocator::RemoveFree(std::uint32_t region)
+  {
+    std::uint32_t first_level = 0;
+    std::uint32_t second_level = 0;
+    Mapping(regions_[region].size_, first_level, second_level);
+
+    Region& removed = regions_[region];
+    if (removed.previous_free_ != kNone)
+    {
+      regions_[removed.previous_free_].next_free_ = removed.next_free_;
+    }
+    else
+    {
+      free_heads_[first_level * kSecondLevelCount + second_level] = removed.next_free_;
+    }
+    if (removed.next_free_ != kNone)
+    {
+      regions_[removed.next_free_].previous_free_ = removed.previous_free_;
+    }
+    removed.free_ = false;
+    removed.previous_free_ = kNone;
+    removed.next_free_ = kNone;
+
+    if (free_heads_[first_level * kSecondLevelCount + second_level] == kNone)
+    {
+      second_level_bitmaps_[first_level] &= ~(1u << second_level);
+      if (second_level_bitmaps_[first_level] == 0)
+      {
+        first_level_bitmap_ &= ~(1ull << first_level);
+      }
+    }
+    free_region_count_--;
+  }
+
+  std::uint32_t TlsfAllocator::NewRegion()
+  {
+    if (!unused_regions_.empty())
+    {
+      std::uint32_t region = unused_regions_.back();
+      unused_regions_.pop_back();
+      regions_[region] = Region();
+      return region;
+    }
+    regions_.emplace_back();
+    return static_cast<std::uint32_t>(regions_.size() - 1);
+  }
+
+  void TlsfAllocator::Split(std::uint32_t region, std::uint64_t size)
+  {
+    std::uint32_t remainder = NewRegion();
+    // NewRegion may reallocate regions_, index again afterwards
+    Region& front = regions_[region];
+    Region& back = regions_[remainder];
+    back.offset_ = front.offset_ + size;
+    back.size_ = front.size_ - size;
+    back.previous_physical_ = region;
+    back.next_physical_ = front.next_physical_;
+    if (front.next_physical_ != kNone)
+    {
+      regions_[front.next_physical_].previous_physical_ = remainder;
+    }
+    front.next_physical_ = remainder;
+    front.size_ = size;
+
+    InsertFree(remainder);
+  }
+
+  void TlsfAllocator::Merge(std::uint32_t region, std::uint32_t next)
+  {
+    Region& front = regions_[region];
+    Region& back = regions_[next];
+    front.size_ += back.size_;
+    front.next_physical_ = back.next_physical_;
+    if (back.next_physical_ != kNone)
+    {
+      regions_[back.next_physical_].previous_physical_ = region;
+    }
+    unused_regions_.push_back(next);
+  }
+
+  std::uint64_t TlsfAllocator::Allocate(std::uint64_t size, std::uint64_t alignment)
+  {
+    if (size == 0 || size > size_ || alignment > size_)
+    {
+      return kInvalidOffset;
+    }
+
+    // Any region this large fits the request whatever its offset's alignment
+    std::uint32_t region = FindFreeRegion(size + alignment - 1);
+    if (region == kNone)
+    {
+      return kInvalidOffset;
+    }
+    RemoveFree(region);
+
+    // Give the alignment padding back to the list instead of wasting it
+    const std::uint64_t offset = regions_[region].offset_;
+    const std::uint64_t padding = ((offset + alignment - 1) & ~(alignment - 1)) - offset;
+    if (padding > 0)
+    {
+      Split(region, padding);
+      std::uint32_t aligned = regions_[region].next_physical_;
+      RemoveFree(aligned);
+      InsertFree(region);
+      region = aligned;
+    }
+    if (regions_[region].size_ > size)
+    {
+      Split(region, size);
+    }
+
+    allocated_regions_.emplace(regions_[region].offset_, region);
+    used_size_ += regions_[region].size_;
+    allocation_count_++;
+    return regions_[region].offset_;
+  }
+
+  void TlsfAllocator::Free(std::uint64_t offset)
+  {
+    auto it = allocated_regions_.find(offset);
+    if (it == allocated_regions_.end())
+    {
+      SPDLOG_ERROR("Freeing offset {} which was not allocated", offset);
+      return;
+    }
+    std::uint32_t region = it->second;
+    allocated_regions_.erase(it);
+    used_size_ -= regions_[region].size_;
+    allocation_count_--;
+
+    // Coalesce with the free neighbours right away, keeping free space in as few regions as possible
+    std::uint32_t next = regions_[region].next_physical_;
+    if (next != kNone && regions_[next].free_)
+    {
+      RemoveFree(next);
+      Merge(region, next);
+    }
+    std::uint32_t previous = regions_[region].previous_physical_;
+    if (previous != kNone && regions_[previous].free_)
+    {
+      RemoveFree(previous);
+      Merge(previous, region);
+      region = previous;
+    }
+
+    InsertFree(region);
+  }
+
+  std::uint64_t TlsfAllocator::GetLargestFreeRegion() const
+  {
+    if (first_level_bitmap_ == 0)
+    {
+      return 0;
+    }
+
+    // The largest region lives in the highest non-empty class, but not necessarily at the head of its list
+    const std::uint32_t first_level = 63 - std::countl_zero(first_level_bitmap_);
+    const std::uint32_t second_level = 31 - std::countl_zero(second_level_bitmaps_[first_level]);
+    std::uint64_t largest = 0;
+    for (std::uint32_t region = free_heads_[first_level * kSecondLevelCount + second_level]; region != kNone;
+         region = regions_[region].next_free_)
+    {
+      largest = std::max(largest, regions_[region].size_);
+    }
+    return largest;
+  }
+}  // namespace veng
@@ -0,0 +1,64 @@
+#pragma once
+
+namespace veng
+{
+  // Two-Level Segregated Fit offset allocator: O(1) allocation and free inside a fixed range, with immediate
+  // coalescing of neighbouring free regions. Manages offsets only, the memory itself belongs to the caller.
+  class TlsfAllocator
+  {
+   public:
+    static constexpr std::uint64_t kInvalidOffset = ~0ull;
+
+    explicit TlsfAllocator(std::uint64_t size);
+
+    // Returns kInvalidOffset when no free region fits. alignment must be a power of two.
+    std::uint64_t Allocate(std::uint64_t size, std::uint64_t alignment);
+    void Free(std::uint64_t offset);
+
+    std::uint64_t GetSize() const { return size_; };
+    std::uint64_t GetUsedSize() const { return used_size_; };
+    std::uint32_t GetAllocationCount() const { return allocation_count_; };
+    std::uint32_t GetFreeRegionCount() const { return free_region_count_; };
+    std::uint64_t GetLargestFreeRegion() const;
+    bool IsEmpty() const { return allocation_count_ == 0; };
+
+   private:
+    static constexpr std::uint32_t kSecondLevelLog2 = 5;
+    static constexpr std::uint32_t kSecondLevelCount = 1u << kSecondLevelLog2;
+    static constexpr std::uint32_t kFirstLevelCount = 64 - kSecondLevelLog2 + 1;
+    static constexpr std::uint32_t kNone = ~0u;
+
+    // A contiguous region, linked to its physical neighbours and, while free, into its size class list
+    struct Region
+    {
+      std::uint64_t offset_ = 0;
+      std::uint64_t size_ = 0;
+      std::uint32_t previous_physical_ = kNone;
+      std::uint32_t next_physical_ = kNone;
+      std::uint32_t previous_free_ = kNone;
+      std::uint32_t next_free_ = kNone;
+      bool free_ = false;
+    };
+
+    static void Mapping(std::uint64_t size, std::uint32_t& first_level, std::uint32_t& second_level);
+    std::uint32_t FindFreeRegion(std::uint64_t size) const;
+    void InsertFree(std::uint32_t region);
+    void RemoveFree(std::uint32_t region);
+    // Splits size bytes off the front of region, the remainder becomes a new free region after it
+    void Split(std::uint32_t region, std::uint64_t size);
+    void Merge(std::uint32_t region, std::uint32_t next);
+    std::uint32_t NewRegion();
+
+    std::vector<Region> regions_;
+    std::vector<std::uint32_t> unused_regions_;
+    std::unordered_map<std::uint64_t, std::uint32_t> allocated_regions_;
+    std::array<std::uint32_t, kFirstLevelCount * kSecondLevelCount> free_heads_;
+    std::array<std::uint32_t, kFirstLevelCount> second_level_bitmaps_ = NULL_STRUCT;
+    std::uint64_t first_level_bitmap_ = 0;
+
+    std::uint64_t size_ = 0;
+    std::uint64_t used_size_ = 0;
+    std::uint32_t allocation_count_ = 0;
+    std::uint32_t free_region_count_ = 0;
+  };
+}  // namespace veng
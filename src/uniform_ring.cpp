@@ -0,0 +1,118 @@
+#include <uniform_ring.h>
+
+namespace veng
+{
+  UniformRing::UniformRing(
+      VkPhysicalDevice physical_device, VkDevice device, GpuAllocator& allocator, std::uint32_t frames_in_flight,
+      VkDeviceSize frame_size) :
+      device_(device), allocator_(allocator)
+  {
+    VkPhysicalDeviceProperties properties = NULL_STRUCT;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    alignment_ = std::max(
+        properties.limits.minUniformBufferOffsetAlignment, properties.limits.minStorageBufferOffsetAlignment);
+    frame_size_ = AlignUp(frame_size, alignment_);
+
+    // The tail slack keeps offset + range inside the buffer for blocks pushed at the very end of the last region
+    const VkDeviceSize size = frame_size_ * frames_in_flight + kStorageRange;
+    buffer_ = allocator_.CreateBuffer(
+        size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, MemoryUsage::kCpuToGpu);
+    if (buffer_.buffer_ == VK_NULL_HANDLE || buffer_.allocation_.mapped_ == nullptr)
+    {
+      SPDLOG_ERROR("Failed creating the uniform ring, exiting...");
+      std::exit(EXIT_FAILURE);
+    }
+
+    CreateDescriptors();
+  }
+
+  UniformRing::~UniformRing()
+  {
+    // Destroying the pool frees the set
+    vkDestroyDescriptorPool(device_, pool_, VK_NULL_HANDLE);
+    vkDestroyDescriptorSetLayout(device_, set_layout_, VK_NULL_HANDLE);
+    allocator_.DestroyBuffer(buffer_);
+  }
+
+  void UniformRing::CreateDescriptors()
+  {
+    const VkShaderStageFlags stages =
+        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    std::array<VkDescriptorSetLayoutBinding, kBindingCount> bindings = NULL_STRUCT;
+    bindings[kFrameBinding] = {kFrameBinding, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, stages, nullptr};
+    bindings[kDrawBinding] = {kDrawBinding, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, stages, nullptr};
+    bindings[kStorageBinding] = {kStorageBinding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1, stages, nullptr};
+
+    VkDescriptorSetLayoutCreateInfo layout_info = NULL_STRUCT;
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.bindingCount = bindings.size();
+    layout_info.pBindings = bindings.data();
+    if (vkCreateDescriptorSetLayout(device_, &layout_info, VK_NULL_HANDLE, &set_layout_) != VK_SUCCESS)
+    {
+      SPDLOG_ERROR("Failed creating the uniform ring descriptor set layout, exiting...");
+      std::exit(EXIT_FAILURE);
+    }
+
+    std::array<VkDescriptorPoolSize, 2> pool_sizes = {
+        VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 2},
+        VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1}};
+    VkDescriptorPoolCreateInfo pool_info = NULL_STRUCT;
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.maxSets = 1;
+    pool_info.poolSizeCount = pool_sizes.size();
+    pool_info.pPoolSizes = pool_sizes.data();
+    if (vkCreateDescriptorPool(device_, &pool_info, VK_NULL_HANDLE, &pool_) != VK_SUCCESS)
+    {
+      SPDLOG_ERROR("Failed creating the uniform ring descriptor pool, exiting...");
+      std::exit(EXIT_FAILURE);
+    }
+
+    VkDescriptorSetAllocateInfo allocate_info = NULL_STRUCT;
+    allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocate_info.descriptorPool = pool_;
+    allocate_info.descriptorSetCount = 1;
+    allocate_info.pSetLayouts = &set_layout_;
+    if (vkAllocateDescriptorSets(device_, &allocate_info, &set_) != VK_SUCCESS)
+    {
+      SPDLOG_ERROR("Failed allocating the uniform ring descriptor set, exiting...");
+      std::exit(EXIT_FAILURE);
+    }
+
+    // Written once, every binding points at the start of the buffer and the dynamic offsets do the rest
+    std::array<VkDescriptorBufferInfo, kBindingCount> buffer_infos = {
+        VkDescriptorBufferInfo{buffer_.buffer_, 0, kUniformRange},
+        VkDescriptorBufferInfo{buffer_.buffer_, 0, kUniformRange},
+        VkDescriptorBufferInfo{buffer_.buffer_, 0, kStorageRange}};
+    std::array<VkWriteDescriptorSet, kBindingCount> writes = NULL_STRUCT;
+    for (std::uint32_t i = 0; i < kBindingCount; i++)
+    {
+      writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      writes[i].dstSet = set_;
+      writes[i].dstBinding = i;
+      writes[i].descriptorCount = 1;
+      writes[i].descriptorType = bindings[i].descriptorType;
+      writes[i].pBufferInfo = &buffer_infos[i];
+    }
+    vkUpdateDescriptorSets(device_, writes.size(), writes.data(), 0, nullptr);
+  }
+
+  void UniformRing::BeginFrame(std::uint32_t frame_index)
+  {
+    frame_start_ = frame_size_ * frame_index;
+    head_ = frame_start_;
+  }
+
+  std::uint32_t UniformRing::Push(const void* data, VkDeviceSize size)
+  {
+    // The head stays aligned, so concurrent pushes only need to claim their rounded-up size
+    const VkDeviceSize offset = head_.fetch_add(AlignUp(size, alignment_), std::memory_order_relaxed);
+    if (offset + size > frame_start_ + frame_size_)
+    {
+      SPDLOG_ERROR("The uniform ring is out of space ({} bytes per frame)", frame_size_);
+      throw std::runtime_error("Uniform ring overflow!");
+    }
+
+    std::memcpy(buffer_.allocation_.mapped_ + offset, data, size);
+    return static_cast<std::uint32_t>(offset);
+  }
+}  // namespace veng
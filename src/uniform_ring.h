@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <gpu_allocator.h>
+
+namespace veng
+{
+  // One persistently mapped, host-coherent buffer split into a region per frame in flight. Per-frame and per-draw
+  // data is bump-allocated into the current region and reached through the dynamic offsets of a single descriptor
+  // set, so a draw costs a copy and an offset: no allocation, no map/unmap and no descriptor update.
+  class UniformRing
+  {
+   public:
+    // Set 0 layout. Every binding is dynamic, their offsets are passed in this order when binding the set.
+    static constexpr std::uint32_t kFrameBinding = 0;  // Uniform, set once per frame
+    static constexpr std::uint32_t kDrawBinding = 1;  // Uniform, set per draw
+    static constexpr std::uint32_t kStorageBinding = 2;  // Storage, per draw arrays
+    static constexpr std::uint32_t kBindingCount = 3;
+
+    // Largest block a single binding can see
+    static constexpr VkDeviceSize kUniformRange = 256;
+    static constexpr VkDeviceSize kStorageRange = 64 * 1024;
+
+    UniformRing(
+        VkPhysicalDevice physical_device, VkDevice device, GpuAllocator& allocator, std::uint32_t frames_in_flight,
+        VkDeviceSize frame_size);
+    ~UniformRing();
+
+    UniformRing(const UniformRing&) = delete;
+    UniformRing& operator=(const UniformRing&) = delete;
+
+    // Rewinds to the region of the slot, the GPU must be done with its previous frame
+    void BeginFrame(std::uint32_t frame_index);
+
+    // Copies data into the ring, the returned offset goes to vkCmdBindDescriptorSets. Throws when the frame's
+    // region is exhausted. Safe to call from several recording threads at once.
+    std::uint32_t Push(const void* data, VkDeviceSize size);
+    template <typename T>
+    std::uint32_t Push(const T& data)
+    {
+      return Push(&data, sizeof(T));
+    }
+
+    VkDescriptorSetLayout GetSetLayout() const { return set_layout_; };
+    VkDescriptorSet GetSet() const { return set_; };
+    // Bytes pushed in the current frame, for sizing the ring
+    VkDeviceSize GetFrameUsage() const { return std::min(head_.load(), frame_start_ + frame_size_) - frame_start_; };
+
+   private:
+    void CreateDescriptors();
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    GpuAllocator& allocator_;
+    Buffer buffer_ = NULL_STRUCT;
+    VkDeviceSize frame_size_ = 0;
+    VkDeviceSize alignment_ = 0;
+    VkDeviceSize frame_start_ = 0;
+    std::atomic<VkDeviceSize> head_ = 0;
+
+    VkDescriptorSetLayout set_layout_ = VK_NULL_HANDLE;
+    VkDescriptorPool pool_ = VK_NULL_HANDLE;
+    VkDescriptorSet set_ = VK_NULL_HANDLE;
+  };
+}  // namespace veng
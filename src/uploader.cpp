@@ -0,0 +1,314 @@
+#include <uploader.h>
+
+namespace veng
+{
+  Uploader::Uploader(
+      VkDevice device, GpuAllocator& allocator, VkQueue transfer_queue, std::uint32_t transfer_family,
+      std::uint32_t graphics_family) :
+      device_(device), allocator_(allocator), transfer_queue_(transfer_queue), transfer_family_(transfer_family),
+      graphics_family_(graphics_family)
+  {
+    VkSemaphoreTypeCreateInfo type_info = NULL_STRUCT;
+    type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    type_info.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphore_info = NULL_STRUCT;
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_info.pNext = &type_info;
+
+    if (vkCreateSemaphore(device_, &semaphore_info, VK_NULL_HANDLE, &timeline_) != VK_SUCCESS)
+    {
+      SPDLOG_ERROR("Failed to create the upload timeline semaphore, exiting...");
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  Uploader::~Uploader()
+  {
+    // The device is idle by now, every batch has finished
+    auto destroy = [this](Batch& batch)
+    {
+      for (Buffer& staging : batch.staging_buffers_)
+      {
+        allocator_.DestroyBuffer(staging);
+      }
+      vkDestroyCommandPool(device_, batch.command_pool_, VK_NULL_HANDLE);
+    };
+
+    if (recording_.has_value())
+    {
+      destroy(*recording_);
+    }
+    for (Batch& batch : in_flight_)
+    {
+      destroy(batch);
+    }
+    for (Batch& batch : free_batches_)
+    {
+      destroy(batch);
+    }
+    vkDestroySemaphore(device_, timeline_, VK_NULL_HANDLE);
+  }
+
+  std::uint64_t Uploader::GetCompletedValue() const
+  {
+    std::uint64_t value = 0;
+    vkGetSemaphoreCounterValue(device_, timeline_, &value);
+    return value;
+  }
+
+  void Uploader::BeginBatch()
+  {
+    if (!free_batches_.empty())
+    {
+      recording_ = std::move(free_batches_.back());
+      free_batches_.pop_back();
+      vkResetCommandPool(device_, recording_->command_pool_, 0);
+    }
+    else
+    {
+      recording_.emplace();
+
+      VkCommandPoolCreateInfo pool_info = NULL_STRUCT;
+      pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+      pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+      pool_info.queueFamilyIndex = transfer_family_;
+      if (vkCreateCommandPool(device_, &pool_info, VK_NULL_HANDLE, &recording_->command_pool_) != VK_SUCCESS)
+      {
+        throw std::runtime_error("Failed to create an upload command pool!");
+      }
+
+      VkCommandBufferAllocateInfo allocate_info = NULL_STRUCT;
+      allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+      allocate_info.commandPool = recording_->command_pool_;
+      allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+      allocate_info.commandBufferCount = 1;
+      if (vkAllocateCommandBuffers(device_, &allocate_info, &recording_->command_buffer_) != VK_SUCCESS)
+      {
+        throw std::runtime_error("Failed to allocate an upload command buffer!");
+      }
+    }
+
+    recording_->value_ = next_value_;
+
+    VkCommandBufferBeginInfo begin_info = NULL_STRUCT;
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(recording_->command_buffer_, &begin_info);
+  }
+
+  UploadTicket Uploader::UploadBuffer(
+      const Buffer& destination, const void* data, VkDeviceSize size, VkDeviceSize offset)
+  {
+    Buffer staging = CreateStaging(data, size);
+
+    VkBufferCopy region = NULL_STRUCT;
+    region.dstOffset = offset;
+    region.size = size;
+    vkCmdCopyBuffer(recording_->command_buffer_, staging.buffer_, destination.buffer_, 1, &region);
+    recording_->staging_buffers_.push_back(staging);
+    recording_->acquires_.push_back({destination.buffer_, offset, size, VK_NULL_HANDLE});
+
+    return recording_->value_;
+  }
+
+  UploadTicket Uploader::UploadImage(const Image& destination, const void* data, VkDeviceSize size, VkExtent3D extent)
+  {
+    Buffer staging = CreateStaging(data, size);
+    VkCommandBuffer command_buffer = recording_->command_buffer_;
+
+    VkImageMemoryBarrier to_transfer = NULL_STRUCT;
+    to_transfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    to_transfer.srcAccessMask = 0;
+    to_transfer.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    to_transfer.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    to_transfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    to_transfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    to_transfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    to_transfer.image = destination.image_;
+    to_transfer.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCmdPipelineBarrier(
+        command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1,
+        &to_transfer);
+
+    VkBufferImageCopy region = NULL_STRUCT;
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent = extent;
+    vkCmdCopyBufferToImage(
+        command_buffer, staging.buffer_, destination.image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    // Without an ownership transfer the layout change happens here, otherwise it is part of the release/acquire pair
+    if (!IsDedicatedQueue())
+    {
+      VkImageMemoryBarrier to_shader = to_transfer;
+      to_shader.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      to_shader.dstAccessMask = 0;  // Made visible by the graphics submission's wait on the timeline
+      to_shader.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      to_shader.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+      vkCmdPipelineBarrier(
+          command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0,
+          nullptr, 1, &to_shader);
+    }
+
+    recording_->staging_buffers_.push_back(staging);
+    recording_->acquires_.push_back({VK_NULL_HANDLE, 0, 0, destination.image_});
+
+    return recording_->value_;
+  }
+
+  Buffer Uploader::CreateStaging(const void* data, VkDeviceSize size)
+  {
+    if (!recording_.has_value())
+    {
+      BeginBatch();
+    }
+
+    Buffer staging = allocator_.CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, MemoryUsage::kCpuToGpu);
+    if (staging.buffer_ == VK_NULL_HANDLE)
+    {
+      throw std::runtime_error("Failed to create an upload staging buffer!");
+    }
+    // Host coherent, no flush needed
+    std::memcpy(staging.allocation_.mapped_, data, size);
+    return staging;
+  }
+
+  void Uploader::Flush()
+  {
+    ZoneScoped;
+    // Recycle the batches the transfer queue is done with, remembering what graphics still has to acquire
+    const std::uint64_t completed = GetCompletedValue();
+    while (!in_flight_.empty() && in_flight_.front().value_ <= completed)
+    {
+      Batch& batch = in_flight_.front();
+      for (Buffer& staging : batch.staging_buffers_)
+      {
+        allocator_.DestroyBuffer(staging);
+      }
+      batch.staging_buffers_.clear();
+      acquires_ready_.insert(acquires_ready_.end(), batch.acquires_.begin(), batch.acquires_.end());
+      batch.acquires_.clear();
+      collected_value_ = batch.value_;
+      free_batches_.push_back(std::move(batch));
+      in_flight_.pop_front();
+    }
+
+    if (!recording_.has_value())
+    {
+      return;
+    }
+
+    // Release the destinations to the graphics family, the matching acquire happens in RecordAcquires()
+    if (IsDedicatedQueue())
+    {
+      std::vector<VkBufferMemoryBarrier> releases;
+      std::vector<VkImageMemoryBarrier> image_releases;
+      releases.reserve(recording_->acquires_.size());
+      for (const PendingAcquire& acquire : recording_->acquires_)
+      {
+        if (acquire.image_ != VK_NULL_HANDLE)
+        {
+          image_releases.push_back(MakeImageOwnershipBarrier(acquire.image_, true));
+          continue;
+        }
+        VkBufferMemoryBarrier release = NULL_STRUCT;
+        release.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        release.dstAccessMask = 0;
+        release.srcQueueFamilyIndex = transfer_family_;
+        release.dstQueueFamilyIndex = graphics_family_;
+        release.buffer = acquire.buffer_;
+        release.offset = acquire.offset_;
+        release.size = acquire.size_;
+        releases.push_back(release);
+      }
+      vkCmdPipelineBarrier(
+          recording_->command_buffer_, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0,
+          nullptr, releases.size(), releases.data(), image_releases.size(), image_releases.data());
+    }
+    vkEndCommandBuffer(recording_->command_buffer_);
+
+    VkTimelineSemaphoreSubmitInfo timeline_info = NULL_STRUCT;
+    timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timeline_info.signalSemaphoreValueCount = 1;
+    timeline_info.pSignalSemaphoreValues = &recording_->value_;
+
+    VkSubmitInfo submit_info = NULL_STRUCT;
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.pNext = &timeline_info;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &recording_->command_buffer_;
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &timeline_;
+
+    if (vkQueueSubmit(transfer_queue_, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+      throw std::runtime_error("Failed to submit the upload batch!");
+    }
+
+    next_value_++;
+    in_flight_.push_back(std::move(*recording_));
+    recording_.reset();
+  }
+
+  VkImageMemoryBarrier Uploader::MakeImageOwnershipBarrier(VkImage image, bool release) const
+  {
+    // Both halves must describe the same layout transition
+    VkImageMemoryBarrier barrier = NULL_STRUCT;
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = release ? VK_ACCESS_TRANSFER_WRITE_BIT : 0;
+    barrier.dstAccessMask = release ? 0 : VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcQueueFamilyIndex = transfer_family_;
+    barrier.dstQueueFamilyIndex = graphics_family_;
+    barrier.image = image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    return barrier;
+  }
+
+  void Uploader::RecordAcquires(VkCommandBuffer graphics_commands)
+  {
+    if (collected_value_ <= acquired_value_)
+    {
+      return;
+    }
+
+    if (IsDedicatedQueue() && !acquires_ready_.empty())
+    {
+      std::vector<VkBufferMemoryBarrier> acquires;
+      std::vector<VkImageMemoryBarrier> image_acquires;
+      acquires.reserve(acquires_ready_.size());
+      for (const PendingAcquire& pending : acquires_ready_)
+      {
+        if (pending.image_ != VK_NULL_HANDLE)
+        {
+          image_acquires.push_back(MakeImageOwnershipBarrier(pending.image_, false));
+          continue;
+        }
+        VkBufferMemoryBarrier acquire = NULL_STRUCT;
+        acquire.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        acquire.srcAccessMask = 0;
+        acquire.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                                VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT |
+                                VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        acquire.srcQueueFamilyIndex = transfer_family_;
+        acquire.dstQueueFamilyIndex = graphics_family_;
+        acquire.buffer = pending.buffer_;
+        acquire.offset = pending.offset_;
+        acquire.size = pending.size_;
+        acquires.push_back(acquire);
+      }
+      vkCmdPipelineBarrier(
+          graphics_commands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+          VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+              VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+          0, 0, nullptr, acquires.size(), acquires.data(), image_acquires.size(), image_acquires.data());
+    }
+    acquires_ready_.clear();
+
+    acquired_value_ = collected_value_;
+  }
+}  // namespace veng
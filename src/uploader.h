@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <gpu_allocator.h>
+
+namespace veng
+{
+  // Value the upload timeline reaches once the batch holding an upload has finished
+  using UploadTicket = std::uint64_t;
+
+  // Batches buffer uploads per frame and submits them to the transfer queue. Completion is tracked with a
+  // timeline semaphore. When the transfer queue belongs to another family, the buffers are released to the
+  // graphics family after the copy and acquired by the next graphics frame that sees the batch finished.
+  class Uploader
+  {
+   public:
+    Uploader(
+        VkDevice device, GpuAllocator& allocator, VkQueue transfer_queue, std::uint32_t transfer_family,
+        std::uint32_t graphics_family);
+    ~Uploader();
+
+    Uploader(const Uploader&) = delete;
+    Uploader& operator=(const Uploader&) = delete;
+
+    // Copies data into the destination through a staging buffer. Nothing reaches the GPU before the next Flush().
+    UploadTicket UploadBuffer(const Buffer& destination, const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+    // Fills the first mip of a color image with tightly packed texels, leaving it in SHADER_READ_ONLY_OPTIMAL
+    UploadTicket UploadImage(const Image& destination, const void* data, VkDeviceSize size, VkExtent3D extent);
+    // Submits the uploads recorded since the last flush as one batch and recycles the finished batches
+    void Flush();
+
+    // Records the ownership acquires of every finished batch, before any draw of the frame reads them.
+    // The frame's graphics submission must then wait on GetTimeline() at GetAcquiredValue().
+    void RecordAcquires(VkCommandBuffer graphics_commands);
+    // Resources of an upload may be used by graphics work recorded after its ticket was acquired
+    bool IsReady(UploadTicket ticket) const { return ticket <= acquired_value_; };
+
+    VkSemaphore GetTimeline() const { return timeline_; };
+    UploadTicket GetAcquiredValue() const { return acquired_value_; };
+    bool IsDedicatedQueue() const { return transfer_family_ != graphics_family_; };
+
+   private:
+    // A buffer range or an image whose ownership goes from the transfer family to graphics
+    struct PendingAcquire
+    {
+      VkBuffer buffer_ = VK_NULL_HANDLE;
+      VkDeviceSize offset_ = 0;
+      VkDeviceSize size_ = 0;
+      VkImage image_ = VK_NULL_HANDLE;
+    };
+    // One submission to the transfer queue, recycled once the timeline passes its value
+    struct Batch
+    {
+      UploadTicket value_ = 0;
+      VkCommandPool command_pool_ = VK_NULL_HANDLE;
+      VkCommandBuffer command_buffer_ = VK_NULL_HANDLE;
+      std::vector<Buffer> staging_buffers_;
+      std::vector<PendingAcquire> acquires_;
+    };
+
+    void BeginBatch();
+    Buffer CreateStaging(const void* data, VkDeviceSize size);
+    VkImageMemoryBarrier MakeImageOwnershipBarrier(VkImage image, bool release) const;
+    std::uint64_t GetCompletedValue() const;
+
+    VkDevice device_ = VK_NULL_HANDLE;
+    GpuAllocator& allocator_;
+    VkQueue transfer_queue_ = VK_NULL_HANDLE;
+    std::uint32_t transfer_family_ = 0;
+    std::uint32_t graphics_family_ = 0;
+
+    VkSemaphore timeline_ = VK_NULL_HANDLE;
+    UploadTicket next_value_ = 1;
+    UploadTicket collected_value_ = 0;  // Last batch whose acquires were moved to acquires_ready_
+    UploadTicket acquired_value_ = 0;
+
+    std::optional<Batch> recording_ = std::nullopt;
+    std::deque<Batch> in_flight_;  // Ordered by value
+    std::vector<PendingAcquire> acquires_ready_;  // Collected from finished batches, recorded by RecordAcquires()
+    std::vector<Batch> free_batches_;
+  };
+}  // namespace veng
@@ -41,4 +41,59 @@ namespace veng
     // Return Buffer
     return buffer;
   }
+
+  bool HasArgument(gsl::span<gsl::zstring> arguments, std::string_view name)
+  {
+    return std::any_of(
+        arguments.begin(), arguments.end(),
+        [name](gsl::czstring argument)
+        {
+          return name == argument;
+        });
+  }
+
+  std::optional<std::string_view> GetArgumentValue(gsl::span<gsl::zstring> arguments, std::string_view name)
+  {
+    auto it = std::find_if(
+        arguments.begin(), arguments.end(),
+        [name](gsl::czstring argument)
+        {
+          return name == argument;
+        });
+
+    if (it == arguments.end() || std::next(it) == arguments.end())
+    {
+      return std::nullopt;
+    }
+
+    return *std::next(it);
+  }
+
+  std::optional<std::uint64_t> ParseUnsigned(std::string_view text)
+  {
+    std::uint64_t value = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc() || end != text.data() + text.size())
+    {
+      return std::nullopt;
+    }
+
+    return value;
+  }
+
+  std::uint64_t HashBytes(gsl::span<const std::uint8_t> bytes, std::uint64_t seed)
+  {
+    std::uint64_t hash = seed;
+    for (std::uint8_t byte : bytes)
+    {
+      hash ^= byte;
+      hash *= 0x100000001b3ull;
+    }
+    return hash;
+  }
+
+  double ElapsedMilliseconds(std::chrono::steady_clock::time_point start)
+  {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
 }  // namespace veng
@@ -5,4 +5,26 @@ namespace veng
 {
   bool streq(gsl::czstring left, gsl::czstring right);
   std::vector<std::uint8_t> ReadFile(std::filesystem::path shader_path);
+
+  // Command line helpers, arguments are expected as "--name" or "--name value"
+  bool HasArgument(gsl::span<gsl::zstring> arguments, std::string_view name);
+  std::optional<std::string_view> GetArgumentValue(gsl::span<gsl::zstring> arguments, std::string_view name);
+  std::optional<std::uint64_t> ParseUnsigned(std::string_view text);
+
+  // FNV-1a, stable across runs and platforms
+  std::uint64_t HashBytes(gsl::span<const std::uint8_t> bytes, std::uint64_t seed = 0xcbf29ce484222325ull);
+  // Mixes value into seed, for building hashes out of several fields
+  inline std::uint64_t HashCombine(std::uint64_t seed, std::uint64_t value)
+  {
+    return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+  }
+
+  // Rounds value up to a multiple of alignment, which must be a power of two
+  inline std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+  {
+    return (value + alignment - 1) & ~(alignment - 1);
+  }
+
+  // Milliseconds elapsed since start on the steady clock
+  double ElapsedMilliseconds(std::chrono::steady_clock::time_point start);
 }  // namespace veng
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+namespace veng
+{
+  // Bindings and attributes feeding VkPipelineVertexInputStateCreateInfo
+  struct VertexLayout
+  {
+    std::vector<VkVertexInputBindingDescription> bindings_ = NULL_STRUCT;
+    std::vector<VkVertexInputAttributeDescription> attributes_ = NULL_STRUCT;
+
+    // The Vulkan structs have no operator==
+    bool operator==(const VertexLayout& other) const
+    {
+      return std::ranges::equal(
+                 bindings_, other.bindings_,
+                 [](const VkVertexInputBindingDescription& left, const VkVertexInputBindingDescription& right)
+                 {
+                   return left.binding == right.binding && left.stride == right.stride &&
+                          left.inputRate == right.inputRate;
+                 }) &&
+             std::ranges::equal(
+                 attributes_, other.attributes_,
+                 [](const VkVertexInputAttributeDescription& left, const VkVertexInputAttributeDescription& right)
+                 {
+                   return left.location == right.location && left.binding == right.binding &&
+                          left.format == right.format && left.offset == right.offset;
+                 });
+    };
+  };
+
+  struct Vertex
+  {
+    glm::vec3 position_ = glm::vec3(0.0f);
+    glm::vec3 color_ = glm::vec3(1.0f);
+    glm::vec2 uv_ = glm::vec2(0.0f);
+
+    static VertexLayout GetLayout()
+    {
+      VertexLayout layout;
+      layout.bindings_.push_back({0, sizeof(Vertex), VK_VERTEX_INPUT_RATE_VERTEX});
+      layout.attributes_.push_back({0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position_)});
+      layout.attributes_.push_back({1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color_)});
+      layout.attributes_.push_back({2, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv_)});
+      return layout;
+    }
+  };
+}  // namespace veng
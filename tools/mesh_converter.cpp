@@ -0,0 +1,258 @@
+#define CGLTF_IMPLEMENTATION
+#include <cgltf.h>
+#include <mesh_file.h>
+#include <sstream>
+
+// Offline converter from OBJ and glTF to the engine's mesh files, see src/mesh_file.h.
+// Usage: MeshConverter <input.obj|input.gltf|input.glb> <output.vmesh>
+
+struct MeshData
+{
+  std::vector<veng::Vertex> vertices_;
+  std::vector<std::uint32_t> indices_;
+};
+
+// OBJ index: 1-based, negative counts back from the latest element
+static std::optional<std::uint32_t> ResolveObjIndex(std::string_view text, std::size_t element_count)
+{
+  std::int64_t index = 0;
+  auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), index);
+  if (error != std::errc() || index == 0)
+  {
+    return std::nullopt;
+  }
+  const std::int64_t resolved = index > 0 ? index - 1 : static_cast<std::int64_t>(element_count) + index;
+  if (resolved < 0 || resolved >= static_cast<std::int64_t>(element_count))
+  {
+    return std::nullopt;
+  }
+  return static_cast<std::uint32_t>(resolved);
+}
+
+// Positions, optional "v x y z r g b" colors and texture coordinates. Polygons are fanned into triangles and
+// corners sharing a position and texture coordinate share a vertex.
+static std::optional<MeshData> LoadObj(const std::filesystem::path& path)
+{
+  std::ifstream file(path);
+  if (!file.is_open())
+  {
+    SPDLOG_ERROR("Failed to open {}", path.string());
+    return std::nullopt;
+  }
+
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec3> colors;
+  std::vector<glm::vec2> uvs;
+  std::unordered_map<std::uint64_t, std::uint32_t> vertex_of_corner;
+  MeshData mesh;
+
+  std::string line;
+  std::uint64_t line_number = 0;
+  while (std::getline(file, line))
+  {
+    line_number++;
+    std::istringstream stream(line);
+    std::string keyword;
+    stream >> keyword;
+    if (keyword == "v")
+    {
+      glm::vec3 position(0.0f);
+      glm::vec3 color(1.0f);
+      stream >> position.x >> position.y >> position.z;
+      if (!(stream >> color.x >> color.y >> color.z))
+      {
+        color = glm::vec3(1.0f);
+      }
+      positions.push_back(position);
+      colors.push_back(color);
+    }
+    else if (keyword == "vt")
+    {
+      glm::vec2 uv(0.0f);
+      stream >> uv.x >> uv.y;
+      uvs.push_back(glm::vec2(uv.x, 1.0f - uv.y));  // OBJ puts v = 0 at the bottom, Vulkan at the top
+    }
+    else if (keyword == "f")
+    {
+      std::vector<std::uint32_t> polygon;
+      std::string corner;
+      while (stream >> corner)
+      {
+        // "p", "p/t", "p//n" or "p/t/n", normals are not part of the vertex format
+        const std::size_t slash = corner.find('/');
+        const std::string_view corner_view(corner);
+        std::optional<std::uint32_t> position = ResolveObjIndex(corner_view.substr(0, slash), positions.size());
+        std::optional<std::uint32_t> uv = std::nullopt;
+        if (slash != std::string::npos)
+        {
+          const std::string_view rest = corner_view.substr(slash + 1);
+          const std::string_view uv_text = rest.substr(0, rest.find('/'));
+          if (!uv_text.empty())
+          {
+            uv = ResolveObjIndex(uv_text, uvs.size());
+            if (!uv.has_value())
+            {
+              position.reset();
+            }
+          }
+        }
+        if (!position.has_value())
+        {
+          SPDLOG_ERROR("{}:{}: invalid face corner {}", path.string(), line_number, corner);
+          return std::nullopt;
+        }
+
+        const std::uint64_t key = (std::uint64_t{*position} << 32) | (uv.has_value() ? *uv + 1ull : 0ull);
+        auto [it, inserted] = vertex_of_corner.try_emplace(key, static_cast<std::uint32_t>(mesh.vertices_.size()));
+        if (inserted)
+        {
+          mesh.vertices_.push_back(veng::Vertex{
+              positions[*position], colors[*position], uv.has_value() ? uvs[*uv] : glm::vec2(0.0f)});
+        }
+        polygon.push_back(it->second);
+      }
+      for (std::size_t i = 2; i < polygon.size(); i++)
+      {
+        mesh.indices_.insert(mesh.indices_.end(), {polygon[0], polygon[i - 1], polygon[i]});
+      }
+    }
+  }
+  return mesh;
+}
+
+// Every triangle primitive of every mesh, merged in mesh space. Node transforms are not applied.
+static std::optional<MeshData> LoadGltf(const std::filesystem::path& path)
+{
+  const std::string path_string = path.string();
+  cgltf_options options = NULL_STRUCT;
+  cgltf_data* data = nullptr;
+  if (cgltf_parse_file(&options, path_string.c_str(), &data) != cgltf_result_success ||
+      cgltf_load_buffers(&options, data, path_string.c_str()) != cgltf_result_success)
+  {
+    SPDLOG_ERROR("Failed to load the glTF file {}", path_string);
+    cgltf_free(data);
+    return std::nullopt;
+  }
+
+  MeshData mesh;
+  for (cgltf_size mesh_index = 0; mesh_index < data->meshes_count; mesh_index++)
+  {
+    const cgltf_mesh& source = data->meshes[mesh_index];
+    for (cgltf_size primitive_index = 0; primitive_index < source.primitives_count; primitive_index++)
+    {
+      const cgltf_primitive& primitive = source.primitives[primitive_index];
+      if (primitive.type != cgltf_primitive_type_triangles)
+      {
+        SPDLOG_WARN("Skipping a primitive of {} that is not a triangle list", source.name ? source.name : "a mesh");
+        continue;
+      }
+
+      const cgltf_accessor* positions = nullptr;
+      const cgltf_accessor* colors = nullptr;
+      const cgltf_accessor* uvs = nullptr;
+      for (cgltf_size i = 0; i < primitive.attributes_count; i++)
+      {
+        const cgltf_attribute& attribute = primitive.attributes[i];
+        if (attribute.type == cgltf_attribute_type_position)
+        {
+          positions = attribute.data;
+        }
+        else if (attribute.type == cgltf_attribute_type_color && attribute.index == 0)
+        {
+          colors = attribute.data;
+        }
+        else if (attribute.type == cgltf_attribute_type_texcoord && attribute.index == 0)
+        {
+          uvs = attribute.data;
+        }
+      }
+      if (positions == nullptr)
+      {
+        continue;
+      }
+
+      const std::uint32_t first_vertex = static_cast<std::uint32_t>(mesh.vertices_.size());
+      for (cgltf_size i = 0; i < positions->count; i++)
+      {
+        veng::Vertex vertex;
+        cgltf_accessor_read_float(positions, i, &vertex.position_.x, 3);
+        if (colors != nullptr)
+        {
+          cgltf_accessor_read_float(colors, i, &vertex.color_.x, 3);  // Alpha, if any, is dropped
+        }
+        if (uvs != nullptr)
+        {
+          cgltf_accessor_read_float(uvs, i, &vertex.uv_.x, 2);
+        }
+        mesh.vertices_.push_back(vertex);
+      }
+
+      if (primitive.indices != nullptr)
+      {
+        for (cgltf_size i = 0; i < primitive.indices->count; i++)
+        {
+          mesh.indices_.push_back(
+              first_vertex + static_cast<std::uint32_t>(cgltf_accessor_read_index(primitive.indices, i)));
+        }
+      }
+      else
+      {
+        for (cgltf_size i = 0; i < positions->count; i++)
+        {
+          mesh.indices_.push_back(first_vertex + static_cast<std::uint32_t>(i));
+        }
+      }
+    }
+  }
+
+  cgltf_free(data);
+  return mesh;
+}
+
+std::int32_t main(std::int32_t argc, gsl::zstring* argv)
+{
+  spdlog::set_pattern("[%H:%M:%S] %^[%l]%$ %v");
+  gsl::span<gsl::zstring> arguments(argv, argc);
+  if (arguments.size() != 3)
+  {
+    SPDLOG_ERROR("Usage: MeshConverter <input.obj|input.gltf|input.glb> <output.vmesh>");
+    return EXIT_FAILURE;
+  }
+  const std::filesystem::path input = arguments[1];
+  const std::filesystem::path output = arguments[2];
+
+  std::string extension = input.extension().string();
+  std::transform(
+      extension.begin(), extension.end(), extension.begin(),
+      [](unsigned char c)
+      {
+        return static_cast<char>(std::tolower(c));
+      });
+  std::optional<MeshData> mesh = std::nullopt;
+  if (extension == ".obj")
+  {
+    mesh = LoadObj(input);
+  }
+  else if (extension == ".gltf" || extension == ".glb")
+  {
+    mesh = LoadGltf(input);
+  }
+  else
+  {
+    SPDLOG_ERROR("Unsupported input format {}, expected .obj, .gltf or .glb", extension);
+    return EXIT_FAILURE;
+  }
+
+  if (!mesh.has_value() || mesh->indices_.empty())
+  {
+    SPDLOG_ERROR("No triangles found in {}", input.string());
+    return EXIT_FAILURE;
+  }
+  if (!veng::WriteMeshFile(output, mesh->vertices_, mesh->indices_))
+  {
+    return EXIT_FAILURE;
+  }
+  SPDLOG_INFO(
+      "Wrote {}: {} vertices, {} triangles", output.string(), mesh->vertices_.size(), mesh->indices_.size() / 3);
+  return EXIT_SUCCESS;
+}
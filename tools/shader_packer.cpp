@@ -0,0 +1,47 @@
+#include <shader_archive.h>
+
+// Build step packing the compiled shaders into the archive the engine maps at startup, see src/shader_archive.h.
+// Each shader is named after its file without the ".spv", e.g. "basic.vert.spv" becomes "basic.vert".
+// Usage: ShaderPacker <output.vsha> <input.spv>...
+
+constexpr std::uint32_t kSpirvMagic = 0x07230203;
+
+std::int32_t main(std::int32_t argc, gsl::zstring* argv)
+{
+  spdlog::set_pattern("[%H:%M:%S] %^[%l]%$ %v");
+  gsl::span<gsl::zstring> arguments(argv, argc);
+  if (arguments.size() < 3)
+  {
+    SPDLOG_ERROR("Usage: ShaderPacker <output.vsha> <input.spv>...");
+    return EXIT_FAILURE;
+  }
+  const std::filesystem::path output = arguments[1];
+
+  std::vector<veng::PackedShader> shaders;
+  std::uint64_t total_size = 0;
+  for (gsl::zstring argument : arguments.subspan(2))
+  {
+    const std::filesystem::path input = argument;
+    veng::PackedShader shader{input.stem().string(), veng::ReadFile(input)};
+    std::uint32_t magic = 0;
+    if (shader.code_.size() >= sizeof(magic))
+    {
+      std::memcpy(&magic, shader.code_.data(), sizeof(magic));
+    }
+    if (magic != kSpirvMagic || shader.code_.size() % sizeof(std::uint32_t) != 0)
+    {
+      SPDLOG_ERROR("{} is not a SPIR-V module", input.string());
+      return EXIT_FAILURE;
+    }
+    total_size += shader.code_.size();
+    shaders.push_back(std::move(shader));
+  }
+
+  const std::size_t shader_count = shaders.size();
+  if (!veng::WriteShaderArchive(output, std::move(shaders)))
+  {
+    return EXIT_FAILURE;
+  }
+  SPDLOG_INFO("Packed {} shaders, {} bytes of SPIR-V, into {}", shader_count, total_size, output.string());
+  return EXIT_SUCCESS;
+}